@@ -19,17 +19,162 @@
 #include <math.h>
 #include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <usefull_macros.h>
 
 #include "mlx90640.h"
+#include "mlx_cache.h"
+#include "mlx_filter.h"
+#include "mlx_service.h"
 #include "testdata.h"
 
-int main (int _U_ argc, char _U_ **argv){
+// default amount of frames in benchmark
+#define BENCH_NITER     (5000)
+// amount of checks of results during benchmark (in the end of each part of iterations)
+#define BENCH_CHUNKS    (10)
+// relative tolerance of benchmark results (the same as of `chkImage`)
+#define BENCH_TOLERANCE (1e-3)
+// absolute tolerance (for values near zero: fixed point have constant absolute error)
+#define BENCH_ABSTOL    (0.01)
+
+typedef enum{
+    B_PLAIN,    // process_subpage
+    B_TO,       // process_subpage_to
+#ifdef MLX_FIXEDPOINT
+    B_Q,        // process_subpage_q
+#endif
+    B_AMOUNT
+} bench_func;
+
+static const char *bench_names[B_AMOUNT] = {
+    "process_subpage", "process_subpage_to",
+#ifdef MLX_FIXEDPOINT
+    "process_subpage_q"
+#endif
+};
+
+/**
+ * @brief cmpimage - compare image with reference
+ * @return index of first bad pixel or -1 if all are within tolerance
+ */
+static int cmpimage(const fp_t im[MLX_PIXNO], const fp_t ref[MLX_PIXNO]){
+    for(int i = 0; i < MLX_PIXNO; ++i){
+        fp_t diff = (fabs(im[i]) + fabs(ref[i])) * BENCH_TOLERANCE;
+        if(diff < BENCH_ABSTOL) diff = BENCH_ABSTOL;
+        if(!(fabs(im[i] - ref[i]) <= diff)) return i; // NaN too
+    }
+    return -1;
+}
+
+// process both subpages of test frame by function `f`, result in `image`
+static void bench_frame(bench_func f, MLX90640_params *p, int mode, fp_t image[MLX_PIXNO]){
+    static fp_t img[MLX_PIXNO];
+#ifdef MLX_FIXEDPOINT
+    static mlxq_t qimg[MLX_PIXNO];
+#endif
+    fp_t *sp = img;
+    for(int i = 0; i < 2; ++i){
+        switch(f){
+            case B_PLAIN:
+                sp = process_subpage(p, DataFrame[i], i, mode);
+            break;
+            case B_TO:
+                process_subpage_to(p, DataFrame[i], i, mode, img);
+            break;
+#ifdef MLX_FIXEDPOINT
+            case B_Q:
+                process_subpage_q(p, DataFrame[i], i, mode, qimg);
+            break;
+#endif
+            default:
+            break;
+        }
+    }
+#ifdef MLX_FIXEDPOINT
+    if(f == B_Q) for(int i = 0; i < MLX_PIXNO; ++i) img[i] = MLXQ2FP(qimg[i]);
+#endif
+    if(image) memcpy(image, sp, sizeof(fp_t) * MLX_PIXNO);
+}
+
+/**
+ * @brief benchmark - replay test frame `niter` times through all processing functions in all modes,
+ *        results are checked by `ToFrame` (or result of `process_subpage` for mode 0)
+ */
+static void benchmark(MLX90640_params *p, int niter){
+    int nchunk = (niter + BENCH_CHUNKS - 1) / BENCH_CHUNKS;
+    niter = nchunk * BENCH_CHUNKS;
+    printf("%d frames (%d pixels) of test data, results are checked %d times\n", niter, MLX_PIXNO, BENCH_CHUNKS);
+    printf("%-20s %4s %12s %12s %12s\n", "function", "mode", "ns/pixel", "best", "frames/s");
+    for(int mode = 0; mode < 3; ++mode){
+        fp_t ref[MLX_PIXNO], image[MLX_PIXNO];
+        if(mode) memcpy(ref, ToFrame[1], sizeof(ref));
+        else bench_frame(B_PLAIN, p, 0, ref); // there's no reference of IR image
+        for(bench_func f = 0; f < B_AMOUNT; ++f){
+            double tsum = 0., tbest = -1.;
+            for(int c = 0; c < BENCH_CHUNKS; ++c){
+                double t0 = sl_dtime();
+                for(int k = 0; k < nchunk; ++k) bench_frame(f, p, mode, NULL);
+                t0 = sl_dtime() - t0;
+                tsum += t0;
+                if(tbest < 0. || t0 < tbest) tbest = t0;
+                bench_frame(f, p, mode, image);
+                int bad = cmpimage(image, ref);
+                if(bad > -1) ERRX("%s, mode %d: pixel %d is %g instead of %g", bench_names[f], mode,
+                                  bad, image[bad], ref[bad]);
+            }
+            printf("%-20s %4d %12.2f %12.2f %12.0f\n", bench_names[f], mode, tsum * 1e9 / niter / MLX_PIXNO,
+                   tbest * 1e9 / nchunk / MLX_PIXNO, niter / tsum);
+        }
+    }
+    printf("best - time of the fastest part of iterations\n");
+}
+
+static void usage(const char *name){
+    ERRX("Usage: %s [-b] [-n niter]\n"
+         "\t-b       - run benchmark instead of tests\n"
+         "\t-n niter - amount of frames in benchmark (default %d)", name, BENCH_NITER);
+}
+
+int main (int argc, char **argv){
     sl_init();
+    int opt, bench = 0, niter = BENCH_NITER;
+    while((opt = getopt(argc, argv, "bn:")) != -1){
+        switch(opt){
+            case 'b':
+                bench = 1;
+            break;
+            case 'n':
+                niter = atoi(optarg);
+                if(niter < 1) usage(argv[0]);
+            break;
+            default:
+                usage(argv[0]);
+        }
+    }
     MLX90640_params p;
     if(!get_parameters(EEPROM, &p)) ERRX("Can't get parameters from test data");
+    if(bench){
+        benchmark(&p, niter);
+        return 0;
+    }
     dump_parameters(&p, &extracted_parameters);
+    // calibration cache (in own temporary directory): the second open should map existing file
+    char cachedir[] = "/tmp/mlxcacheXXXXXX";
+    if(!mkdtemp(cachedir)) ERR("mkdtemp");
+    for(int i = 0; i < 2; ++i){
+        double t0 = sl_dtime();
+        mlx_calib *c = mlxc_open(cachedir, EEPROM);
+        if(!c) ERRX("Can't open calibration cache");
+        t0 = sl_dtime() - t0;
+        printf("Calibration cache %016llx: %s for %.1fus, parameters %s\n", (unsigned long long)c->chksum,
+               c->fromcache ? "loaded" : "created", t0 * 1e6,
+               memcmp(c->params, &p, sizeof(p)) ? "differ" : "OK");
+        if(i == 1 && unlink(c->filename)) WARN("unlink(%s)", c->filename);
+        mlxc_close(&c);
+    }
+    if(rmdir(cachedir)) WARN("rmdir(%s)", cachedir);
     fp_t *sp;
     for(int i = 0; i < 2; ++i){
         printf("Process subpage %d\n", i);
@@ -39,5 +184,87 @@ int main (int _U_ argc, char _U_ **argv){
         chkImage(sp, ToFrame[i]);
     }
     drawIma(sp);
+    fp_t image[MLX_PIXNO] = {0};
+    for(int i = 0; i < 2; ++i){
+        printf("Process subpage %d (vectorized)\n", i);
+        if(!process_subpage_to(&p, DataFrame[i], i, 2, image)) ERRX("WTF?");
+        chkImage(image, ToFrame[i]);
+    }
+#ifdef MLX_FIXEDPOINT
+    // fixed-point pipeline vs floating point (test data & the same data with hot/cold pixels)
+    for(int hot = 0; hot < 2; ++hot){
+        int16_t frame[2][MLX_DMA_MAXLEN];
+        memcpy(frame, DataFrame, sizeof(frame));
+        if(hot) for(int i = 0; i < MLX_PIXNO; ++i) frame[i&1][i] += (i % 9) * 2500 - 400;
+        for(int mode = 0; mode < 3; ++mode){
+            fp_t maxdiff = 0., tfp = 0., tq = 0., fimg[MLX_PIXNO];
+            mlxq_t qimg[MLX_PIXNO];
+            for(int i = 0; i < 2; ++i){
+                double t0 = sl_dtime();
+                for(int k = 0; k < 100; ++k) process_subpage_to(&p, frame[i], i, mode, fimg);
+                tfp += sl_dtime() - t0;
+                t0 = sl_dtime();
+                for(int k = 0; k < 100; ++k) process_subpage_q(&p, frame[i], i, mode, qimg);
+                tq += sl_dtime() - t0;
+            }
+            for(int i = 0; i < MLX_PIXNO; ++i){
+                fp_t d = fabs(MLXQ2FP(qimg[i]) - fimg[i]);
+                if(!(d <= maxdiff)) maxdiff = d; // NaN too
+            }
+            printf("Fixed point, %s data, mode %d: max diff %.4f, time %.2fus (float: %.2fus) - ", hot ? "hot" : "test",
+                   mode, maxdiff, tq * 1e4 / 2., tfp * 1e4 / 2.);
+            if(!(maxdiff <= 0.01)) ERRX("too big difference");
+            printf("OK\n");
+        }
+    }
+#endif
+    // post-processing: interpolation of bad pixel & temporal filtering of noisy frames
+    static mlx_filter f;
+    static MLX90640_params pbad;
+    memcpy(&pbad, &p, sizeof(p));
+    pbad.outliers[10*MLX_W + 10] = 1;
+    mlxf_init(&f, &pbad, 0.001, 0.25, MLXF_GATE);
+    memcpy(image, ToFrame[1], sizeof(image));
+    image[10*MLX_W + 10] = -273.15;
+    mlxf_interpolate(&f, image);
+    printf("Bad pixel: %g, interpolated: %g\n", ToFrame[1][10*MLX_W + 10], image[10*MLX_W + 10]);
+    srand48(1);
+    for(int k = 0; k < 60; ++k){
+        fp_t step = (k < 50) ? 0. : 10., e0 = 0., e = 0.; // step of temperature on 50th frame
+        for(int i = 0; i < MLX_PIXNO; ++i){ // noise with sigma=0.5
+            fp_t n = 0.5 * sqrt(-2. * log(1. - drand48())) * cos(2. * M_PI * drand48());
+            image[i] = ToFrame[1][i] + step + n;
+            e0 += n * n;
+        }
+        mlxf_apply(&f, image);
+        for(int i = 0; i < MLX_PIXNO; ++i){
+            fp_t d = image[i] - ToFrame[1][i] - step;
+            e += d * d;
+        }
+        if(k == 49 || k == 50 || k == 59)
+            printf("Frame %d: RMS noise %.3f, after filtering %.3f\n", k, sqrt(e0/MLX_PIXNO), sqrt(e/MLX_PIXNO));
+    }
+    // processing service: the same data from several sensors
+#define NSENSORS    (4)
+    mlx_service *s = mlxs_new(NSENSORS, 2, MLXS_RINGSZ, 2, NULL, NULL);
+    if(!s) ERRX("Can't run processing service");
+    for(int n = 0; n < NSENSORS; ++n) mlxs_set_params(s, n, &p);
+    for(int k = 0; k < 16; ++k){
+        for(int n = 0; n < NSENSORS; ++n)
+            for(int i = 0; i < 2; ++i)
+                while(!mlxs_push(s, n, DataFrame[i], i, sl_dtime())) mlxs_flush(s);
+    }
+    mlxs_flush(s);
+    for(int n = 0; n < NSENSORS; ++n){
+        mlx_frame f;
+        mlxs_stat st = {0};
+        mlxs_stats(s, n, &st);
+        printf("Sensor %d: pushed %lu, dropped %lu, frames %lu\n", n, (unsigned long)st.pushed,
+               (unsigned long)st.dropped, (unsigned long)st.frames);
+        if(!mlxs_last(s, n, &f)) ERRX("No frames from sensor %d", n);
+        chkImage(f.image, ToFrame[1]);
+    }
+    mlxs_free(&s);
+#undef NSENSORS
     return 0;
 }
@@ -28,6 +28,11 @@
 // tolerance of floating point comparison
 #define FP_TOLERANCE    (1e-3)
 
+#ifdef MLX_FIXEDPOINT
+// value in fixed point with n fractional bits
+#define FIXQ(x, n)      ((int64_t)llround((x) * (fp_t)(1LL<<(n))))
+#endif
+
 static fp_t mlx_image[MLX_PIXNO] = {0}; // ready image
 
 #ifdef EBUG
@@ -362,21 +367,70 @@ int get_parameters(const uint16_t dataarray[MLX_DMA_MAXLEN], MLX90640_params *pa
     params->alphacorr[3] = (1. + params->KsTo[2] * (params->CT[2] - params->CT[1])) * params->alphacorr[2];
     params->resolEE = (uint8_t)((CREG_VAL(REG_KTAVSCALE) & 0x3000) >> 12);
     // Don't forget to check 'outlier' flags for wide purpose
+    mlx_prepare(params);
     return TRUE;
 #undef CREG_VAL
 }
 
 /**
- * @brief process_subpage - calculate all parameters from `dataarray` into `mlx_image`
- * @param subpageno - number of subpage
- * @param simpleimage == 0 - simplest, 1 - narrow range, 2 - extended range
+ * @brief mlx_prepare - fill frame-invariant per-subpage arrays of `params`
+ *        (called by `get_parameters`, call it again if you change parameters)
  */
-fp_t *process_subpage(MLX90640_params *params, const int16_t Frame[MLX_DMA_MAXLEN], int subpageno, int simpleimage){
-#define IMD_VAL(reg) Frame[IMD_IDX(reg)]
-    DBG("\nprocess_subpage(%d)", subpageno);
-#ifdef EBUG
-    chstate();
+void mlx_prepare(MLX90640_params *params){
+    int n[2] = {0, 0};
+    uint16_t pixno = 0;
+    for(int row = 0, rowidx = 0; row < MLX_H; ++row, rowidx ^= 2){
+        for(int col = 0, idx = rowidx; col < MLX_W; ++col, ++pixno, idx ^= 1){
+            int sp = (row&1)^(col&1), i = n[sp]++;
+            params->sp_idx[sp][i] = pixno;
+            params->sp_offset[sp][i] = params->offset[pixno];
+            params->sp_offkta[sp][i] = params->offset[pixno] * params->kta[pixno];
+            params->sp_kv[sp][i] = params->kv[idx];
+            params->sp_alpha[sp][i] = params->alpha[pixno] - params->tgc * params->cpAlpha[sp];
+            if(params->sp_alpha[sp][i] <= 0.) params->outliers[pixno] = 1; // To can't be calculated
+#ifdef MLX_FIXEDPOINT
+            params->q_offset[sp][i] = FIXQ(params->sp_offset[sp][i], 12);
+            params->q_offkta[sp][i] = FIXQ(params->sp_offkta[sp][i], 12);
+            params->q_kv[sp][i] = FIXQ(params->sp_kv[sp][i], 16);
+            fp_t ia = 1. / params->sp_alpha[sp][i];
+            if(ia > 0. && ia < 4e9) params->q_invalpha[sp][i] = (uint32_t)llround(ia);
+            else{ // out of range: bad pixel (its To will be equal to Ta)
+                params->q_invalpha[sp][i] = 0;
+                params->outliers[pixno] = 1;
+            }
+#endif
+        }
+    }
+#ifdef MLX_FIXEDPOINT
+    for(int i = 0; i < 4; ++i){
+        params->q_KsTo[i] = FIXQ(params->KsTo[i], 40);
+        params->q_alphacorr[i] = FIXQ(params->alphacorr[i], 30);
+    }
+    for(int i = 0; i < 3; ++i) params->q_CT[i] = FIXQ(params->CT[i], 16);
+    params->q_K1 = FIXQ(1. - 273.15*params->KsTo[1], 30);
+    params->q_alphaPTAT = FIXQ(params->alphaPTAT, 16);
+    params->q_KvPTAT = FIXQ(params->KvPTAT, 30);
+    params->q_KtPTAT = FIXQ(params->KtPTAT, 16);
+    params->q_cpKta = FIXQ(params->cpKta, 30);
+    params->q_cpKv = FIXQ(params->cpKv, 24);
+    params->q_tgc = FIXQ(params->tgc, 20);
+    params->q_KsTa = FIXQ(params->KsTa, 30);
 #endif
+}
+
+// frame-dependent values common for all pixels
+typedef struct{
+    fp_t dvdd;      // (Vdd - Vdd25)/kVdd with resolution correction
+    fp_t dTa;       // Ta - 25
+    fp_t Kgain;     // gain compensation
+    fp_t pixOS[2];  // pix_OS_CP_SPx
+} frame_scalars;
+
+/**
+ * @brief get_scalars - calculate frame-dependent values (11.2.2.1 - 11.2.2.6)
+ */
+static void get_scalars(const MLX90640_params *params, const int16_t Frame[MLX_DMA_MAXLEN], frame_scalars *fs){
+#define IMD_VAL(reg) Frame[IMD_IDX(reg)]
     // 11.2.2.1. Resolution restore
     // temporary:
     fp_t resol_corr = (fp_t)(1<<params->resolEE) / (1<<2); // calibrated resol/current resol
@@ -403,15 +457,33 @@ fp_t *process_subpage(MLX90640_params *params, const int16_t Frame[MLX_DMA_MAXLE
     i16a = (int16_t)IMD_VAL(REG_IGAIN);
     fp_t Kgain = params->gainEE / (fp_t)i16a;
     DBG("Kgain=%g", Kgain);
-    fp_t pixOS[2]; // pix_gain_CP_SPx
     // 11.2.2.6.1
-    pixOS[0] = ((int16_t)IMD_VAL(REG_ICPSP0))*Kgain; // pix_OS_CP_SPx
-    pixOS[1] = ((int16_t)IMD_VAL(REG_ICPSP1))*Kgain;
-    DBG("pixGain: %g/%g", pixOS[0], pixOS[1]);
+    fs->pixOS[0] = ((int16_t)IMD_VAL(REG_ICPSP0))*Kgain; // pix_OS_CP_SPx
+    fs->pixOS[1] = ((int16_t)IMD_VAL(REG_ICPSP1))*Kgain;
+    DBG("pixGain: %g/%g", fs->pixOS[0], fs->pixOS[1]);
     for(int i = 0; i < 2; ++i){ // calc pixOS by gain
         // 11.2.2.6.2
-        pixOS[i] -= params->cpOffset[i]*(1. + params->cpKta*dTa)*(1. + params->cpKv*dvdd);
+        fs->pixOS[i] -= params->cpOffset[i]*(1. + params->cpKta*dTa)*(1. + params->cpKv*dvdd);
     }
+    fs->dvdd = dvdd;
+    fs->dTa = dTa;
+    fs->Kgain = Kgain;
+#undef IMD_VAL
+}
+
+/**
+ * @brief process_subpage - calculate all parameters from `dataarray` into `mlx_image`
+ * @param subpageno - number of subpage
+ * @param simpleimage == 0 - simplest, 1 - narrow range, 2 - extended range
+ */
+fp_t *process_subpage(MLX90640_params *params, const int16_t Frame[MLX_DMA_MAXLEN], int subpageno, int simpleimage){
+    DBG("\nprocess_subpage(%d)", subpageno);
+#ifdef EBUG
+    chstate();
+#endif
+    frame_scalars fs;
+    get_scalars(params, Frame, &fs);
+    fp_t dvdd = fs.dvdd, dTa = fs.dTa, Kgain = fs.Kgain, *pixOS = fs.pixOS;
     // now make first approximation to image
     uint16_t pixno = 0;  // current pixel number - for indexing in parameters etc
     for(int row = 0, rowidx = 0; row < MLX_H; ++row, rowidx ^= 2){
@@ -461,8 +533,292 @@ fp_t *process_subpage(MLX90640_params *params, const int16_t Frame[MLX_DMA_MAXLE
     }
     DBG("Time: %g", sl_dtime()-Tlast);
     return mlx_image;
+}
+
+/**
+ * @brief process_subpage_to - the same as `process_subpage`, but reentrant and vectorized:
+ *        pixels of subpage are processed by precomputed lists (see `mlx_prepare`)
+ * @param image - image to fill (only pixels of given subpage are changed)
+ * @return FALSE if subpageno is wrong
+ */
+int process_subpage_to(const MLX90640_params *params, const int16_t Frame[MLX_DMA_MAXLEN], int subpageno, int simpleimage, fp_t image[MLX_PIXNO]){
+    if(subpageno < 0 || subpageno > 1) return FALSE;
+    frame_scalars fs;
+    get_scalars(params, Frame, &fs);
+    const uint16_t *pidx = params->sp_idx[subpageno];
+    const fp_t *off = params->sp_offset[subpageno], *offkta = params->sp_offkta[subpageno],
+        *kv = params->sp_kv[subpageno], *alpha = params->sp_alpha[subpageno];
+    fp_t IR[MLX_SPPIXNO] MLX_ALIGN, To[MLX_SPPIXNO] MLX_ALIGN;
+    fp_t dTa = fs.dTa, dvdd = fs.dvdd, Kgain = fs.Kgain, cpcomp = params->tgc * fs.pixOS[subpageno];
+    for(int i = 0; i < MLX_SPPIXNO; ++i) IR[i] = (fp_t)Frame[pidx[i]];
+    // 11.2.2.5 - 11.2.2.7: gain, offset & pattern compensation
+    #pragma omp simd aligned(IR: 32)
+    for(int i = 0; i < MLX_SPPIXNO; ++i)
+        IR[i] = IR[i]*Kgain - (off[i] + offkta[i]*dTa) * (1. + kv[i]*dvdd) - cpcomp;
+    if(simpleimage == 0){
+        for(int i = 0; i < MLX_SPPIXNO; ++i) image[pidx[i]] = IR[i];
+        return TRUE;
+    }
+    // 11.2.2.8 - 11.2.2.9
+    fp_t KsTaK = 1. + params->KsTa * dTa, Tar = dTa + 273.15 + 25.;
+    Tar = Tar*Tar*Tar*Tar;
+    fp_t KsTo1 = params->KsTo[1], K1 = 1. - 273.15*KsTo1;
+    #pragma omp simd aligned(IR, To: 32)
+    for(int i = 0; i < MLX_SPPIXNO; ++i){
+        fp_t ac = alpha[i] * KsTaK, ac3 = ac*ac*ac, ir = IR[i];
+        fp_t Sx = KsTo1 * SQRT(SQRT(ac3*ir + ac*ac3*Tar));
+        IR[i] *= 1. / ac; // for extended range
+        To[i] = SQRT(SQRT(ir / (ac*K1 + Sx) + Tar)) - 273.15;
+    }
+    fp_t CT0 = params->CT[0], CT1 = params->CT[1];
+    int outofrange = 0; // usually all pixels are in basic range, so don't run next cycle
+    if(simpleimage == 2){
+        #pragma omp simd reduction(|:outofrange) aligned(To: 32)
+        for(int i = 0; i < MLX_SPPIXNO; ++i) outofrange |= (To[i] <= CT0) | (To[i] > CT1);
+    }
+    if(outofrange){ // 11.2.2.9.1.3. Extended To range calculation
+        fp_t CT2 = params->CT[2];
+        fp_t ac0 = params->alphacorr[0], ac2 = params->alphacorr[2], ac3 = params->alphacorr[3];
+        fp_t ks0 = params->KsTo[0], ks2 = params->KsTo[2], ks3 = params->KsTo[3];
+        #pragma omp simd aligned(IR, To: 32)
+        for(int i = 0; i < MLX_SPPIXNO; ++i){
+            fp_t t = To[i], ctx = -40., corr = ac0, ks = ks0; // range 1
+            if(t > CT1){ ctx = CT1; corr = ac2; ks = ks2; } // range 3
+            if(t > CT2){ ctx = CT2; corr = ac3; ks = ks3; } // range 4
+            fp_t te = SQRT(SQRT(IR[i] / (corr * (1. + ks*(t - ctx))) + Tar)) - 273.15;
+            if(t <= CT0 || t > CT1) To[i] = te; // range 2 is default
+        }
+    }
+    for(int i = 0; i < MLX_SPPIXNO; ++i) image[pidx[i]] = To[i];
+    return TRUE;
+}
+#ifdef MLX_FIXEDPOINT
+/*
+ * Fixed-point pipeline: frame-dependent scalars are calculated once per frame by `get_scalars_q`
+ * (a few 64-bit divisions), all calculations are in integers (floating point is used only by
+ * `mlx_prepare`, which runs once)
+ */
+
+// 273.15 in Q16
+#define Q_T0        (17901158)
+// 298.15 in Q16
+#define Q_TA0       (19539558)
+
+// frame-dependent values common for all pixels (fixed point)
+typedef struct{
+    int32_t dvdd;       // (Vdd - Vdd25)/kVdd with resolution correction, Q16
+    int32_t dTa;        // Ta - 25, Q16
+    int64_t Kgain;      // gain compensation, Q24
+    int32_t cpcomp[2];  // tgc * pix_OS_CP_SPx, Q12
+    int64_t Tar;        // Ta^4, K^4
+    int64_t iKsTa;      // 1/(1 + KsTa*dTa), Q16
+} frame_scalars_q;
+
+// n/d rounded to nearest, zero if d == 0 (broken frame or EEPROM)
+static inline int64_t qdiv(int64_t n, int64_t d){
+    if(!d) return 0;
+    int64_t h = ((d > 0) ? d : -d) / 2;
+    return ((n < 0) ? n - h : n + h) / d;
+}
+
+/**
+ * @brief get_scalars_q - the same as `get_scalars`, but in fixed point
+ */
+static void get_scalars_q(const MLX90640_params *params, const int16_t Frame[MLX_DMA_MAXLEN], frame_scalars_q *fs){
+#define IMD_VAL(reg) Frame[IMD_IDX(reg)]
+    // 11.2.2.1 - 11.2.2.2, resol_corr = 2^resolEE / 2^2
+    int32_t i16a = (int16_t)IMD_VAL(REG_IVDDPIX);
+    int32_t dvdd = (int32_t)qdiv((((int64_t)i16a << params->resolEE) - 4*params->vdd25) * (1<<14), params->kVdd);
+    int32_t dV = (int32_t)qdiv((int64_t)(i16a - params->vdd25) * (1<<16), params->kVdd);
+    // 11.2.2.3, vptatart in Q12
+    i16a = (int16_t)IMD_VAL(REG_ITAPTAT);
+    int32_t i16b = (int16_t)IMD_VAL(REG_ITAVBE);
+    int64_t vp = qdiv((int64_t)i16a * (1LL<<46), (int64_t)i16a * params->q_alphaPTAT + (int64_t)i16b * (1<<16));
+    vp = qdiv(vp * (1LL<<30), (1LL<<30) + (((int64_t)params->q_KvPTAT * dV) >> 16));
+    int32_t dTa = (int32_t)qdiv((vp - (int64_t)params->vPTAT25 * (1<<12)) * (1<<20), params->q_KtPTAT);
+    // 11.2.2.4
+    i16a = (int16_t)IMD_VAL(REG_IGAIN);
+    int64_t Kgain = qdiv((int64_t)params->gainEE * (1<<24), i16a);
+    // 11.2.2.6, pix_OS_CP_SPx in Q24
+    int64_t kta = (1LL<<30) + (((int64_t)params->q_cpKta * dTa) >> 16), // Q30
+            kv = (1LL<<30) + (((int64_t)params->q_cpKv * dvdd) >> 10);  // Q30
+    for(int i = 0; i < 2; ++i){
+        int64_t os = (int16_t)IMD_VAL(i ? REG_ICPSP1 : REG_ICPSP0) * Kgain;
+        os -= ((((int64_t)params->cpOffset[i] * kta) >> 16) * kv) >> 20;
+        fs->cpcomp[i] = (int32_t)((params->q_tgc * os) >> 32);
+    }
+    // 11.2.2.8
+    int64_t Ta = dTa + Q_TA0, Ta2 = (Ta * Ta) >> 24; // Q8
+    fs->Tar = (Ta2 * Ta2) >> 16;
+    fs->iKsTa = qdiv(1LL<<46, (1LL<<30) + (((int64_t)params->q_KsTa * dTa) >> 16));
+    fs->dvdd = dvdd;
+    fs->dTa = dTa;
+    fs->Kgain = Kgain;
 #undef IMD_VAL
 }
+
+// table for fourth root: root4tab[r][j] = round(2^30 * (2^r * (1 + j/64))^(1/4)), j = 0..64
+// (linear interpolation between nodes gives relative error less than 6e-6)
+static const uint32_t root4tab[4][65] = {
+    {
+        1073741824, 1077911774, 1082033882, 1086109412, 1090139572, 1094125523, 1098068382,
+        1101969219, 1105829065, 1109648911, 1113429712, 1117172386, 1120877818, 1124546861,
+        1128180339, 1131779047, 1135343749, 1138875187, 1142374077, 1145841110, 1149276954,
+        1152682256, 1156057643, 1159403720, 1162721075, 1166010277, 1169271876, 1172506407,
+        1175714389, 1178896324, 1182052701, 1185183994, 1188290663, 1191373155, 1194431905,
+        1197467334, 1200479854, 1203469865, 1206437754, 1209383900, 1212308670, 1215212425,
+        1218095511, 1220958270, 1223801033, 1226624122, 1229427852, 1232212531, 1234978458,
+        1237725924, 1240455215, 1243166609, 1245860377, 1248536784, 1251196089, 1253838545,
+        1256464400, 1259073893, 1261667262, 1264244737, 1266806543, 1269352900, 1271884025,
+        1274400129, 1276901417
+    },
+    {
+        1276901417, 1281860351, 1286762392, 1291609040, 1296401735, 1301141857, 1305830732,
+        1310469636, 1315059792, 1319602381, 1324098536, 1328549350, 1332955876, 1337319128,
+        1341640087, 1345919695, 1350158864, 1354358476, 1358519381, 1362642400, 1366728330,
+        1370777940, 1374791974, 1378771153, 1382716175, 1386627717, 1390506434, 1394352961,
+        1398167916, 1401951897, 1405705483, 1409429239, 1413123711, 1416789433, 1420426919,
+        1424036674, 1427619184, 1431174926, 1434704361, 1438207938, 1441686096, 1445139262,
+        1448567849, 1451972262, 1455352895, 1458710133, 1462044349, 1465355909, 1468645169,
+        1471912475, 1475158168, 1478382576, 1481586024, 1484768827, 1487931291, 1491073719,
+        1494196404, 1497299632, 1500383685, 1503448836, 1506495354, 1509523501, 1512533532,
+        1515525700, 1518500250
+    },
+    {
+        1518500250, 1524397449, 1530226991, 1535990660, 1541690167, 1547327154, 1552903198,
+        1558419815, 1563878461, 1569280540, 1574627400, 1579920339, 1585160611, 1590349423,
+        1595487937, 1600577277, 1605618528, 1610612736, 1615560913, 1620464038, 1625323055,
+        1630138880, 1634912397, 1639644465, 1644335914, 1648987547, 1653600145, 1658174463,
+        1662711234, 1667211170, 1671674962, 1676103279, 1680496772, 1684856074, 1689181799,
+        1693474544, 1697734891, 1701963405, 1706160634, 1710327113, 1714463364, 1718569892,
+        1722647192, 1726695745, 1730716018, 1734708469, 1738673543, 1742611673, 1746523284,
+        1750408788, 1754268589, 1758103078, 1761912641, 1765697653, 1769458478, 1773195476,
+        1776908995, 1780599376, 1784266953, 1787912053, 1791534994, 1795136087, 1798715638,
+        1802273946, 1805811301
+    },
+    {
+        1805811301, 1812824293, 1819756826, 1826611022, 1833388916, 1840092460, 1846723532,
+        1853283932, 1859775393, 1866199584, 1872558107, 1878852509, 1885084278, 1891254849,
+        1897365606, 1903417886, 1909412977, 1915352125, 1921236533, 1927067363, 1932845741,
+        1938572754, 1944249455, 1949876864, 1955455968, 1960987723, 1966473057, 1971912869,
+        1977308030, 1982659386, 1987967758, 1993233944, 1998458718, 2003642831, 2008787014,
+        2013891977, 2018958412, 2023986990, 2028978365, 2033933172, 2038852030, 2043735543,
+        2048584297, 2053398865, 2058179803, 2062927654, 2067642948, 2072326201, 2076977916,
+        2081598585, 2086188687, 2090748690, 2095279049, 2099780212, 2104252612, 2108696676,
+        2113112819, 2117501447, 2121862956, 2126197734, 2130506161, 2134788607, 2139045435,
+        2143277000, 2147483648
+    }
+};
+
+/**
+ * @brief root4 - fourth root by table
+ * @param x - argument (integer)
+ * @return x^(1/4) in Q16
+ */
+static int32_t root4(uint64_t x){
+    if(!x) return 0;
+    int b = 63 - __builtin_clzll(x); // x = 2^(4e+r) * (1 + j/64 + f)
+    int e = b >> 2, r = b & 3;
+    uint64_t t = x << (63 - b);
+    uint32_t j = (t >> 57) & 63, f = (t >> 33) & 0xffffff;
+    uint32_t y0 = root4tab[r][j], y = y0 + (uint32_t)(((uint64_t)(root4tab[r][j+1] - y0) * f) >> 24); // Q30
+    if(e >= 14) return (int32_t)((uint64_t)y << (e - 14));
+    return (int32_t)(y >> (14 - e));
+}
+
+// initial approximation of reciprocal: reciptab[k] = round(2^62 / ((64 + k + 0.5) * 2^25)), k = 0..63
+// (relative error less than 2^-7)
+static const uint32_t reciptab[64] = {
+    2130836488, 2098304633, 2066751180, 2036132644, 2006408080, 1977538899, 1949488702,
+    1922223125, 1895709703, 1869917734, 1844818167, 1820383490, 1796587627, 1773405851,
+    1750814694, 1728791868, 1707316192, 1686367527, 1665926709, 1645975491, 1626496491,
+    1607473140, 1588889636, 1570730897, 1552982525, 1535630765, 1518662469, 1502065065,
+    1485826524, 1469935331, 1454380460, 1439151345, 1424237860, 1409630292, 1395319325,
+    1381296015, 1367551776, 1354078359, 1340867839, 1327912594, 1315205296, 1302738895,
+    1290506605, 1278501893, 1266718465, 1255150260, 1243791434, 1232636354, 1221679586,
+    1210915890, 1200340205, 1189947649, 1179733506, 1169693221, 1159822392, 1150116765,
+    1140572228, 1131184802, 1121950641, 1112866020, 1103927337, 1095131103, 1086473940,
+    1077952576
+};
+
+/**
+ * @brief recip - reciprocal by table and two Newton steps (only 32x32->64 multiplications)
+ * @param m - normalized argument, 2^31 <= m < 2^32
+ * @return 2^62 / m (relative error less than 2^-27)
+ */
+static inline uint32_t recip(uint32_t m){
+    uint32_t y = reciptab[(m >> 25) & 63];
+    for(int i = 0; i < 2; ++i){
+        int64_t e = (int64_t)((1ULL << 62) - (uint64_t)m * y); // 2^62 * relative error of y
+        y += (int32_t)(((int64_t)y * (e >> 30)) >> 32);
+    }
+    return y;
+}
+
+// (v / den) + Tar, den in Q30, result in K^4 (clamped to be positive);
+// there's no 64-bit division on MCU, so v is multiplied by reciprocal of den
+static inline uint64_t To4(int64_t v, int64_t den, int64_t Tar){
+    if(den <= 0) return 1;
+    int b = 63 - __builtin_clzll((uint64_t)den); // den = m * 2^(b-31)
+    uint32_t m = (b > 31) ? (uint32_t)(den >> (b - 31)) : (uint32_t)den << (31 - b);
+    uint32_t y = recip(m);
+    uint64_t a = (v < 0) ? -(uint64_t)v : (uint64_t)v;
+    // v * 2^30 / den = v * y * 2^(-1-b) = q * 2^(31-b), q = (|v| * y) >> 32
+    uint64_t q = (uint64_t)(uint32_t)(a >> 32) * y + (((uint64_t)(uint32_t)a * y) >> 32);
+    if(b >= 31) q >>= b - 31;
+    else q = (q >> (b + 31)) ? (1ULL << 62) : q << (31 - b); // saturate if den is too small
+    int64_t t = ((v < 0) ? -(int64_t)q : (int64_t)q) + Tar;
+    return (t > 0) ? (uint64_t)t : 1;
+}
+
+/**
+ * @brief process_subpage_q - the same as `process_subpage_to`, but in fixed point
+ * @param image - image to fill (Q16.16): temperatures or IR values (simpleimage == 0)
+ * @return FALSE if subpageno is wrong
+ */
+int process_subpage_q(const MLX90640_params *params, const int16_t Frame[MLX_DMA_MAXLEN], int subpageno, int simpleimage, mlxq_t image[MLX_PIXNO]){
+    if(subpageno < 0 || subpageno > 1) return FALSE;
+    frame_scalars_q fs;
+    get_scalars_q(params, Frame, &fs);
+    const uint16_t *pidx = params->sp_idx[subpageno];
+    const int32_t *off = params->q_offset[subpageno], *offkta = params->q_offkta[subpageno],
+        *kv = params->q_kv[subpageno];
+    const uint32_t *invalpha = params->q_invalpha[subpageno];
+    int64_t Kgain = fs.Kgain, Tar = fs.Tar, iKsTa = fs.iKsTa;
+    int32_t dTa = fs.dTa, dvdd = fs.dvdd, cpcomp = fs.cpcomp[subpageno];
+    int64_t KsTo1 = params->q_KsTo[1];
+    int32_t K1 = params->q_K1, CT0 = params->q_CT[0], CT1 = params->q_CT[1], CT2 = params->q_CT[2];
+    for(int i = 0; i < MLX_SPPIXNO; ++i){
+        // 11.2.2.5 - 11.2.2.7, Q12
+        int64_t o = off[i] + (((int64_t)offkta[i] * dTa) >> 16);
+        o += (o * (((int64_t)kv[i] * dvdd) >> 16)) >> 16;
+        int64_t ir = ((Frame[pidx[i]] * Kgain) >> 12) - o - cpcomp;
+        if(simpleimage == 0){
+            ir *= 16;
+            image[pidx[i]] = (ir > INT32_MAX) ? INT32_MAX : (ir < INT32_MIN) ? INT32_MIN : (int32_t)ir;
+            continue;
+        }
+        // 11.2.2.8 - 11.2.2.9: v = IR/alpha_comp (K^4)
+        int64_t v = (((ir * invalpha[i]) >> 12) * iKsTa) >> 16;
+        int64_t s = v + Tar;
+        int32_t r1 = root4((s > 0) ? (uint64_t)s : 1);
+        int64_t den = K1 + ((KsTo1 * r1) >> 26);
+        int32_t To = root4(To4(v, den, Tar)) - Q_T0;
+        if(simpleimage == 2 && (To <= CT0 || To > CT1)){ // 11.2.2.9.1.3. Extended To range calculation
+            int idx = 0;
+            int32_t ctx = -40 * (1<<16);
+            if(To > CT2){ idx = 3; ctx = CT2; }
+            else if(To > CT1){ idx = 2; ctx = CT1; }
+            den = (1LL<<30) + ((params->q_KsTo[idx] * (To - ctx)) >> 26);
+            den = ((int64_t)params->q_alphacorr[idx] * den) >> 30;
+            To = root4(To4(v, den, Tar)) - Q_T0;
+        }
+        image[pidx[i]] = To;
+    }
+    return TRUE;
+}
+#endif
+
 #if 0
 // start image acquiring for next subpage
 static int process_startima(int subpageno){
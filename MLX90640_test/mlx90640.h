@@ -30,6 +30,11 @@ typedef double fp_t;
 #define MLX_PIXNO           (MLX_W*MLX_H)
 // pixels + service data
 #define MLX_PIXARRSZ        (MLX_PIXNO + 64)
+// amount of pixels in each subpage
+#define MLX_SPPIXNO         (MLX_PIXNO/2)
+// alignment of local per-pixel buffers (for SIMD); structures have no alignment
+// requirements, so they can be allocated by plain malloc
+#define MLX_ALIGN           __attribute__((aligned(32)))
 
 typedef struct{
     int16_t kVdd;
@@ -54,14 +59,50 @@ typedef struct{
     uint8_t resolEE; // resolution_EE
     int16_t cpOffset[2];
     uint8_t outliers[MLX_PIXNO]; // outliers - bad pixels (if == 1)
+    // frame-invariant data of each subpage for `process_subpage_to` (filled by `mlx_prepare`)
+    uint16_t sp_idx[2][MLX_SPPIXNO];            // indexes of subpage pixels in image
+    fp_t sp_offset[2][MLX_SPPIXNO];             // offset
+    fp_t sp_offkta[2][MLX_SPPIXNO];             // offset*kta
+    fp_t sp_kv[2][MLX_SPPIXNO];                 // kv of pixel
+    fp_t sp_alpha[2][MLX_SPPIXNO];              // alpha - tgc*cpAlpha
+#ifdef MLX_FIXEDPOINT
+    // the same for `process_subpage_q`
+    int32_t q_offset[2][MLX_SPPIXNO];           // offset, Q12
+    int32_t q_offkta[2][MLX_SPPIXNO];           // offset*kta, Q12
+    int32_t q_kv[2][MLX_SPPIXNO];               // kv, Q16
+    uint32_t q_invalpha[2][MLX_SPPIXNO];        // 1/(alpha - tgc*cpAlpha)
+    int64_t q_KsTo[4];                          // KsTo, Q40
+    int32_t q_K1;                               // 1 - 273.15*KsTo[1], Q30
+    int32_t q_alphacorr[4];                     // Q30
+    int32_t q_CT[3];                            // Q16
+    int32_t q_alphaPTAT;                        // Q16
+    int32_t q_KvPTAT;                           // Q30
+    int32_t q_KtPTAT;                           // Q16
+    int32_t q_cpKta;                            // Q30
+    int32_t q_cpKv;                             // Q24
+    int32_t q_tgc;                              // Q20
+    int32_t q_KsTa;                             // Q30
+#endif
 } MLX90640_params;
 
+#ifdef MLX_FIXEDPOINT
+// fixed-point temperatures (Q16.16) for targets without FPU
+typedef int32_t mlxq_t;
+#define MLXQ_FRAC           (16)
+#define MLXQ2FP(x)          ((fp_t)(x) / (fp_t)(1<<MLXQ_FRAC))
+#endif
+
 // full amount of IMAGE data + EXTRA data (counts of uint16_t!)
 #define MLX_DMA_MAXLEN      (834)
 
 int get_parameters(const uint16_t dataarray[MLX_DMA_MAXLEN], MLX90640_params *params);
 void dump_parameters(MLX90640_params *params, const MLX90640_params *standard);
+void mlx_prepare(MLX90640_params *params);
 fp_t *process_subpage(MLX90640_params *params, const int16_t Frame[MLX_DMA_MAXLEN], int subpageno, int simpleimage);
+#ifdef MLX_FIXEDPOINT
+int process_subpage_q(const MLX90640_params *params, const int16_t Frame[MLX_DMA_MAXLEN], int subpageno, int simpleimage, mlxq_t image[MLX_PIXNO]);
+#endif
+int process_subpage_to(const MLX90640_params *params, const int16_t Frame[MLX_DMA_MAXLEN], int subpageno, int simpleimage, fp_t image[MLX_PIXNO]);
 void chkImage(const fp_t Image[MLX_PIXNO], const fp_t ToFrame[MLX_PIXNO]);
 void dumpIma(const fp_t im[MLX_PIXNO]);
 void drawIma(const fp_t im[MLX_PIXNO]);
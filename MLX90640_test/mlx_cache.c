@@ -0,0 +1,205 @@
+/*
+ * This file is part of the mlxtest project.
+ * Copyright 2025 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <usefull_macros.h>
+
+#include "mlx_cache.h"
+#include "mlx90640_regs.h"
+
+#define CACHE_MAGIC     "MLXC"
+// change it on any change of `MLX90640_params` or processing of EEPROM
+#define CACHE_VERSION   (3)
+// offset of parameters in file (mapping is page-aligned, so parameters are aligned too)
+#define CACHE_PARAMOFF  ((sizeof(cachehdr) + 63) & ~(size_t)63)
+#define CACHE_LEN       (CACHE_PARAMOFF + sizeof(MLX90640_params))
+
+// header of cache file
+typedef struct{
+    char magic[4];
+    uint32_t version;
+    uint32_t paramsz;           // sizeof(MLX90640_params)
+    uint32_t fpsz;              // sizeof(fp_t)
+    uint64_t eechksum;          // checksum of EEPROM
+    uint64_t parchksum;         // checksum of parameters
+    uint16_t eeprom[REG_CALIDATA_LEN]; // raw EEPROM
+} cachehdr;
+
+// FNV-1a
+static uint64_t fnv1a(const void *data, size_t len){
+    const uint8_t *d = (const uint8_t*) data;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for(size_t i = 0; i < len; ++i){
+        h ^= d[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief mlxc_chksum - checksum of EEPROM part of `dataarray` (key of cache)
+ */
+uint64_t mlxc_chksum(const uint16_t dataarray[MLX_DMA_MAXLEN]){
+    return fnv1a(dataarray, REG_CALIDATA_LEN * sizeof(uint16_t));
+}
+
+/**
+ * @brief check_map - check mapped cache file
+ * @return TRUE if it's made from the same EEPROM and isn't corrupted
+ */
+static int check_map(const uint8_t *map, size_t len, uint64_t chksum, const uint16_t dataarray[MLX_DMA_MAXLEN]){
+    if(len != CACHE_LEN) return FALSE;
+    const cachehdr *h = (const cachehdr*) map;
+    if(memcmp(h->magic, CACHE_MAGIC, 4) || h->version != CACHE_VERSION ||
+       h->paramsz != sizeof(MLX90640_params) || h->fpsz != sizeof(fp_t)) return FALSE;
+    if(h->eechksum != chksum) return FALSE;
+    // checksum could collide: compare full EEPROM
+    if(memcmp(h->eeprom, dataarray, sizeof(h->eeprom))){
+        WARNX("Calibration cache: EEPROM mismatch with the same checksum");
+        return FALSE;
+    }
+    if(h->parchksum != fnv1a(map + CACHE_PARAMOFF, sizeof(MLX90640_params))){
+        WARNX("Calibration cache: parameters are corrupted");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief map_file - map file `name` read-only
+ * @return pointer to mapped data or NULL
+ */
+static void *map_file(const char *name, size_t *len){
+    int fd = open(name, O_RDONLY);
+    if(fd < 0) return NULL;
+    struct stat st;
+    void *map = NULL;
+    if(fstat(fd, &st) == 0 && st.st_size > 0){
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if(map == MAP_FAILED) map = NULL;
+        else *len = st.st_size;
+    }
+    close(fd);
+    return map;
+}
+
+/**
+ * @brief write_cache - decode EEPROM and write new cache file
+ * @return FALSE if failed
+ */
+static int write_cache(const char *name, uint64_t chksum, const uint16_t dataarray[MLX_DMA_MAXLEN]){
+    // write into temporary file & rename it, so other processes never see partial file
+    char tmpname[PATH_MAX];
+    if(snprintf(tmpname, PATH_MAX, "%s.XXXXXX", name) >= PATH_MAX){
+        WARNX("Too long cache file name %s", name);
+        return FALSE;
+    }
+    uint8_t *buf;
+    if(posix_memalign((void**)&buf, 64, CACHE_LEN)) return FALSE;
+    memset(buf, 0, CACHE_LEN);
+    MLX90640_params *p = (MLX90640_params*)(buf + CACHE_PARAMOFF);
+    if(!get_parameters(dataarray, p)){
+        WARNX("Can't get parameters from EEPROM");
+        FREE(buf);
+        return FALSE;
+    }
+    cachehdr *h = (cachehdr*) buf;
+    memcpy(h->magic, CACHE_MAGIC, 4);
+    h->version = CACHE_VERSION;
+    h->paramsz = sizeof(MLX90640_params);
+    h->fpsz = sizeof(fp_t);
+    h->eechksum = chksum;
+    h->parchksum = fnv1a(p, sizeof(MLX90640_params));
+    memcpy(h->eeprom, dataarray, sizeof(h->eeprom));
+    int ret = FALSE, fd = mkstemp(tmpname);
+    if(fd < 0){
+        WARN("mkstemp(%s)", tmpname);
+        FREE(buf);
+        return FALSE;
+    }
+    ssize_t l = write(fd, buf, CACHE_LEN);
+    if(l == (ssize_t)CACHE_LEN && fchmod(fd, 0644) == 0 && close(fd) == 0){
+        if(rename(tmpname, name) == 0) ret = TRUE;
+        else WARN("rename(%s)", name);
+    }else{
+        WARN("write(%s)", tmpname);
+        close(fd);
+    }
+    if(!ret) unlink(tmpname);
+    FREE(buf);
+    return ret;
+}
+
+/**
+ * @brief mlxc_open - get calibration parameters from cache (make cache file if absent or invalid)
+ * @param dir - directory of cache files
+ * @param dataarray - EEPROM data read from sensor
+ * @return calibration (free it by `mlxc_close`) or NULL if failed
+ */
+mlx_calib *mlxc_open(const char *dir, const uint16_t dataarray[MLX_DMA_MAXLEN]){
+    if(!dir || !dataarray) return NULL;
+    uint64_t chksum = mlxc_chksum(dataarray);
+    char name[PATH_MAX];
+    if(snprintf(name, PATH_MAX, "%s/mlx90640_%016llx_%zu_%zu.cal", dir, (unsigned long long)chksum,
+                sizeof(fp_t), sizeof(MLX90640_params)) >= PATH_MAX - 8){
+        WARNX("Too long path: %s", dir);
+        return NULL;
+    }
+    int fromcache = TRUE;
+    size_t len = 0;
+    void *map = map_file(name, &len);
+    if(map && !check_map(map, len, chksum, dataarray)){
+        munmap(map, len);
+        map = NULL;
+    }
+    if(!map){ // absent or invalid: make new
+        fromcache = FALSE;
+        if(!write_cache(name, chksum, dataarray)) return NULL;
+        map = map_file(name, &len);
+        if(!map || !check_map(map, len, chksum, dataarray)){
+            WARNX("Can't map calibration cache %s", name);
+            if(map) munmap(map, len);
+            return NULL;
+        }
+    }
+    mlx_calib *c = MALLOC(mlx_calib, 1);
+    c->params = (const MLX90640_params*)((uint8_t*)map + CACHE_PARAMOFF);
+    c->chksum = chksum;
+    c->filename = strdup(name);
+    c->fromcache = fromcache;
+    c->map = map;
+    c->maplen = len;
+    return c;
+}
+
+/**
+ * @brief mlxc_close - unmap cache file & free calibration
+ */
+void mlxc_close(mlx_calib **c){
+    if(!c || !*c) return;
+    munmap((*c)->map, (*c)->maplen);
+    FREE((*c)->filename);
+    FREE(*c);
+}
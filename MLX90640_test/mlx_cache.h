@@ -0,0 +1,42 @@
+/*
+ * This file is part of the mlxtest project.
+ * Copyright 2025 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mlx90640.h"
+
+// binary cache of calibration parameters: file `<dir>/mlx90640_<checksum>_<sizeof(fp_t)>_<sizeof(params)>.cal`
+// keeps raw EEPROM and `MLX90640_params` made from it (builds with different `fp_t` or parameters
+// have own files); file is mapped read-only, so any amount of processes share one copy of
+// parameters and don't need to decode EEPROM on start
+
+typedef struct{
+    const MLX90640_params *params;  // parameters (read-only, inside mapped file)
+    uint64_t chksum;                // checksum of EEPROM
+    char *filename;                 // cache file
+    int fromcache;                  // TRUE if parameters were taken from existing file
+    void *map;                      // mapped file
+    size_t maplen;                  // and its length
+} mlx_calib;
+
+uint64_t mlxc_chksum(const uint16_t dataarray[MLX_DMA_MAXLEN]);
+mlx_calib *mlxc_open(const char *dir, const uint16_t dataarray[MLX_DMA_MAXLEN]);
+void mlxc_close(mlx_calib **c);
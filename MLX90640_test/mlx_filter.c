@@ -0,0 +1,111 @@
+/*
+ * This file is part of the mlxtest project.
+ * Copyright 2025 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <float.h>
+#include <string.h>
+
+#include "mlx_filter.h"
+
+/**
+ * @brief mlxf_init - init filter
+ * @param f - filter
+ * @param params - sensor parameters (for list of bad pixels), may be NULL
+ * @param Q - process noise variance (how fast temperature can change between frames), K^2
+ * @param R - measurement noise variance, K^2 (Q == 0 - no temporal filtering)
+ * @param gate - gate of innovation in sigmas (<= 0 - no gating)
+ */
+void mlxf_init(mlx_filter *f, const MLX90640_params *params, fp_t Q, fp_t R, fp_t gate){
+    f->Q = Q;
+    f->R = R;
+    f->gate2 = (gate > 0.) ? gate * gate : DBL_MAX;
+    f->nframes = 0;
+    f->nbad = 0;
+    if(!params) return;
+    // bad pixels and their good neighbours (4 nearest first, then diagonal)
+    static const int d[MLXF_MAXNBRS][2] = {{-1,0}, {1,0}, {0,-1}, {0,1}, {-1,-1}, {1,-1}, {-1,1}, {1,1}};
+    for(int y = 0, pixno = 0; y < MLX_H; ++y){
+        for(int x = 0; x < MLX_W; ++x, ++pixno){
+            if(params->outliers[pixno] != 1) continue;
+            int n = f->nbad++;
+            f->bad[n] = pixno;
+            f->nnbrs[n] = 0;
+            for(int i = 0; i < MLXF_MAXNBRS; ++i){
+                if(i == 4 && f->nnbrs[n]) break; // diagonal neighbours only if there's no nearest
+                int xx = x + d[i][0], yy = y + d[i][1];
+                if(xx < 0 || xx >= MLX_W || yy < 0 || yy >= MLX_H) continue;
+                int idx = yy * MLX_W + xx;
+                if(params->outliers[idx] == 1) continue;
+                f->nbrs[n][f->nnbrs[n]++] = idx;
+            }
+        }
+    }
+}
+
+/**
+ * @brief mlxf_reset - forget estimates (e.g. after change of sensor settings)
+ */
+void mlxf_reset(mlx_filter *f){
+    f->nframes = 0;
+}
+
+/**
+ * @brief mlxf_interpolate - replace bad pixels by mean of their good neighbours
+ *        (pixels without good neighbours are left as is)
+ */
+void mlxf_interpolate(const mlx_filter *f, fp_t image[MLX_PIXNO]){
+    for(int n = 0; n < f->nbad; ++n){
+        int nn = f->nnbrs[n];
+        if(!nn) continue;
+        fp_t s = 0.;
+        for(int i = 0; i < nn; ++i) s += image[f->nbrs[n][i]];
+        image[f->bad[n]] = s / nn;
+    }
+}
+
+/**
+ * @brief mlxf_temporal - Kalman filtering of each pixel, `image` is replaced by estimates
+ */
+void mlxf_temporal(mlx_filter *f, fp_t image[MLX_PIXNO]){
+    if(f->Q <= 0.) return;
+    fp_t *restrict x = f->x, *restrict P = f->P;
+    const fp_t Q = f->Q, R = f->R, gate2 = f->gate2;
+    if(f->nframes++ == 0){ // first frame: estimate is measurement itself
+        memcpy(x, image, sizeof(f->x));
+        #pragma omp simd
+        for(int i = 0; i < MLX_PIXNO; ++i) P[i] = R;
+        return;
+    }
+    #pragma omp simd
+    for(int i = 0; i < MLX_PIXNO; ++i){
+        fp_t z = image[i], d = z - x[i], Pp = P[i] + Q, S = Pp + R;
+        fp_t K = Pp / S;
+        int restart = d*d > gate2 * S;
+        fp_t xn = x[i] + K * d, Pn = (1. - K) * Pp;
+        x[i] = restart ? z : xn;
+        P[i] = restart ? R : Pn;
+        image[i] = x[i];
+    }
+}
+
+/**
+ * @brief mlxf_apply - full post-processing: interpolation of bad pixels & temporal filtering
+ */
+void mlxf_apply(mlx_filter *f, fp_t image[MLX_PIXNO]){
+    mlxf_interpolate(f, image);
+    mlxf_temporal(f, image);
+}
@@ -0,0 +1,51 @@
+/*
+ * This file is part of the mlxtest project.
+ * Copyright 2025 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "mlx90640.h"
+
+// post-processing of full images (in-place, without allocations):
+// - bad pixels (`outliers` of parameters) are replaced by mean of good neighbours;
+// - each pixel is filtered by scalar Kalman filter (random walk model) with gating:
+//   if new value differs from estimate more than `gate` sigmas, filter restarts
+//   from this value, so real changes of scene aren't smoothed
+
+// max amount of neighbours of pixel
+#define MLXF_MAXNBRS        (8)
+// default gate (in sigmas)
+#define MLXF_GATE           (4.)
+
+typedef struct{
+    fp_t x[MLX_PIXNO];                  // estimates
+    fp_t P[MLX_PIXNO];                  // their variances
+    fp_t Q;                             // process noise variance (per frame)
+    fp_t R;                             // measurement noise variance
+    fp_t gate2;                         // gate^2
+    int nframes;                        // frames filtered (0 - no estimates yet)
+    int nbad;                           // amount of bad pixels
+    uint16_t bad[MLX_PIXNO];            // their indexes
+    uint8_t nnbrs[MLX_PIXNO];           // amount of good neighbours of each bad pixel
+    uint16_t nbrs[MLX_PIXNO][MLXF_MAXNBRS]; // their indexes
+} mlx_filter;
+
+void mlxf_init(mlx_filter *f, const MLX90640_params *params, fp_t Q, fp_t R, fp_t gate);
+void mlxf_reset(mlx_filter *f);
+void mlxf_interpolate(const mlx_filter *f, fp_t image[MLX_PIXNO]);
+void mlxf_temporal(mlx_filter *f, fp_t image[MLX_PIXNO]);
+void mlxf_apply(mlx_filter *f, fp_t image[MLX_PIXNO]);
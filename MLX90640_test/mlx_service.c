@@ -0,0 +1,276 @@
+/*
+ * This file is part of the mlxtest project.
+ * Copyright 2025 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <usefull_macros.h>
+
+#include "mlx_service.h"
+
+// raw subpage in ring
+typedef struct{
+    int subpageno;
+    double timestamp;
+    int16_t data[MLX_DMA_MAXLEN];
+} rawsubpage;
+
+// sensor's data
+typedef struct{
+    // ring: `head` is written only by producer, `tail` - only by worker
+    rawsubpage *ring;
+    uint32_t mask;              // ring size - 1
+    uint32_t head;              // next slot to write
+    uint32_t tail;              // next slot to read
+    MLX90640_params *params;    // parameters (NULL - sensor isn't ready)
+    mlx_filter *filter;         // post-processing (or NULL)
+    mlx_frame work;             // frame in processing
+    uint8_t got;                // bit mask of got subpages
+    mlx_frame last;             // last published frame
+    pthread_mutex_t lastmutex;  // mutex for `last`
+    mlxs_stat stat;
+    int worker;                 // number of worker
+} mlxsensor;
+
+// worker thread
+typedef struct{
+    pthread_t thread;
+    sem_t sem;                  // posted for each pushed subpage
+    mlx_service *s;
+    int no;
+    int next;                   // sensor to check first (round robin)
+} worker;
+
+struct mlx_service{
+    int nsensors;
+    int nworkers;
+    int simpleimage;            // mode of `process_subpage_to`
+    mlxsensor *sensors;
+    worker *workers;
+    mlxs_callback cb;
+    void *cbarg;
+    volatile int stop;          // == 1 to stop workers
+};
+
+#define LOAD(x)         __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define STORE(x, v)     __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#define INCR(x)         __atomic_fetch_add(&(x), 1, __ATOMIC_RELAXED)
+
+/**
+ * @brief process_raw - process subpage from ring and publish frame if both subpages are ready
+ */
+static void process_raw(mlx_service *s, int n, mlxsensor *sn, rawsubpage *raw){
+    if(!process_subpage_to(sn->params, raw->data, raw->subpageno, s->simpleimage, sn->work.image)) return;
+    sn->got |= 1 << raw->subpageno;
+    if(sn->got != 3) return;
+    sn->got = 0;
+    sn->work.sensor = n;
+    sn->work.timestamp = raw->timestamp;
+    pthread_mutex_lock(&sn->lastmutex);
+    memcpy(&sn->last, &sn->work, sizeof(mlx_frame));
+    if(sn->filter) mlxf_apply(sn->filter, sn->last.image);
+    pthread_mutex_unlock(&sn->lastmutex);
+    ++sn->work.seq;
+    INCR(sn->stat.frames);
+    if(s->cb) s->cb(&sn->last, s->cbarg);
+}
+
+static void *worker_thread(void *arg){
+    worker *w = (worker*) arg;
+    mlx_service *s = w->s;
+    while(1){
+        sem_wait(&w->sem);
+        if(s->stop) break;
+        // find subpage in rings of this worker's sensors
+        for(int i = 0; i < s->nsensors; i += s->nworkers){
+            int n = w->next;
+            w->next += s->nworkers;
+            if(w->next >= s->nsensors) w->next = w->no;
+            mlxsensor *sn = &s->sensors[n];
+            uint32_t tail = sn->tail;
+            if(tail == LOAD(sn->head)) continue;
+            process_raw(s, n, sn, &sn->ring[tail & sn->mask]);
+            STORE(sn->tail, tail + 1); // now producer can reuse this slot
+            INCR(sn->stat.processed);
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief mlxs_new - create processing service
+ * @param nsensors - amount of sensors
+ * @param nworkers - amount of worker threads (not more than nsensors)
+ * @param ringsize - amount of raw subpages in ring of each sensor (rounded up to power of 2)
+ * @param simpleimage - mode of processing (like in `process_subpage`)
+ * @param cb - callback for ready frames (or NULL)
+ * @param arg - its argument
+ * @return service or NULL if failed
+ */
+mlx_service *mlxs_new(int nsensors, int nworkers, int ringsize, int simpleimage, mlxs_callback cb, void *arg){
+    if(nsensors < 1 || nworkers < 1 || ringsize < 2) return NULL;
+    if(nworkers > nsensors) nworkers = nsensors;
+    uint32_t rsz = 2;
+    while(rsz < (uint32_t)ringsize) rsz <<= 1;
+    mlx_service *s = MALLOC(mlx_service, 1);
+    s->nsensors = nsensors;
+    s->nworkers = nworkers;
+    s->simpleimage = simpleimage;
+    s->cb = cb;
+    s->cbarg = arg;
+    s->sensors = MALLOC(mlxsensor, nsensors);
+    for(int i = 0; i < nsensors; ++i){
+        mlxsensor *sn = &s->sensors[i];
+        sn->ring = MALLOC(rawsubpage, rsz);
+        sn->mask = rsz - 1;
+        sn->worker = i % nworkers;
+        pthread_mutex_init(&sn->lastmutex, NULL);
+    }
+    s->workers = MALLOC(worker, nworkers);
+    for(int i = 0; i < nworkers; ++i){
+        worker *w = &s->workers[i];
+        w->s = s;
+        w->no = w->next = i;
+        sem_init(&w->sem, 0, 0);
+        if(pthread_create(&w->thread, NULL, worker_thread, w)){
+            WARN("pthread_create()");
+            s->nworkers = i;
+            mlxs_free(&s);
+            return NULL;
+        }
+    }
+    return s;
+}
+
+/**
+ * @brief mlxs_set_params - set parameters of sensor (should be called before pushing its data)
+ * @return FALSE if sensor number is wrong or sensor already have parameters
+ */
+int mlxs_set_params(mlx_service *s, int sensor, const MLX90640_params *params){
+    if(!s || !params || sensor < 0 || sensor >= s->nsensors) return FALSE;
+    if(s->sensors[sensor].params) return FALSE;
+    MLX90640_params *p = MALLOC(MLX90640_params, 1);
+    memcpy(p, params, sizeof(MLX90640_params));
+    STORE(s->sensors[sensor].params, p);
+    return TRUE;
+}
+
+/**
+ * @brief mlxs_set_filter - turn on post-processing of sensor's frames (call it after `mlxs_set_params`
+ *        and before pushing data); parameters are the same as of `mlxf_init`
+ * @return FALSE if sensor number is wrong, it have no parameters or filter is already set
+ */
+int mlxs_set_filter(mlx_service *s, int sensor, fp_t Q, fp_t R, fp_t gate){
+    if(!s || sensor < 0 || sensor >= s->nsensors) return FALSE;
+    mlxsensor *sn = &s->sensors[sensor];
+    if(!sn->params || sn->filter) return FALSE;
+    mlx_filter *f = MALLOC(mlx_filter, 1);
+    mlxf_init(f, sn->params, Q, R, gate);
+    STORE(sn->filter, f);
+    return TRUE;
+}
+
+/**
+ * @brief mlxs_push - put raw subpage of sensor into its ring (only one thread can push data of each sensor)
+ * @param Frame - data read from sensor
+ * @param subpageno - its subpage number
+ * @param timestamp - time of data reading
+ * @return FALSE if ring is full (subpage is dropped) or sensor isn't ready
+ */
+int mlxs_push(mlx_service *s, int sensor, const int16_t Frame[MLX_DMA_MAXLEN], int subpageno, double timestamp){
+    if(!s || sensor < 0 || sensor >= s->nsensors) return FALSE;
+    mlxsensor *sn = &s->sensors[sensor];
+    uint32_t head = sn->head;
+    if(!LOAD(sn->params) || subpageno < 0 || subpageno > 1 || head - LOAD(sn->tail) > sn->mask){
+        INCR(sn->stat.dropped);
+        return FALSE;
+    }
+    rawsubpage *r = &sn->ring[head & sn->mask];
+    memcpy(r->data, Frame, sizeof(r->data));
+    r->subpageno = subpageno;
+    r->timestamp = timestamp;
+    STORE(sn->head, head + 1);
+    INCR(sn->stat.pushed);
+    sem_post(&s->workers[sn->worker].sem);
+    return TRUE;
+}
+
+/**
+ * @brief mlxs_last - get copy of last full frame of sensor
+ * @return FALSE if there's no frames yet
+ */
+int mlxs_last(mlx_service *s, int sensor, mlx_frame *frame){
+    if(!s || !frame || sensor < 0 || sensor >= s->nsensors) return FALSE;
+    mlxsensor *sn = &s->sensors[sensor];
+    if(!LOAD(sn->stat.frames)) return FALSE;
+    pthread_mutex_lock(&sn->lastmutex);
+    memcpy(frame, &sn->last, sizeof(mlx_frame));
+    pthread_mutex_unlock(&sn->lastmutex);
+    return TRUE;
+}
+
+/**
+ * @brief mlxs_flush - wait until all pushed subpages are processed
+ */
+void mlxs_flush(mlx_service *s){
+    if(!s) return;
+    for(int i = 0; i < s->nsensors; ++i){
+        mlxsensor *sn = &s->sensors[i];
+        while(LOAD(sn->tail) != LOAD(sn->head)) usleep(100);
+    }
+}
+
+/**
+ * @brief mlxs_stats - get statistics of sensor
+ * @return FALSE if sensor number is wrong
+ */
+int mlxs_stats(mlx_service *s, int sensor, mlxs_stat *st){
+    if(!s || !st || sensor < 0 || sensor >= s->nsensors) return FALSE;
+    mlxs_stat *ss = &s->sensors[sensor].stat;
+    st->pushed = LOAD(ss->pushed);
+    st->dropped = LOAD(ss->dropped);
+    st->processed = LOAD(ss->processed);
+    st->frames = LOAD(ss->frames);
+    return TRUE;
+}
+
+/**
+ * @brief mlxs_free - stop workers & free service (unprocessed subpages are lost)
+ */
+void mlxs_free(mlx_service **s){
+    if(!s || !*s) return;
+    mlx_service *S = *s;
+    S->stop = 1;
+    for(int i = 0; i < S->nworkers; ++i) sem_post(&S->workers[i].sem);
+    for(int i = 0; i < S->nworkers; ++i){
+        pthread_join(S->workers[i].thread, NULL);
+        sem_destroy(&S->workers[i].sem);
+    }
+    for(int i = 0; i < S->nsensors; ++i){
+        FREE(S->sensors[i].ring);
+        FREE(S->sensors[i].params);
+        FREE(S->sensors[i].filter);
+        pthread_mutex_destroy(&S->sensors[i].lastmutex);
+    }
+    FREE(S->sensors);
+    FREE(S->workers);
+    FREE(*s);
+}
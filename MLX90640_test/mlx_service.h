@@ -0,0 +1,63 @@
+/*
+ * This file is part of the mlxtest project.
+ * Copyright 2025 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "mlx90640.h"
+#include "mlx_filter.h"
+
+// processing service for several sensors: raw subpages from each sensor are put into
+// its own lock-free single-producer/single-consumer ring, rings are served by pool of
+// workers (each sensor belongs to one worker, so subpages of sensor are processed in order),
+// full frames (both subpages merged, optionally post-processed by `mlx_filter`) are
+// published to consumer's callback
+
+// default amount of raw subpages in ring of each sensor
+#define MLXS_RINGSZ         (8)
+
+// full processed frame
+typedef struct{
+    int sensor;                 // sensor number
+    uint32_t seq;               // frame number for this sensor
+    double timestamp;           // timestamp of last subpage
+    fp_t image[MLX_PIXNO];      // temperatures
+} mlx_frame;
+
+// statistics of sensor
+typedef struct{
+    uint64_t pushed;            // subpages put into ring
+    uint64_t dropped;           // subpages dropped (ring is full or no parameters)
+    uint64_t processed;         // subpages processed
+    uint64_t frames;            // full frames published
+} mlxs_stat;
+
+// callback for ready frames (called from worker thread, `frame` is valid only inside callback)
+typedef void (*mlxs_callback)(const mlx_frame *frame, void *arg);
+
+typedef struct mlx_service mlx_service;
+
+mlx_service *mlxs_new(int nsensors, int nworkers, int ringsize, int simpleimage, mlxs_callback cb, void *arg);
+int mlxs_set_params(mlx_service *s, int sensor, const MLX90640_params *params);
+int mlxs_set_filter(mlx_service *s, int sensor, fp_t Q, fp_t R, fp_t gate);
+int mlxs_push(mlx_service *s, int sensor, const int16_t Frame[MLX_DMA_MAXLEN], int subpageno, double timestamp);
+int mlxs_last(mlx_service *s, int sensor, mlx_frame *frame);
+void mlxs_flush(mlx_service *s);
+int mlxs_stats(mlx_service *s, int sensor, mlxs_stat *st);
+void mlxs_free(mlx_service **s);
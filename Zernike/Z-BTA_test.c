@@ -191,7 +191,8 @@ int main(int argc, char **argv){
 		h_free(&images[0]);
 		h_free(&images[1]);
 	}else{
-//		L = read_gradients(gradname, &coords, &grads, &scale);
+		double scale;
+		L = read_gradients(gradname, &coords, &grads, &scale);
 	}
 /*
 	// spots information
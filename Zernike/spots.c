@@ -28,6 +28,7 @@
 #include <string.h>
 #include <assert.h>
 #include <math.h>
+#include <stdlib.h>
 #include "spots.h"
 
 #define MM_TO_ARCSEC(x)  (x*206265./FOCAL_R)
@@ -83,6 +84,265 @@ void spots_free(List **spots){
 	listfree_function(NULL);
 }
 
+/*
+ * Fast text parser: works straight on mmap'ed buffer (it have no trailing zero),
+ * each line is parsed in its bounds [pos, eol)
+ */
+static inline bool isblank_(char c){
+	return (c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f');
+}
+
+static inline const char *skip_blanks(const char *p, const char *eol){
+	while(p < eol && isblank_(*p)) ++p;
+	return p;
+}
+
+/**
+ * Skip next token (like "%*s" of scanf)
+ * @param pos (io) - current position
+ * @param eol      - end of line
+ * @return false if there's no more tokens
+ */
+static inline bool skip_token(const char **pos, const char *eol){
+	const char *p = skip_blanks(*pos, eol);
+	if(p == eol) return false;
+	while(p < eol && !isblank_(*p)) ++p;
+	*pos = p;
+	return true;
+}
+
+/**
+ * Read integer number (like "%d" of scanf)
+ * @param pos (io) - current position (moved after number)
+ * @param eol      - end of line
+ * @param val (o)  - result
+ * @return false if there's no number at pos
+ */
+static inline bool get_int(const char **pos, const char *eol, int *val){
+	const char *p = skip_blanks(*pos, eol);
+	bool neg = false;
+	if(p < eol && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+	if(p == eol || *p < '0' || *p > '9') return false;
+	long v = 0;
+	while(p < eol && *p >= '0' && *p <= '9') v = v*10 + (*p++ - '0');
+	*val = (int)(neg ? -v : v);
+	*pos = p;
+	return true;
+}
+
+// exact powers of 10 in double
+static const double pow10tab[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+	1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/**
+ * Convert number by strtod (nan, inf, hex, long mantissa etc.): token is copied
+ * because mmap'ed buffer have no trailing zero and strtod could go out of it
+ * @param start   - beginning of number
+ * @param eol     - end of line
+ * @param end (o) - first character after number
+ * @return false if there's no number at start
+ */
+static bool strtod_(const char *start, const char *eol, const char **end, double *val){
+	const char *e = start;
+	while(e < eol && !isblank_(*e)) ++e;
+	size_t l = e - start;
+	char sbuf[128], *buf = (l < sizeof(sbuf)) ? sbuf : MALLOC(char, l + 1), *ep;
+	memcpy(buf, start, l);
+	buf[l] = 0;
+	*val = strtod(buf, &ep);
+	l = ep - buf;
+	if(buf != sbuf) FREE(buf);
+	if(!l) return false;
+	*end = start + l;
+	return true;
+}
+
+/**
+ * Read floating point number (like "%lf" of scanf)
+ * Mantissa < 2^53 with |exponent| <= 22 gives exact result by one multiplication
+ * or division, other numbers are converted by strtod
+ * @param pos (io) - current position (moved after number)
+ * @param eol      - end of line
+ * @param val (o)  - result
+ * @return false if there's no number at pos
+ */
+static inline bool get_double(const char **pos, const char *eol, double *val){
+	const char *p = skip_blanks(*pos, eol), *start = p;
+	bool neg = false, digits = false, exact = true;
+	uint64_t mant = 0;
+	int ex = 0;
+	if(p < eol && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+	for(; p < eol && *p >= '0' && *p <= '9'; ++p){
+		digits = true;
+		if(mant < (1ULL << 53)) mant = mant*10 + (*p - '0');
+		else{ exact = false; ++ex; }
+	}
+	if(p < eol && *p == '.'){
+		for(++p; p < eol && *p >= '0' && *p <= '9'; ++p){
+			digits = true;
+			if(mant < (1ULL << 53)){ mant = mant*10 + (*p - '0'); --ex; }
+			else exact = false;
+		}
+	}
+	if(digits && p < eol && (*p == 'e' || *p == 'E')){
+		const char *q = p + 1;
+		bool eneg = false;
+		int e = 0;
+		if(q < eol && (*q == '-' || *q == '+')) eneg = (*q++ == '-');
+		if(q < eol && *q >= '0' && *q <= '9'){
+			for(; q < eol && *q >= '0' && *q <= '9'; ++q) if(e < 10000) e = e*10 + (*q - '0');
+			ex += eneg ? -e : e;
+			p = q;
+		}
+	}
+	// not a plain decimal number (or something like "0x1p3" follows digits)
+	if(!digits || !exact || mant >= (1ULL << 53) || ex < -22 || ex > 22 || (p < eol && !isblank_(*p)))
+		return strtod_(start, eol, pos, val);
+	double v = (double)mant;
+	v = (ex < 0) ? v / pow10tab[-ex] : v * pow10tab[ex];
+	*val = neg ? -v : v;
+	*pos = p;
+	return true;
+}
+
+/**
+ * Count lines in buffer (upper bound of records amount)
+ */
+static size_t count_lines(const char *data, size_t len){
+	const char *pos = data, *end = data + len;
+	size_t N = 1;
+	while(pos < end && (pos = memchr(pos, '\n', end - pos))){ ++N; ++pos; }
+	return N;
+}
+
+/**
+ * Check whether mmap'ed file is binary spots/gradients file
+ * @param M (i)   - file
+ * @param magic   - SPOTS_MAGIC or GRADS_MAGIC
+ * @param recsize - size of record
+ * @return pointer to header or NULL
+ */
+static binhdr *check_bin(mmapbuf *M, const char *magic, size_t recsize){
+	if(M->len < sizeof(binhdr)) return NULL;
+	binhdr *hdr = (binhdr*)M->data;
+	if(memcmp(hdr->magic, magic, 4) || hdr->recsize != recsize) return NULL;
+	if((M->len - sizeof(binhdr)) / recsize < hdr->N)
+		ERRX(_("Binary file is truncated"));
+	return hdr;
+}
+
+/**
+ * Get records from spots-file: text (columns: id, 4 unused, x, y) or binary
+ * @param M (i)    - mmap'ed file
+ * @param recs (o) - array of records (for binary file it points into M)
+ * @param own (o)  - true if *recs was allocated here and should be freed
+ * @return amount of records
+ */
+static size_t get_spot_recs(mmapbuf *M, spot_rec **recs, bool *own){
+	binhdr *hdr = check_bin(M, SPOTS_MAGIC, sizeof(spot_rec));
+	if(hdr){
+		*recs = (spot_rec*)(hdr + 1);
+		*own = false;
+		return hdr->N;
+	}
+	spot_rec *r = MALLOC(spot_rec, count_lines(M->data, M->len));
+	size_t N = 0;
+	const char *pos = M->data, *end = pos + M->len;
+	while(pos < end){
+		const char *eol = memchr(pos, '\n', end - pos), *p = pos;
+		if(!eol) eol = end;
+		pos = eol + 1;
+		int id, i;
+		if(!get_int(&p, eol, &id)) continue;
+		for(i = 0; i < 4; i++) if(!skip_token(&p, eol)) break;
+		if(i != 4 || !get_double(&p, eol, &r[N].x) || !get_double(&p, eol, &r[N].y))
+			continue;
+		r[N++].id = id;
+	}
+	*recs = r;
+	*own = true;
+	return N;
+}
+
+/**
+ * Get records from gradients-file: text (columns: x, y, Dx, Dy) or binary
+ * @param M (i)    - mmap'ed file
+ * @param recs (o) - array of records (for binary file it points into M)
+ * @param own (o)  - true if *recs was allocated here and should be freed
+ * @return amount of records
+ */
+static size_t get_grad_recs(mmapbuf *M, grad_rec **recs, bool *own){
+	binhdr *hdr = check_bin(M, GRADS_MAGIC, sizeof(grad_rec));
+	if(hdr){
+		*recs = (grad_rec*)(hdr + 1);
+		*own = false;
+		return hdr->N;
+	}
+	grad_rec *r = MALLOC(grad_rec, count_lines(M->data, M->len));
+	size_t N = 0;
+	const char *pos = M->data, *end = pos + M->len;
+	while(pos < end){
+		const char *eol = memchr(pos, '\n', end - pos), *p = pos;
+		if(!eol) eol = end;
+		pos = eol + 1;
+		grad_rec *g = &r[N];
+		if(!get_double(&p, eol, &g->x) || !get_double(&p, eol, &g->y) ||
+			!get_double(&p, eol, &g->Dx) || !get_double(&p, eol, &g->Dy))
+			continue;
+		++N;
+	}
+	*recs = r;
+	*own = true;
+	return N;
+}
+
+/**
+ * Write binary file: header & records
+ * @return amount of records written
+ */
+static size_t write_bin(char *filename, const char *magic, void *recs, size_t recsize, size_t N){
+	FILE *f = fopen(filename, "w");
+	if(!f) ERR(_("Can't open %s for writing"), filename);
+	binhdr hdr = {.recsize = recsize, .N = N};
+	memcpy(hdr.magic, magic, 4);
+	if(1 != fwrite(&hdr, sizeof(hdr), 1, f) || N != fwrite(recs, recsize, N, f))
+		ERR(_("Can't write %s"), filename);
+	if(fclose(f)) ERR(_("Can't close %s"), filename);
+	return N;
+}
+
+/**
+ * Convert text spots-file into binary
+ * @param in, out - names of input (text or binary) & output (binary) files
+ * @return amount of spots converted
+ */
+size_t spots_txt2bin(char *in, char *out){
+	mmapbuf *M = My_mmap(in);
+	spot_rec *recs;
+	bool own;
+	size_t N = get_spot_recs(M, &recs, &own);
+	write_bin(out, SPOTS_MAGIC, recs, sizeof(spot_rec), N);
+	if(own) FREE(recs);
+	My_munmap(M);
+	return N;
+}
+
+/**
+ * Convert text gradients-file into binary
+ * @param in, out - names of input (text or binary) & output (binary) files
+ * @return amount of gradients converted
+ */
+size_t gradients_txt2bin(char *in, char *out){
+	mmapbuf *M = My_mmap(in);
+	grad_rec *recs;
+	bool own;
+	size_t N = get_grad_recs(M, &recs, &own);
+	write_bin(out, GRADS_MAGIC, recs, sizeof(grad_rec), N);
+	if(own) FREE(recs);
+	My_munmap(M);
+	return N;
+}
+
 /**
  * Read spots-file, find center of hartmannogram & convert coordinates
  * @param filename (i) - name of spots-file
@@ -97,18 +357,18 @@ hartmann *read_spots(char *filename, int prefocal){
 	point *spots = H->spots;
 	uint8_t *got = H->got;
 	H->filename = strdup(filename);
-	char *pos = M->data, *epos = pos + M->len;
 	// readout list of spots
-	for(; pos && pos < epos; pos = strchr(pos+1, '\n')){
-		double x, y;
-		int id, a, b;
-		//if(3 != sscanf(pos, "%d %*s %*s %*s %*s %*s %*s %*s %*s %lf %lf", &id, &x, &y))
-		if(3 != sscanf(pos, "%d %*s %*s %*s %*s %lf %lf", &id, &x, &y))
-			continue;
+	spot_rec *recs;
+	bool own;
+	size_t L = get_spot_recs(M, &recs, &own), l;
+	for(l = 0; l < L; l++){
+		double x = recs[l].x, y = recs[l].y;
+		int id = recs[l].id, a, b;
 		a = id/100; b = id%100;
 		if(b <  32) id = a*32 + b; // main spots
 		else if(a == 2) id = 256;  // inner marker
 		else id = 257;             // outern marker
+		if(id < 0 || id > 257) continue; // wrong id
 		spots[id].x = x;
 #ifdef MIR_Y
 		spots[id].y = -y;
@@ -116,7 +376,8 @@ hartmann *read_spots(char *filename, int prefocal){
 		spots[id].y = y;
 #endif
 		got[id] = 1;
-	};
+	}
+	if(own) FREE(recs);
 	// get center: simply get center of each pair of opposite spots & calculate average
 	// IDs: xyy -- x(yy+16), yy=[0..15]
 	double xc = 0., yc = 0.;
@@ -293,6 +554,22 @@ mirror *calc_mir_coordinates(hartmann *H[]){
 	return mir;
 }
 
+/**
+ * Number of circle (zone) of BTA mask for spot id from spots-file (IDs: xyy,
+ * x - circle, yy - ray, yy > 31 - markers)
+ * @return zone or -1 for markers
+ */
+int bta_zone(int id){
+	if(id < 0 || id % 100 > 31) return -1;
+	return id / 100;
+}
+
+// the same for ids of hartmann/mirror structures (a*32 + b, 256 & 257 - markers)
+static int folded_zone(int id){
+	if(id < 0 || id > 255) return -1;
+	return id / 32;
+}
+
 /**
  * Calculate Hartmann constant
  * @param mir    (i) - filled mirror structure
@@ -313,121 +590,637 @@ mirror *calc_mir_coordinates(hartmann *H[]){
  *          SUM(r_i)
  */
 double calc_Hartmann_constant(mirror *mir, hartmann *H){
-	uint8_t *mirgot = mir->got;
-	int i, j;
-	point *tans = mir->tans, *pre = H->spots;
-	polar *p_spots = mir->pol_spots;
-	double foc_i[8], r_i[8], Rsum = 0.;
-	double FCCnumerator = 0., FCCdenominator = 0.; // components of Fcc (Focus for minimal circle of confusion):
-	for(j = 0; j < 8; ++j){ // cycle by circles
-		double Rj = 0.;
-		int Nj = 0, idx = j*32;
-		for(i = 0; i < 32; ++i, ++idx){ // run through points on same circle
-			if(!mirgot[idx]) continue;
-			++Nj;
-			Rj += p_spots[idx].r;
-			double tx = tans[idx].x, ty = tans[idx].y;
-			FCCnumerator += pre[idx].x*tx + pre[idx].y*ty;
-			FCCdenominator += tx*tx + ty*ty;
+	spotset *S = mir_spotset(mir, H);
+	polar *P = MALLOC(polar, S->N);
+	size_t i;
+	for(i = 0; i < S->N; ++i) P[i] = mir->pol_spots[S->id[i]];
+	double T = spotset_Hartmann_constant(S, P, folded_zone);
+	FREE(P);
+	spotset_free(&S);
+	return T;
+}
+
+static int cmpdbl(const void * a, const void * b){
+	if (*(double*)a > *(double*)b)
+		return 1;
+	else return -1;
+}
+
+/**
+ * Allocate empty spots set
+ * @param size - initial size of arrays (they will grow if needed)
+ * @return spots set
+ */
+spotset *spotset_new(size_t size){
+	spotset *S = MALLOC(spotset, 1);
+	if(size < 16) size = 16;
+	S->size = size;
+	S->id = MALLOC(int, size);
+	S->x = MALLOC(double, size);
+	S->y = MALLOC(double, size);
+	S->tan_x = MALLOC(double, size);
+	S->tan_y = MALLOC(double, size);
+	return S;
+}
+
+static void *grow(void *ptr, size_t size){
+	ptr = realloc(ptr, size);
+	if(!ptr) ERR("realloc");
+	return ptr;
+}
+
+/**
+ * Make arrays of set big enough for size spots
+ */
+static void spotset_reserve(spotset *S, size_t size){
+	if(size <= S->size) return;
+	S->size = size;
+	S->id = grow(S->id, size * sizeof(int));
+	S->x = grow(S->x, size * sizeof(double));
+	S->y = grow(S->y, size * sizeof(double));
+	S->tan_x = grow(S->tan_x, size * sizeof(double));
+	S->tan_y = grow(S->tan_y, size * sizeof(double));
+}
+
+/**
+ * Add spot to set
+ * @param S (io)       - spots set
+ * @param id           - spot identificator
+ * @param x, y         - coordinates
+ * @param tan_x, tan_y - tangents of beam
+ */
+void spotset_add(spotset *S, int id, double x, double y, double tan_x, double tan_y){
+	if(S->N == S->size) spotset_reserve(S, S->size * 2);
+	size_t n = S->N++;
+	S->id[n] = id;
+	S->x[n] = x; S->y[n] = y;
+	S->tan_x[n] = tan_x; S->tan_y[n] = tan_y;
+}
+
+void spotset_free(spotset **S){
+	if(!S || !*S) return;
+	FREE((*S)->id);
+	FREE((*S)->x); FREE((*S)->y);
+	FREE((*S)->tan_x); FREE((*S)->tan_y);
+	FREE(*S);
+}
+
+/**
+ * Pack spots present on both images into spots set
+ * @param mir    (i) - filled mirror structure
+ * @param prefoc (i) - prefocal hartmannogram
+ * @return set with prefocal coordinates & tangents of beams
+ */
+spotset *mir_spotset(mirror *mir, hartmann *prefoc){
+	spotset *S = spotset_new(mir->spotsnum);
+	int i;
+	for(i = 0; i < 258; i++){
+		if(!mir->got[i]) continue;
+		spotset_add(S, i, prefoc->spots[i].x, prefoc->spots[i].y, mir->tans[i].x, mir->tans[i].y);
+	}
+	return S;
+}
+
+/**
+ * Read spots-file (text or binary) and append its spots to set;
+ * unlike read_spots, ids are kept as is (any amount of spots with any ids)
+ * Coordinates are in pixels as in file: convert them by spotset_center or
+ * spotset_bta_center
+ * @param S (io)    - spots set
+ * @param filename  - name of spots-file
+ * @return amount of spots added
+ */
+size_t spotset_read(spotset *S, char *filename){
+	assert(S); assert(filename);
+	mmapbuf *M = My_mmap(filename);
+	spot_rec *recs;
+	bool own;
+	size_t L = get_spot_recs(M, &recs, &own), l;
+	spotset_reserve(S, S->N + L);
+	for(l = 0; l < L; l++)
+		spotset_add(S, recs[l].id, recs[l].x, recs[l].y, 0., 0.);
+	if(own) FREE(recs);
+	My_munmap(M);
+	return L;
+}
+
+typedef struct{
+	int id;
+	size_t idx;
+} id_idx;
+
+static int cmpid(const void *a, const void *b){
+	const id_idx *x = a, *y = b;
+	if(x->id != y->id) return (x->id < y->id) ? -1 : 1;
+	return (x->idx < y->idx) ? -1 : (x->idx > y->idx);
+}
+
+/**
+ * Sort indexes of spots by id; of spots with the same id only the last is kept
+ * (like in read_spots)
+ * @param S (i)  - spots set
+ * @param N (o)  - amount of different ids
+ * @return array of indexes (allocated here)
+ */
+static id_idx *sorted_ids(spotset *S, size_t *N){
+	size_t i, n = 0;
+	id_idx *I = MALLOC(id_idx, S->N + 1);
+	for(i = 0; i < S->N; ++i){
+		I[i].id = S->id[i];
+		I[i].idx = i;
+	}
+	qsort(I, S->N, sizeof(id_idx), cmpid);
+	for(i = 0; i < S->N; ++i){
+		if(n && I[n-1].id == I[i].id) I[n-1] = I[i];
+		else I[n++] = I[i];
+	}
+	*N = n;
+	return I;
+}
+
+/**
+ * Convert coordinates of spots read by spotset_read into millimeters relative
+ * to mean of all spots (for any mask); postfocal image is turned by 180 degrees
+ * @param S (io)     - spots of one image
+ * @param prefocal   - !0 for prefocal image
+ * @param center (o) - (if !NULL) center in millimeters
+ */
+void spotset_center(spotset *S, int prefocal, point *center){
+	size_t i, N = S->N;
+	double xc = 0., yc = 0., k = prefocal ? pixsize : -pixsize;
+	double *x = S->x, *y = S->y;
+#ifdef MIR_Y
+	for(i = 0; i < N; i++) y[i] = -y[i];
+#endif
+	for(i = 0; i < N; i++){
+		xc += x[i];
+		yc += y[i];
+	}
+	if(N){
+		xc /= (double) N;
+		yc /= (double) N;
+	}
+	if(center){
+		center->x = xc * pixsize;
+		center->y = yc * pixsize;
+	}
+	for(i = 0; i < N; i++){
+		x[i] = (x[i] - xc) * k;
+		y[i] = (y[i] - yc) * k;
+	}
+}
+
+/**
+ * Convert coordinates of BTA hartmannogram spots read by spotset_read like
+ * read_spots does: center is mean of centers of opposite spots pairs,
+ * coordinates are in millimeters, rays are turned to nominal directions
+ * (IDs: xyy -- x(yy+16), yy=[0..15]; of spots with the same id the last is used)
+ * @param S (io)     - spots of one image
+ * @param prefocal   - !0 for prefocal image
+ * @param center (o) - (if !NULL) center in millimeters
+ */
+void spotset_bta_center(spotset *S, int prefocal, point *center){
+	size_t i, N;
+	long idx[8][32]; // index of spot in S or -1
+	int a, b, Nc = 0;
+	double *x = S->x, *y = S->y;
+	for(a = 0; a < 8; a++) for(b = 0; b < 32; b++) idx[a][b] = -1;
+	id_idx *I = sorted_ids(S, &N);
+	for(i = 0; i < N; i++){
+		int id = I[i].id;
+		if(id < 0 || id / 100 > 7 || id % 100 > 31) continue;
+		idx[id/100][id%100] = I[i].idx;
+	}
+	FREE(I);
+#ifdef MIR_Y
+	for(i = 0; i < S->N; i++) y[i] = -y[i];
+#endif
+	double xc = 0., yc = 0.;
+	for(a = 0; a < 8; a++) for(b = 0; b < 16; b++){ // pairs of opposite spots
+		long i0 = idx[a][b], i1 = idx[a][b+16];
+		if(i0 < 0 || i1 < 0) continue;
+		xc += (x[i0] + x[i1]) / 2.;
+		yc += (y[i0] + y[i1]) / 2.;
+		++Nc;
+	}
+	xc /= (double) Nc;
+	yc /= (double) Nc;
+	if(center){
+		center->x = xc * pixsize;
+		center->y = yc * pixsize;
+	}
+	for(i = 0; i < S->N; i++){
+		x[i] = (x[i] - xc) * pixsize;
+		y[i] = (y[i] - yc) * pixsize;
+	}
+#ifdef MIR_Y
+	const double stp = M_PI/16., an0 = -M_PI_2 + stp/2., _2pi = 2.*M_PI;
+#else
+	const double stp = M_PI/16., an0 = +M_PI_2 - stp/2., _2pi = 2.*M_PI;
+#endif
+	double dmean = 0.;
+	for(b = 0; b < 32; b++){ // rays
+		int Nr = 0;
+#ifdef MIR_Y
+		double sum = 0., refang = an0 + stp * (double)b;
+#else
+		double sum = 0., refang = an0 - stp * (double)b;
+#endif
+		for(a = 0; a < 8; a++){ // circles
+			long k = idx[a][b];
+			if(k < 0) continue;
+			sum += atan2(y[k], x[k]);
+			++Nr;
 		}
-		foc_i[j] = -FCCnumerator/FCCdenominator;
-		r_i[j] = Rj / Nj;
-		Rsum += r_i[j];
-		printf("focus on R = %g is %g\n", MIR_R * r_i[j], foc_i[j]);
+		double delta = refang - sum/(double)Nr;
+		if(delta > _2pi) delta -= _2pi;
+		if(delta < 0.) delta += _2pi;
+		if(delta < 0.) delta += _2pi;
+		dmean += delta;
+	}
+	dmean /= 32.;
+	if(!prefocal) dmean += M_PI;
+	double sn, cs;
+	sincos(dmean, &sn, &cs);
+	for(i = 0; i < S->N; i++){
+		double xx = x[i], yy = y[i];
+		x[i] = xx*cs + yy*sn;
+		y[i] = -xx*sn + yy*cs;
+	}
+}
+
+/**
+ * Pack spots present on both images into spots set (sorted by id)
+ * @param pre, post (i) - spots of prefocal & postfocal images (e.g. by spotset_read)
+ * @return set with prefocal coordinates & tangents of beams
+ */
+spotset *spotset_pair(spotset *pre, spotset *post){
+	size_t Npre, Npost, i = 0, j = 0;
+	id_idx *Ipre = sorted_ids(pre, &Npre), *Ipost = sorted_ids(post, &Npost);
+	spotset *S = spotset_new((Npre < Npost) ? Npre : Npost);
+	while(i < Npre && j < Npost){
+		if(Ipre[i].id < Ipost[j].id){ ++i; continue; }
+		if(Ipre[i].id > Ipost[j].id){ ++j; continue; }
+		size_t a = Ipre[i++].idx, b = Ipost[j++].idx;
+		double x = pre->x[a], y = pre->y[a];
+		spotset_add(S, pre->id[a], x, y, (post->x[b] - x)/distance, (post->y[b] - y)/distance);
+	}
+	FREE(Ipre); FREE(Ipost);
+	return S;
+}
+
+/**
+ * Focus for minimal circle of confusion (counted from prefocal image)
+ *         SUM (x_pre * tans_x + y_pre * tans_y)
+ * Fcc = -----------------------------------------
+ *             SUM (tanx_x^2 + tans_y^2)
+ * @param S (i) - spots set (prefocal coordinates & tangents of beams)
+ * @return Fcc
+ */
+double spotset_ccfocus(spotset *S){
+	size_t i;
+	double FCCnumerator = 0., FCCdenominator = 0.;
+	for(i = 0; i < S->N; ++i){
+		double tx = S->tan_x[i], ty = S->tan_y[i];
+		FCCnumerator += S->x[i]*tx + S->y[i]*ty;
+		FCCdenominator += tx*tx + ty*ty;
+	}
+	return -FCCnumerator/FCCdenominator;
+}
+
+/**
+ * Calculate coordinates of spots on mirror surface (like calc_mir_coordinates)
+ * @param S (i)        - spots set (prefocal coordinates & tangents of beams)
+ * @param zbestfoc     - best focus for minimal circle of confusion (spotset_ccfocus)
+ * @param prec, postc  - centers of prefocal & postfocal images (NULL if center beam
+ *                       goes along the axis)
+ * @return polar coordinates of spots on mirror relative to center beam normed by
+ *         mirror R (allocated here)
+ */
+polar *spotset_mir_coordinates(spotset *S, double zbestfoc, point *prec, point *postc){
+	size_t i, N = S->N;
+	int iter;
+	double D = FOCAL_R - zbestfoc, Zerr = 10., Zc = 0., xc = 0., yc = 0.;
+	double *Z = MALLOC(double, N), *X = MALLOC(double, N), *Y = MALLOC(double, N);
+	point tanc = {0., 0.};
+	if(prec && postc){ // the same as in calc_mir_coordinates
+		double dx = postc->x - prec->x, dy = postc->y - prec->y;
+		tanc.x = (dx + dx)/distance;
+		tanc.y = (dy + dy)/distance;
+	}
+	/*
+	 * X = x_pre + (Z-D)*tans_x
+	 * Y = y_pre + (Z-D)*tans_y
+	 * Z = (X^2 + Y^2) / (4F)
+	 */
+	for(iter = 0; iter < 10 && Zerr > 1e-6; iter++){
+		Zerr = 0.;
+		for(i = 0; i < N; i++){
+			double x = S->x[i] + S->tan_x[i] * (Z[i] - D);
+			double y = S->y[i] + S->tan_y[i] * (Z[i] - D);
+			X[i] = x; Y[i] = y;
+			double newZ = (x*x + y*y)/_4F;
+			double d = newZ - Z[i];
+			Zerr += d*d;
+			Z[i] = newZ;
+		}
+		xc = tanc.x * (Zc - D);
+		yc = tanc.y * (Zc - D);
+		Zc = (xc*xc + yc*yc)/_4F;
+	}
+	polar *P = MALLOC(polar, N);
+	for(i = 0; i < N; i++){
+		double x = X[i] - xc, y = Y[i] - yc;
+		P[i].r = sqrt(x*x + y*y) / MIR_R;
+		P[i].theta = atan2(y, x);
 	}
-	double F = 0.;
-	for(j = 0; j < 8; ++j){
+	FREE(Z); FREE(X); FREE(Y);
+	return P;
+}
+
+/**
+ * Calculate Hartmann constant (see calc_Hartmann_constant)
+ * @param S (i)  - spots set (prefocal coordinates & tangents of beams)
+ * @param P (i)  - polar coordinates of spots on mirror normed by its R
+ * @param zone   - function returning number of zone for spot id (-1 to skip spot)
+ * @return constant value
+ */
+double spotset_Hartmann_constant(spotset *S, polar *P, int (*zone)(int id)){
+	size_t i, N = S->N;
+	int j, Nzones = 0;
+	for(i = 0; i < N; ++i){
+		int z = zone(S->id[i]);
+		if(z >= Nzones) Nzones = z + 1;
+	}
+	if(Nzones < 1) ERRX(_("No zones found"));
+	double *num = MALLOC(double, 4*Nzones), *den = num + Nzones, *foc_i = den + Nzones, *r_i = foc_i + Nzones;
+	int *Nj = MALLOC(int, Nzones);
+	for(i = 0; i < N; ++i){ // FCC for each zone
+		int z = zone(S->id[i]);
+		if(z < 0) continue;
+		double tx = S->tan_x[i], ty = S->tan_y[i];
+		++Nj[z];
+		r_i[z] += P[i].r;
+		num[z] += S->x[i]*tx + S->y[i]*ty;
+		den[z] += tx*tx + ty*ty;
+	}
+	double F = 0., Rsum = 0., numerator = 0.;
+	for(j = 0; j < Nzones; ++j){
+		if(!Nj[j]) continue;
+		foc_i[j] = -num[j]/den[j];
+		r_i[j] /= Nj[j];
+		Rsum += r_i[j];
 		F += foc_i[j] * r_i[j];
+		printf("focus on R = %g is %g\n", MIR_R * r_i[j], foc_i[j]);
 	}
 	F /= Rsum;
-	double numerator = 0.;
-	for(j = 0; j < 8; ++j){
-		numerator += r_i[j]*r_i[j]*fabs(foc_i[j]-F);
+	for(j = 0; j < Nzones; ++j){
+		if(Nj[j]) numerator += r_i[j]*r_i[j]*fabs(foc_i[j]-F);
 	}
 	printf("Mean focus is %g, numerator: %g, Rsum = %g\n", F, numerator, Rsum);
 	// multiply by MIR_R because r_i are normed by R
 	double T = MIR_R * 2e5/FOCAL_R/FOCAL_R*numerator/Rsum;
 	printf("\nHartmann value T = %g\n", T);
+	FREE(num); FREE(Nj);
 	return T;
 }
 
-static int cmpdbl(const void * a, const void * b){
-	if (*(double*)a > *(double*)b)
-		return 1;
-	else return -1;
+/**
+ * Calculate gradients of mirror surface aberrations
+ * @param D (i) - spot diagram for best focus (by spotset_diagram)
+ * @return gradients for each spot of D (allocated here)
+ */
+point *spotset_gradients(spotset *D){
+	size_t i;
+	point *G = MALLOC(point, D->N);
+	for(i = 0; i < D->N; ++i){
+		G[i].x = -(D->x[i]) / _2F;
+		G[i].y = (D->y[i]) / _2F;
+	}
+	return G;
+}
+
+/**
+ * Find k'th smallest element of array (array is partially reordered:
+ * elements before k'th are not greater than it, after - not less)
+ * @param a (io) - array
+ * @param n      - its size
+ * @param k      - index of element in sorted array
+ * @return k'th element
+ */
+static double select_kth(double *a, int n, int k){
+	int l = 0, r = n - 1;
+	while(r > l){
+		// median of three as pivot
+		int m = l + (r - l) / 2;
+		double t;
+		#define SWAP(i, j)  do{t = a[i]; a[i] = a[j]; a[j] = t;}while(0)
+		if(a[m] < a[l]) SWAP(m, l);
+		if(a[r] < a[l]) SWAP(r, l);
+		if(a[r] < a[m]) SWAP(r, m);
+		double pivot = a[m];
+		int i = l, j = r;
+		while(i <= j){
+			while(a[i] < pivot) ++i;
+			while(a[j] > pivot) --j;
+			if(i <= j){
+				SWAP(i, j);
+				++i; --j;
+			}
+		}
+		#undef SWAP
+		if(k <= j) r = j;
+		else if(k >= i) l = i;
+		else break;
+	}
+	return a[k];
+}
+
+// percentiles of encircled energy
+#define Q_AMOUNT  (4)
+static const double Q_frac[Q_AMOUNT] = {0.3, 0.5, 0.7, 0.9};
+
+// parameters of spot diagram at given z
+typedef struct{
+	double mean;        // mean R
+	double std;         // its STD
+	double Rq[Q_AMOUNT];// R for Q_frac energy
+	double Rmax;        // max R
+} qstat;
+
+/**
+ * Calculate radii of spots at z
+ * @param S (i) - spots set
+ * @param z     - z from prefocal image
+ * @param R (o) - array for radii
+ */
+static void spots_radii(spotset *S, double z, double *R){
+	size_t i, N = S->N;
+	double *x0 = S->x, *y0 = S->y, *tx = S->tan_x, *ty = S->tan_y;
+	for(i = 0; i < N; i++){
+		double x = x0[i] + tx[i] * z, y = y0[i] + ty[i] * z;
+		R[i] = sqrt(x*x + y*y);
+	}
+}
+
+/**
+ * Get statistics of spot diagram at z (percentiles are found by selection
+ * from the biggest to the smallest: each next search is in left part of array)
+ * @param S (i) - spots set
+ * @param z     - z from prefocal image
+ * @param R     - buffer for radii (size S->N)
+ * @param st(o) - statistics
+ */
+static void spots_qstat(spotset *S, double z, double *R, qstat *st){
+	int i, N = S->N, k;
+	double Rsum = 0., R2sum = 0., Rmax = 0.;
+	spots_radii(S, z, R);
+	for(i = 0; i < N; i++){
+		Rsum += R[i];
+		R2sum += R[i]*R[i];
+		if(R[i] > Rmax) Rmax = R[i];
+	}
+	int L = N;
+	for(k = Q_AMOUNT - 1; k > -1; k--){
+		int idx = Q_frac[k] * N;
+		st->Rq[k] = select_kth(R, L, idx);
+		L = idx + 1;
+	}
+	st->mean = Rsum / N;
+	st->std = sqrt((R2sum - Rsum*Rsum/N)/(N-1.));
+	st->Rmax = Rmax;
+}
+
+/**
+ * Radius containing fraction q of spots at z
+ */
+static double spots_qradius(spotset *S, double z, double *R, double q){
+	spots_radii(S, z, R);
+	return select_kth(R, S->N, (int)(q * S->N));
+}
+
+/**
+ * Refine minimum of R(z) for fraction q of spots by golden-section search
+ * @param S (i)  - spots set
+ * @param q      - fraction of energy
+ * @param a, b   - interval of search
+ * @param tol    - precision by z
+ * @param R      - buffer for radii
+ * @param Rmin(o)- (if !NULL) R at found z
+ * @return z of minimum
+ */
+static double golden_min(spotset *S, double q, double a, double b, double tol, double *R, double *Rmin){
+	const double g = (sqrt(5.) - 1.) / 2.;
+	double c = b - g*(b - a), d = a + g*(b - a);
+	double fc = spots_qradius(S, c, R, q), fd = spots_qradius(S, d, R, q);
+	while(b - a > tol){
+		if(fc < fd){
+			b = d; d = c; fd = fc;
+			c = b - g*(b - a);
+			fc = spots_qradius(S, c, R, q);
+		}else{
+			a = c; c = d; fc = fd;
+			d = a + g*(b - a);
+			fd = spots_qradius(S, d, R, q);
+		}
+	}
+	double z = (fc < fd) ? c : d;
+	if(Rmin) *Rmin = (fc < fd) ? fc : fd;
+	return z;
+}
+
+// z-scan: +-Q_ZRANGE around best focus with step Q_ZSTEP, refinement to Q_ZTOL
+#define Q_ZRANGE   (3.)
+#define Q_ZSTEP    (0.1)
+#define Q_ZTOL     (1e-4)
+
+/**
+ * Find best focus for fraction q of spots energy
+ * (coarse z-scan & golden-section refinement)
+ * @param S (i)    - spots set (prefocal coordinates & tangents of beams)
+ * @param zbestfoc - best focus for minimal circle of confusion (scan is in +-3mm around it)
+ * @param q        - fraction of energy (0..1)
+ * @param Rq (o)   - (if !NULL) radius of circle with fraction q of energy
+ * @return Z of best focus
+ */
+double spotset_bestfocus(spotset *S, double zbestfoc, double q, double *Rq){
+	int i, Nz = 2.*Q_ZRANGE/Q_ZSTEP + 1, N = S->N;
+	double Rz[Nz];
+	#pragma omp parallel
+	{
+		double *R = MALLOC(double, N);
+		#pragma omp for
+		for(i = 0; i < Nz; i++)
+			Rz[i] = spots_qradius(S, zbestfoc - Q_ZRANGE + i*Q_ZSTEP, R, q);
+		FREE(R);
+	}
+	int imin = 0;
+	for(i = 1; i < Nz; i++) if(Rz[i] < Rz[imin]) imin = i;
+	double z = zbestfoc - Q_ZRANGE + imin*Q_ZSTEP, *R = MALLOC(double, N);
+	z = golden_min(S, q, z - Q_ZSTEP, z + Q_ZSTEP, Q_ZTOL, R, Rq);
+	FREE(R);
+	return z;
 }
 
 /**
  * Calculate energy in circle of confusion
- * @param mir    (i) - filled mirror structure
- * @param prefoc (i) - prefocal hartmannogram
+ * @param S (i)    - spots set (prefocal coordinates & tangents of beams)
+ * @param zbestfoc - best focus for minimal circle of confusion (scan is in +-3mm around it)
+ * @return Z of best focus for q=0.7
  */
-void getQ(mirror *mir, hartmann *prefoc){
-	point *pre = prefoc->spots;
-	point *tans = mir->tans;
-	uint8_t *got = mir->got;
-	int i, j, N = mir->spotsnum, N03 = 0.3*N, N05 = 0.5*N, N07 = 0.7*N, N09 = 0.9*N;
-	double zstart = mir->zbestfoc - 3., z, zend = mir->zbestfoc + 3.01;
-	double *R = MALLOC(double, N);
-	double z03, z05, z07, z09, r03=1e3, r05=1e3, r07=1e3, r09=1e3;
+double spotset_getQ(spotset *S, double zbestfoc){
+	int i, k, N = S->N, Nz = 2.*Q_ZRANGE/Q_ZSTEP + 1;
+	qstat *st = MALLOC(qstat, Nz);
+	// z-scan
+	#pragma omp parallel
+	{
+		double *R = MALLOC(double, N);
+		#pragma omp for
+		for(i = 0; i < Nz; i++)
+			spots_qstat(S, zbestfoc - Q_ZRANGE + i*Q_ZSTEP, R, &st[i]);
+		FREE(R);
+	}
 	printf("\nEnergy in circle of confusion\n");
 	printf("z        mean(R)'' std(R)''   R0.3''    R0.5''   R0.7''    R0.9''   Rmax''\n");
-	for(z = zstart; z < zend; z += 0.1){
-		j = 0;
-		double Rsum = 0., R2sum = 0.;
-		for(i = 0; i < 258; i++){
-			if(!got[i]) continue;
-			double x, y, R2, R1;
-			x = pre[i].x + tans[i].x * z;
-			y = pre[i].y + tans[i].y * z;
-			R2 = x*x + y*y;
-			R1 = sqrt(R2);
-			R[j] = R1;
-			R2sum += R2;
-			Rsum += R1;
-			++j;
-		}
-		qsort(R, N, sizeof(double), cmpdbl);
-		double R3 = R[N03], R5 = R[N05], R7 = R[N07], R9 = R[N09];
-/*		for(i = N-1; i; --i) if(R[i] < R7) break;
-		R7 = R[i];
-		for(i = N-1; i; --i) if(R[i] < R9) break;
-		R9 = R[i];*/
+	int imin[Q_AMOUNT] = {0};
+	for(i = 0; i < Nz; i++){
 		printf("%6.2f  %8.6f  %8.6f  %8.6f  %8.6f  %8.6f  %8.6f  %8.6f\n",
-			z, MM_TO_ARCSEC(Rsum/N), MM_TO_ARCSEC(sqrt((R2sum - Rsum*Rsum/N)/(N-1.))),
-			MM_TO_ARCSEC(R3), MM_TO_ARCSEC(R5),
-			MM_TO_ARCSEC(R7), MM_TO_ARCSEC(R9), MM_TO_ARCSEC(R[N-1]));
-		if(r03 > R3){
-			r03 = R3; z03 = z;
-		}
-		if(r05 > R5){
-			r05 = R5; z05 = z;
-		}
-		if(r07 > R7){
-			r07 = R7; z07 = z;
-		}
-		if(r09 > R9){
-			r09 = R9; z09 = z;
-		}
+			zbestfoc - Q_ZRANGE + i*Q_ZSTEP, MM_TO_ARCSEC(st[i].mean), MM_TO_ARCSEC(st[i].std),
+			MM_TO_ARCSEC(st[i].Rq[0]), MM_TO_ARCSEC(st[i].Rq[1]),
+			MM_TO_ARCSEC(st[i].Rq[2]), MM_TO_ARCSEC(st[i].Rq[3]), MM_TO_ARCSEC(st[i].Rmax));
+		for(k = 0; k < Q_AMOUNT; k++)
+			if(st[i].Rq[k] < st[imin[k]].Rq[k]) imin[k] = i;
+	}
+	FREE(st);
+	// refine minimums
+	double zq[Q_AMOUNT], rq[Q_AMOUNT], *R = MALLOC(double, N);
+	for(k = 0; k < Q_AMOUNT; k++){
+		double z = zbestfoc - Q_ZRANGE + imin[k]*Q_ZSTEP;
+		zq[k] = golden_min(S, Q_frac[k], z - Q_ZSTEP, z + Q_ZSTEP, Q_ZTOL, R, &rq[k]);
 	}
-	mir->z07 = z07;
+	double z07 = zq[2];
 	printf("\ngot best values: z03=%g (r=%g''), z05=%g (r=%g''), z07=%g (r=%g''), z09=%g (r=%g'')\n",
-		z03, MM_TO_ARCSEC(r03), z05, MM_TO_ARCSEC(r05),
-		z07, MM_TO_ARCSEC(r07), z09, MM_TO_ARCSEC(r09));
+		zq[0], MM_TO_ARCSEC(rq[0]), zq[1], MM_TO_ARCSEC(rq[1]),
+		z07, MM_TO_ARCSEC(rq[2]), zq[3], MM_TO_ARCSEC(rq[3]));
 	printf("\nEnergy for z = %g\n   R,''      q(r)\n", z07);
-	for(j=0, i=0; i < 258; ++i){
-		if(!got[i]) continue;
-		double x, y;
-		x = pre[i].x + tans[i].x * z07;
-		y = pre[i].y + tans[i].y * z07;
-		R[j] = sqrt(x*x + y*y);
-		++j;
-	}
+	spots_radii(S, z07, R);
 	qsort(R, N, sizeof(double), cmpdbl);
 	for(i = 0; i < N; ++i){
 		printf("%8.6f  %8.6f\n", MM_TO_ARCSEC(R[i]), (1.+(double)i)/N);
 	}
 	FREE(R);
+	return z07;
+}
+
+/**
+ * Calculate energy in circle of confusion
+ * @param mir    (io) - filled mirror structure (mir->z07 will be filled)
+ * @param prefoc (i)  - prefocal hartmannogram
+ */
+void getQ(mirror *mir, hartmann *prefoc){
+	spotset *S = mir_spotset(mir, prefoc);
+	mir->z07 = spotset_getQ(S, mir->zbestfoc);
+	spotset_free(&S);
 }
 
 void h_free(hartmann **H){
@@ -436,6 +1229,27 @@ void h_free(hartmann **H){
 	FREE(*H);
 }
 
+/**
+ * Calculate spot diagram for given z value
+ * @param S (i) - spots set (prefocal coordinates & tangents of beams)
+ * @param z     - z from prefocal image
+ * @return set with spots coordinates at z (tangents are the same)
+ */
+spotset *spotset_diagram(spotset *S, double z){
+	size_t i, N = S->N;
+	spotset *D = spotset_new(N);
+	double *x0 = S->x, *y0 = S->y, *tx = S->tan_x, *ty = S->tan_y, *x = D->x, *y = D->y;
+	for(i = 0; i < N; ++i){
+		x[i] = x0[i] + tx[i] * z;
+		y[i] = y0[i] + ty[i] * z;
+	}
+	memcpy(D->id, S->id, N*sizeof(int));
+	memcpy(D->tan_x, tx, N*sizeof(double));
+	memcpy(D->tan_y, ty, N*sizeof(double));
+	D->N = N;
+	return D;
+}
+
 /**
  * Calculate spot diagram for given z value
  * @param mir  (i) - filled mirror structure
@@ -443,22 +1257,22 @@ void h_free(hartmann **H){
  * @return allocated structure of spot diagram
  */
 spot_diagram *calc_spot_diagram(mirror *mir, hartmann *prefoc, double z){
-	int i;
+	size_t i;
 	spot_diagram *SD = MALLOC(spot_diagram, 1);
-	point *pre = prefoc->spots, *spots = SD->spots;
-	point *tans = mir->tans;
-	uint8_t *got = mir->got;
 	memcpy(SD->got, mir->got, 258);
 	SD->center.x = prefoc->center.x + mir->tanc.x * z;
 	SD->center.y = prefoc->center.y + mir->tanc.y * z;
 	printf("spots center: (%g, %g)\n", SD->center.x, SD->center.y);
 	printf("\nSpot diagram for z = %g (all in mm)\n ray#        x           y\n", z);
-	for(i = 0; i < 258; ++i){
-		if(!got[i]) continue;
-		spots[i].x = pre[i].x + tans[i].x * z;
-		spots[i].y = pre[i].y + tans[i].y * z;
-		printf("%4d   %10.6f   %10.6f\n", i, spots[i].x, spots[i].y);
+	spotset *S = mir_spotset(mir, prefoc), *D = spotset_diagram(S, z);
+	for(i = 0; i < D->N; ++i){
+		int id = D->id[i];
+		SD->spots[id].x = D->x[i];
+		SD->spots[id].y = D->y[i];
+		printf("%4d   %10.6f   %10.6f\n", id, D->x[i], D->y[i]);
 	}
+	spotset_free(&S);
+	spotset_free(&D);
 	return SD;
 }
 
@@ -548,9 +1362,13 @@ size_t get_gradients(hartmann *H[], polar **coords, point **grads, double *scale
 	return Sz;
 }
 
+#endif
+
 /**
  * Readout of gradients file calculated somewhere outside
+ * (text with columns x, y, Dx, Dy or binary made by gradients_txt2bin)
  *
+ * @param gradname   - name of file
  * @param coords (o) - array with coordinates on mirror (in meters), ALLOCATED HERE!
  * @param grads  (o) - array with gradients (meters per meters), ALLOCATED HERE!
  * @param scale  (o) - scale on mirror (Rmax)
@@ -561,35 +1379,25 @@ size_t read_gradients(char *gradname, polar **coords, point **grads, double *sca
 	mmapbuf *M = NULL;
 	double Rmax = 0.;
 	M = My_mmap(gradname);
-	size_t L = 0;
-	char *pos = M->data, *epos = pos + M->len;
-	for(; pos && pos < epos; pos = strchr(pos+1, '\n')){
-		double x, y, gx, gy, R;
-		if(4 != sscanf(pos, "%lf %lf %lf %lf", &x, &y, &gx, &gy))
-			continue;
-		R = sqrt(x*x + y*y);
-		if(R > Rmax) Rmax = R;
-		L++;
-	}
+	grad_rec *recs;
+	bool own;
+	size_t L = get_grad_recs(M, &recs, &own), l;
 	printf("Found %zd points\n", L);
 	polar *C = MALLOC(polar, L), *cptr = C;
 	point *G = MALLOC(point, L), *gptr = G;
-	pos = M->data, epos = pos + M->len;
-	for(; pos && pos < epos; pos = strchr(pos+1, '\n')){
-		double x, y, gx, gy, R;
-		if(4 != sscanf(pos, "%lf %lf %lf %lf", &x, &y, &gx, &gy))
-			continue;
-		R = sqrt(x*x + y*y);
-		cptr->r = R / Rmax;
+	for(l = 0; l < L; l++, cptr++, gptr++){
+		double x = recs[l].x, y = recs[l].y, R = sqrt(x*x + y*y);
+		if(R > Rmax) Rmax = R;
+		cptr->r = R;
 		cptr->theta = atan2(y, x);
-		gptr->x = gx*1e6;
-		gptr->y = gy*1e6;
-		printf("%5.2f %5.2f %5.2f %5.2f\n",x, y, gx*1e6,gy*1e6);
-		cptr++, gptr++;
+		gptr->x = recs[l].Dx*1e6;
+		gptr->y = recs[l].Dy*1e6;
 	}
+	for(l = 0, cptr = C; l < L; l++, cptr++)
+		cptr->r /= Rmax;
+	if(own) FREE(recs);
 	My_munmap(M);
 	*scale = Rmax;
 	*coords = C; *grads = G;
 	return L;
 }
-#endif
@@ -80,6 +80,17 @@ typedef struct{
 	double z;           // z from prefocal image
 }spot_diagram;
 
+// dynamically sized set of spots (only present ones), structure of arrays
+typedef struct{
+	size_t N;        // amount of spots
+	size_t size;     // allocated size of arrays
+	int *id;         // spots identificators
+	double *x;       // coordinates of spots (e.g. on prefocal image)
+	double *y;
+	double *tan_x;   // tangents of beams
+	double *tan_y;
+} spotset;
+
 // gradients structure: point coordinates & gradient components
 typedef struct{
 	int id;
@@ -89,7 +100,35 @@ typedef struct{
 	double Dy;
 } CG;
 
+// binary spots/gradients files: header and array of records (native byte order)
+#define SPOTS_MAGIC  "HSPT"
+#define GRADS_MAGIC  "HGRD"
+typedef struct{
+	char magic[4];     // SPOTS_MAGIC or GRADS_MAGIC
+	uint32_t recsize;  // size of one record
+	uint64_t N;        // amount of records
+} binhdr;
+
+// record of spots-file
+typedef struct{
+	double x;          // coordinates of spot center (pixels)
+	double y;
+	int32_t id;        // spot identificator
+	uint32_t reserved;
+} spot_rec;
+
+// record of gradients-file
+typedef struct{
+	double x;          // coordinates on mirror
+	double y;
+	double Dx;         // gradient components
+	double Dy;
+} grad_rec;
+
 hartmann *read_spots(char *filename, int prefocal);
+size_t read_gradients(char *gradname, polar **coords, point **grads, double *scale);
+size_t spots_txt2bin(char *in, char *out);
+size_t gradients_txt2bin(char *in, char *out);
 void h_free(hartmann **H);
 mirror *calc_mir_coordinates(hartmann *H[]);
 void getQ(mirror *mir, hartmann *prefoc);
@@ -97,8 +136,24 @@ double calc_Hartmann_constant(mirror *mir, hartmann *H);
 spot_diagram *calc_spot_diagram( mirror *mir, hartmann *H, double z);
 void calc_gradients(mirror *mir, spot_diagram *foc_spots);
 
+spotset *spotset_new(size_t size);
+void spotset_add(spotset *S, int id, double x, double y, double tan_x, double tan_y);
+void spotset_free(spotset **S);
+spotset *mir_spotset(mirror *mir, hartmann *prefoc);
+double spotset_getQ(spotset *S, double zbestfoc);
+double spotset_bestfocus(spotset *S, double zbestfoc, double q, double *Rq);
+spotset *spotset_diagram(spotset *S, double z);
+size_t spotset_read(spotset *S, char *filename);
+void spotset_center(spotset *S, int prefocal, point *center);
+void spotset_bta_center(spotset *S, int prefocal, point *center);
+spotset *spotset_pair(spotset *pre, spotset *post);
+double spotset_ccfocus(spotset *S);
+polar *spotset_mir_coordinates(spotset *S, double zbestfoc, point *prec, point *postc);
+int bta_zone(int id);
+double spotset_Hartmann_constant(spotset *S, polar *P, int (*zone)(int id));
+point *spotset_gradients(spotset *D);
+
 /*
 size_t get_gradients(hartmann *H[], polar **coords, point **grads, double *scale);
-size_t read_gradients(char *gradname, polar **coords, point **grads, double *scale);
 */
 #endif // __SPOTS_H__
@@ -0,0 +1,403 @@
+/*
+ * spotsbench.c - benchmark of spots/gradients files reading: old sscanf-based
+ *                parser, new text parser & binary format
+ *
+ * Copyright 2013 Edward V. Emelianoff <eddy@sao.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <err.h>
+
+#include "spots.h"
+
+#define SPOTS_TXT   "/tmp/spotsbench_spots.txt"
+#define SPOTS_BIN   "/tmp/spotsbench_spots.bin"
+#define SPOTS_REF   "/tmp/spotsbench_spots.ref"
+#define GRADS_TXT   "/tmp/spotsbench_grads.txt"
+#define GRADS_BIN   "/tmp/spotsbench_grads.bin"
+#define PRE_TXT     "/tmp/spotsbench_pre.txt"
+#define POST_TXT    "/tmp/spotsbench_post.txt"
+
+static double dtime(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/**
+ * Read whole file into zero-terminated buffer
+ */
+static char *slurp(char *name){
+	FILE *f = fopen(name, "r");
+	if(!f) err(1, "%s", name);
+	fseek(f, 0, SEEK_END);
+	long L = ftell(f);
+	rewind(f);
+	char *buf = MALLOC(char, L + 1);
+	if(L != (long)fread(buf, 1, L, f)) err(1, "fread");
+	fclose(f);
+	return buf;
+}
+
+/**
+ * Generate synthetic files with N spots/gradients
+ */
+static void generate(size_t N){
+	FILE *s = fopen(SPOTS_TXT, "w"), *g = fopen(GRADS_TXT, "w");
+	if(!s || !g) err(1, "fopen");
+	srand48(1);
+	size_t i;
+	for(i = 0; i < N; i++){
+		int a = i % 8, b = (i / 8) % 34; // b == 32/33 are markers
+		double r = 100. + 100.*a + drand48(), phi = b * M_PI / 16.;
+		fprintf(s, "%d %d %.2f %.2f %d %.4f %.4f\n", a*100 + b, (int)i, drand48(), drand48(),
+			(int)(1000.*drand48()), 1024. + r*cos(phi), 1024. + r*sin(phi));
+		fprintf(g, "%.6f %.6f %.8e %.8e\n", 3.*drand48() - 1.5, 3.*drand48() - 1.5,
+			1e-6*(drand48() - 0.5), 1e-6*(drand48() - 0.5));
+	}
+	fclose(s); fclose(g);
+}
+
+/**
+ * Get copy of line started from pos (to run sscanf on it: on the whole buffer
+ * sscanf makes strlen of the rest of buffer for each call, so old parser is
+ * O(N^2) and can't be measured on big files)
+ */
+static char *getline_(char *pos, char *line, size_t len){
+	if(*pos == '\n') ++pos;
+	char *eol = strchr(pos, '\n');
+	size_t l = eol ? (size_t)(eol - pos) : strlen(pos);
+	if(l >= len) l = len - 1;
+	memcpy(line, pos, l);
+	line[l] = 0;
+	return line;
+}
+
+/**
+ * Old spots parser (reference): returns amount of lines parsed
+ */
+static size_t old_spots(char *buf, point *spots, uint8_t *got){
+	char *pos = buf, *epos = buf + strlen(buf), line[256];
+	size_t N = 0;
+	for(; pos && pos < epos; pos = strchr(pos+1, '\n')){
+		double x, y;
+		int id;
+		if(3 != sscanf(getline_(pos, line, 256), "%d %*s %*s %*s %*s %lf %lf", &id, &x, &y))
+			continue;
+		int a = id/100, b = id%100;
+		if(b <  32) id = a*32 + b;
+		else if(a == 2) id = 256;
+		else id = 257;
+		spots[id].x = x; spots[id].y = y;
+		got[id] = 1;
+		++N;
+	}
+	return N;
+}
+
+/**
+ * Write spots found by old parser into text file (one line for each id)
+ * to process them by read_spots exactly like the new parsers' results
+ */
+static void write_ref(point *spots, uint8_t *got){
+	FILE *f = fopen(SPOTS_REF, "w");
+	if(!f) err(1, "fopen");
+	int i;
+	for(i = 0; i < 258; i++){
+		if(!got[i]) continue;
+		int id = (i < 256) ? (i/32)*100 + i%32 : ((i == 256) ? 232 : 332);
+		fprintf(f, "%d 0 0 0 0 %.17g %.17g\n", id, spots[i].x, spots[i].y);
+	}
+	fclose(f);
+}
+
+/**
+ * Old gradients parser (reference): returns amount of lines parsed
+ */
+static size_t old_grads(char *buf, point *G){
+	char *pos = buf, *epos = buf + strlen(buf), line[256];
+	size_t N = 0;
+	for(; pos && pos < epos; pos = strchr(pos+1, '\n')){
+		double x, y, gx, gy;
+		if(4 != sscanf(getline_(pos, line, 256), "%lf %lf %lf %lf", &x, &y, &gx, &gy))
+			continue;
+		G[N].x = gx*1e6; G[N].y = gy*1e6;
+		++N;
+	}
+	return N;
+}
+
+/**
+ * Generate pre- or postfocal image of BTA mask: each spot is written three times
+ * (last one is used), markers have ids 232 & 332
+ */
+static void generate_bta(char *name, int prefocal){
+	FILE *f = fopen(name, "w");
+	if(!f) err(1, "fopen");
+	int rep, a, b;
+	for(rep = 0; rep < 3; rep++) for(a = 0; a < 8; a++) for(b = 0; b < 33; b++){
+		if(b == 32 && a != 2 && a != 3) continue;
+		double r = 150. + 90.*a + drand48(), phi = M_PI_2 - M_PI/32. - b*M_PI/16. + 0.05 + 1e-3*drand48();
+		if(!prefocal) r *= -(0.9 + 0.002*a*a);
+		fprintf(f, "%d 0 0 0 0 %.4f %.4f\n", a*100 + b, 1024. + 30.*!prefocal + r*cos(phi), 1000. + r*sin(phi));
+	}
+	fclose(f);
+}
+
+static bool near(double a, double b){
+	return fabs(a - b) <= 1e-9*(fabs(a) + fabs(b)) + 1e-15;
+}
+
+// index of spot in hartmann/mirror structures by id from file
+static int fold(int id){
+	int a = id/100, b = id%100;
+	if(b < 32) return a*32 + b;
+	return (a == 2) ? 256 : 257;
+}
+
+static int dblcmp(const void *a, const void *b){
+	double d = *(const double*)a - *(const double*)b;
+	return (d > 0.) - (d < 0.);
+}
+
+// radius containing fraction q of spots at z (straight sorting)
+static double qradius(spotset *S, double z, double q){
+	spotset *D = spotset_diagram(S, z);
+	size_t i, N = D->N;
+	double *R = MALLOC(double, N);
+	for(i = 0; i < N; i++) R[i] = sqrt(D->x[i]*D->x[i] + D->y[i]*D->y[i]);
+	qsort(R, N, sizeof(double), dblcmp);
+	double r = R[(size_t)(q*N)];
+	FREE(R);
+	spotset_free(&D);
+	return r;
+}
+
+// the same z-scan as in spotset_bestfocus/spotset_getQ
+#define ZRANGE  (3.)
+#define ZSTEP   (0.1)
+
+/**
+ * Check that spotset_bestfocus gives minimum of R(z) on grid of z-scan within its
+ * step with R not greater than grid one, and the same z07 as spotset_getQ
+ * @return true if check failed
+ */
+static bool check_bestfocus(spotset *S, double zbestfoc, double z07){
+	int i, Nz = 2.*ZRANGE/ZSTEP + 1, imin = 0;
+	double Rmin = -1.;
+	for(i = 0; i < Nz; i++){
+		double R = qradius(S, zbestfoc - ZRANGE + i*ZSTEP, 0.7);
+		if(Rmin < 0. || R < Rmin){ Rmin = R; imin = i; }
+	}
+	double zgrid = zbestfoc - ZRANGE + imin*ZSTEP, Rq;
+	double z = spotset_bestfocus(S, zbestfoc, 0.7, &Rq);
+	const char *bad = NULL;
+	if(fabs(z - zgrid) > ZSTEP) bad = "far from grid minimum";
+	else if(Rq > Rmin) bad = "R is greater than on grid";
+	else if(fabs(Rq - qradius(S, z, 0.7)) > 1e-12) bad = "wrong R";
+	else if(z != z07) bad = "differs from z07 of spotset_getQ";
+	if(bad){
+		printf(RED "spotset_bestfocus: z=%g (R=%g), grid: z=%g (R=%g): %s" OLDCOLOR "\n", z, Rq, zgrid, Rmin, bad);
+		return true;
+	}
+	printf("spotset_bestfocus: z=%g (R=%g), grid: z=%g (R=%g)\n", z, Rq, zgrid, Rmin);
+	return false;
+}
+
+/**
+ * Check that spots set functions (spotset_read, spotset_bta_center, spotset_pair...)
+ * give the same results as functions for fixed-size structures of BTA mask
+ * (read_spots, calc_mir_coordinates, calc_Hartmann_constant, getQ, calc_gradients)
+ * @return true if results differ
+ */
+static bool check_spotset(){
+	size_t i;
+	double dist = distance;
+	distance = 100.;
+	generate_bta(PRE_TXT, 1);
+	generate_bta(POST_TXT, 0);
+	// hide output of calc_* functions
+	fflush(stdout);
+	int so = dup(1), nul = open("/dev/null", O_WRONLY);
+	if(so < 0 || nul < 0 || dup2(nul, 1) < 0) err(1, "dup");
+	hartmann *H[2] = {read_spots(PRE_TXT, 1), read_spots(POST_TXT, 0)};
+	point c0 = H[0]->center, c1 = H[1]->center; // calc_mir_coordinates changes them
+	mirror *mir = calc_mir_coordinates(H);
+	double T = calc_Hartmann_constant(mir, H[0]);
+	getQ(mir, H[0]);
+	spot_diagram *SD = calc_spot_diagram(mir, H[0], mir->z07);
+	calc_gradients(mir, SD);
+	spotset *pre = spotset_new(0), *post = spotset_new(0);
+	spotset_read(pre, PRE_TXT);
+	spotset_read(post, POST_TXT);
+	point sc0, sc1;
+	spotset_bta_center(pre, 1, &sc0);
+	spotset_bta_center(post, 0, &sc1);
+	spotset *S = spotset_pair(pre, post);
+	double zf = spotset_ccfocus(S);
+	polar *P = spotset_mir_coordinates(S, zf, &sc0, &sc1);
+	double Ts = spotset_Hartmann_constant(S, P, bta_zone);
+	double z07 = spotset_getQ(S, zf);
+	spotset *D = spotset_diagram(S, mir->z07);
+	point *G = spotset_gradients(D);
+	fflush(stdout);
+	if(dup2(so, 1) < 0) err(1, "dup2");
+	close(so); close(nul);
+	const char *bad = NULL;
+	if(!near(c0.x, sc0.x) || !near(c0.y, sc0.y) || !near(c1.x, sc1.x) || !near(c1.y, sc1.y)) bad = "centers";
+	else if(S->N != (size_t)mir->spotsnum) bad = "amount of spots";
+	else if(!near(zf, mir->zbestfoc)) bad = "best focus";
+	else if(!near(Ts, T)) bad = "Hartmann constant";
+	else if(fabs(z07 - mir->z07) > 1e-4) bad = "z07";
+	else for(i = 0; i < S->N; i++){
+		int f = fold(S->id[i]);
+		if(!mir->got[f] || !near(S->x[i], H[0]->spots[f].x) || !near(S->y[i], H[0]->spots[f].y)
+			|| !near(S->tan_x[i], mir->tans[f].x) || !near(S->tan_y[i], mir->tans[f].y)){
+			bad = "spots & tangents";
+			break;
+		}
+		if(!near(P[i].r, mir->pol_spots[f].r) || fabs(remainder(P[i].theta - mir->pol_spots[f].theta, 2.*M_PI)) > 1e-9){
+			bad = "mirror coordinates";
+			break;
+		}
+		if(!near(G[i].x, mir->grads[f].x) || !near(G[i].y, mir->grads[f].y)){
+			bad = "gradients";
+			break;
+		}
+	}
+	if(!bad && check_bestfocus(S, zf, z07)) bad = "best focus";
+	if(bad) printf(RED "Spots set: %s differ from fixed-size functions!" OLDCOLOR "\n", bad);
+	else printf("Spots set functions give the same results as fixed-size ones (%zd spots, T = %g, z07 = %g)\n\n",
+		S->N, T, z07);
+	FREE(P); FREE(G); FREE(SD); FREE(mir);
+	h_free(&H[0]); h_free(&H[1]);
+	spotset_free(&pre); spotset_free(&post);
+	spotset_free(&S); spotset_free(&D);
+	unlink(PRE_TXT); unlink(POST_TXT);
+	distance = dist;
+	return bad != NULL;
+}
+
+int main(int argc, char **argv){
+	size_t N = 1000000;
+	if(argc > 1) N = strtoul(argv[1], NULL, 10);
+	if(N < 1) errx(1, "Usage: %s [amount of spots]", argv[0]);
+	printf("Generate %zd spots & gradients\n", N);
+	generate(N);
+	double t0, t_old, t_txt, t_conv, t_bin;
+	size_t i;
+	bool bad = false;
+
+	// spots
+	point oldspots[258];
+	uint8_t oldgot[258] = {0};
+	t0 = dtime();
+	char *buf = slurp(SPOTS_TXT);
+	size_t L = old_spots(buf, oldspots, oldgot);
+	t_old = dtime() - t0;
+	FREE(buf);
+	t0 = dtime();
+	hartmann *Ht = read_spots(SPOTS_TXT, 1);
+	t_txt = dtime() - t0;
+	t0 = dtime();
+	size_t Lb = spots_txt2bin(SPOTS_TXT, SPOTS_BIN);
+	t_conv = dtime() - t0;
+	t0 = dtime();
+	hartmann *Hb = read_spots(SPOTS_BIN, 1);
+	t_bin = dtime() - t0;
+	if(L != Lb || memcmp(Ht->spots, Hb->spots, sizeof(Ht->spots)) || memcmp(Ht->got, Hb->got, sizeof(Ht->got))){
+		printf(RED "Spots: results differ!" OLDCOLOR "\n");
+		bad = true;
+	}else{
+		write_ref(oldspots, oldgot);
+		hartmann *Hr = read_spots(SPOTS_REF, 1);
+		for(i = 0; i < 258; i++){
+			if(Hr->got[i] != Ht->got[i] || (Ht->got[i] &&
+				(Hr->spots[i].x != Ht->spots[i].x || Hr->spots[i].y != Ht->spots[i].y))){
+				printf(RED "Spots: results of sscanf differ!" OLDCOLOR "\n");
+				bad = true;
+				break;
+			}
+		}
+		h_free(&Hr);
+		unlink(SPOTS_REF);
+	}
+	printf("\nSpots (%zd):\n\tsscanf: %.3fs\n\ttext:   %.3fs (%.1f times faster)\n"
+		"\tconvert to binary: %.3fs\n\tbinary: %.4fs (%.1f times faster)\n\n",
+		L, t_old, t_txt, t_old/t_txt, t_conv, t_bin, t_old/t_bin);
+	h_free(&Ht);
+	h_free(&Hb);
+	// spots set: all records with original ids
+	spotset *Spt = spotset_new(0), *Spb = spotset_new(0);
+	t0 = dtime();
+	spotset_read(Spt, SPOTS_TXT);
+	t_txt = dtime() - t0;
+	t0 = dtime();
+	spotset_read(Spb, SPOTS_BIN);
+	t_bin = dtime() - t0;
+	if(Spt->N != L || Spb->N != L || memcmp(Spt->id, Spb->id, L*sizeof(int))
+		|| memcmp(Spt->x, Spb->x, L*sizeof(double)) || memcmp(Spt->y, Spb->y, L*sizeof(double))){
+		printf(RED "Spots set: results differ!" OLDCOLOR "\n");
+		bad = true;
+	}
+	printf("Spots set (%zd):\n\ttext:   %.3fs\n\tbinary: %.4fs\n\n", Spt->N, t_txt, t_bin);
+	spotset_free(&Spt);
+	spotset_free(&Spb);
+	if(check_spotset()) bad = true;
+
+	// gradients
+	point *G = MALLOC(point, N);
+	t0 = dtime();
+	buf = slurp(GRADS_TXT);
+	L = old_grads(buf, G);
+	t_old = dtime() - t0;
+	FREE(buf);
+	polar *Ct, *Cb;
+	point *Gt, *Gb;
+	double St, Sb;
+	t0 = dtime();
+	size_t Lt = read_gradients(GRADS_TXT, &Ct, &Gt, &St);
+	t_txt = dtime() - t0;
+	t0 = dtime();
+	gradients_txt2bin(GRADS_TXT, GRADS_BIN);
+	t_conv = dtime() - t0;
+	t0 = dtime();
+	Lb = read_gradients(GRADS_BIN, &Cb, &Gb, &Sb);
+	t_bin = dtime() - t0;
+	if(L != Lt || Lt != Lb || St != Sb || memcmp(Ct, Cb, Lt*sizeof(polar)) || memcmp(Gt, Gb, Lt*sizeof(point))){
+		printf(RED "Gradients: results differ!" OLDCOLOR "\n");
+		bad = true;
+	}else for(i = 0; i < L; i++){
+		if(G[i].x != Gt[i].x || G[i].y != Gt[i].y){
+			printf(RED "Gradients: results of sscanf differ!" OLDCOLOR "\n");
+			bad = true;
+			break;
+		}
+	}
+	printf("\nGradients (%zd):\n\tsscanf: %.3fs\n\ttext:   %.3fs (%.1f times faster)\n"
+		"\tconvert to binary: %.3fs\n\tbinary: %.4fs (%.1f times faster)\n",
+		L, t_old, t_txt, t_old/t_txt, t_conv, t_bin, t_old/t_bin);
+	FREE(G); FREE(Ct); FREE(Cb); FREE(Gt); FREE(Gb);
+	unlink(SPOTS_TXT); unlink(SPOTS_BIN);
+	unlink(GRADS_TXT); unlink(GRADS_BIN);
+	return bad;
+}
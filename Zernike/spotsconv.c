@@ -0,0 +1,52 @@
+/*
+ * spotsconv.c - convert text spots/gradients files into binary format
+ *
+ * Copyright 2013 Edward V. Emelianoff <eddy@sao.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include <unistd.h>
+
+#include "spots.h"
+
+extern char *__progname;
+
+void usage(){
+	printf("Usage:\t%s [-g] <input file> <output file>\n", __progname);
+	printf("\tconvert text spots-file (or gradients-file with -g) into binary\n");
+	exit(1);
+}
+
+int main(int argc, char **argv){
+	int opt, grads = 0;
+	while((opt = getopt(argc, argv, "g")) != -1){
+		switch(opt){
+			case 'g':
+				grads = 1;
+			break;
+			default:
+				usage();
+		}
+	}
+	if(argc - optind != 2) usage();
+	char *in = argv[optind], *out = argv[optind+1];
+	size_t N;
+	if(grads) N = gradients_txt2bin(in, out);
+	else N = spots_txt2bin(in, out);
+	printf("%zd %s converted\n", N, grads ? "gradients" : "spots");
+	return 0;
+}
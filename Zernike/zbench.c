@@ -0,0 +1,275 @@
+/*
+ * zbench.c - benchmark & accuracy test of Zernike decomposition functions:
+ *            throughput, peak memory & reconstruction error on synthetic
+ *            wavefronts with known coefficients
+ *
+ * Copyright 2013 Edward V. Emelianoff <eddy@sao.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <err.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "zernike.h"
+
+// QR_decompose allocates Sz x Sz matrix: don't run it for bigger points sets
+#define QR_MAXSZ    (8192)
+// obscuration for annular test
+#define ANN_EPS     (0.3)
+
+static double min_time = 0.3; // minimal time of each test (seconds)
+
+static double dtime(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+typedef enum{
+	M_GRID,    // Zdecompose
+	M_R,       // ZdecomposeR
+	M_LS,      // LS_decompose
+	M_QR,      // QR_decompose
+	M_GRAD,    // gradZdecomposeR
+	M_ANN,     // ann_Zdecompose
+	M_AMOUNT
+} method;
+
+static const char *names[M_AMOUNT] = {
+	"Zdecompose", "ZdecomposeR", "LS_decompose", "QR_decompose",
+	"gradZdecomposeR", "ann_Zdecompose"
+};
+
+// test data
+typedef struct{
+	int W, Nmax, pmax;
+	int Sz;          // amount of points
+	polar *P;        // points (grid nodes inside unit circle or annulus)
+	double *coeffs;  // known coefficients
+	double *image;   // WxW image for Zdecompose
+	double *heights; // wavefront in points P
+	point *grads;    // gradients (Zhao's polynomials with the same coefficients)
+} testdata;
+
+/**
+ * Build points set from nodes of WxW grid inside circle (with hole of radius eps)
+ */
+static polar *grid_points(int W, double eps, int *Sz){
+	polar *P = MALLOC(polar, W*W);
+	int i, j, N = 0;
+	double step = 2. / (W - 1);
+	for(j = 0; j < W; j++){
+		double y = j * step - 1.;
+		for(i = 0; i < W; i++){
+			double x = i * step - 1., r = sqrt(x*x + y*y);
+			if(r > 1. || r < eps) continue;
+			P[N].r = r;
+			P[N].theta = atan2(y, x);
+			++N;
+		}
+	}
+	*Sz = N;
+	return P;
+}
+
+/**
+ * Generate synthetic wavefront with random coefficients (decreasing with order)
+ */
+static void gen_data(testdata *T, int W, int Nmax, bool annular){
+	int p, n, m;
+	T->W = W; T->Nmax = Nmax;
+	T->pmax = (Nmax + 1) * (Nmax + 2) / 2;
+	T->P = grid_points(W, annular ? ANN_EPS : 0., &T->Sz);
+	T->coeffs = MALLOC(double, T->pmax);
+	srand48(W * 1000 + Nmax);
+	for(p = 1; p < T->pmax; p++){
+		convert_Zidx(p, &n, &m);
+		T->coeffs[p] = (2.*drand48() - 1.) / (1. + n);
+	}
+	T->image = Zcompose(T->pmax, T->coeffs, W, W);
+	T->heights = ZcomposeR(T->pmax, T->coeffs, T->Sz, T->P);
+	T->grads = gradZcomposeR(T->pmax, T->coeffs, T->Sz, T->P);
+}
+
+static void free_data(testdata *T){
+	FREE(T->P); FREE(T->coeffs); FREE(T->image);
+	FREE(T->heights); FREE(T->grads);
+}
+
+/**
+ * Run one decomposition
+ */
+static double *decompose(method M, testdata *T, int *Zsz, int *lastIdx){
+	switch(M){
+		case M_GRID:
+			return Zdecompose(T->Nmax, T->W, T->W, T->image, Zsz, lastIdx);
+		case M_R:
+			return ZdecomposeR(T->Nmax, T->Sz, T->P, T->heights, Zsz, lastIdx);
+		case M_LS:
+			return LS_decompose(T->Nmax, T->Sz, T->P, T->heights, Zsz, lastIdx);
+		case M_QR:
+			return QR_decompose(T->Nmax, T->Sz, T->P, T->heights, Zsz, lastIdx);
+		case M_GRAD:
+			return gradZdecomposeR(T->Nmax, T->Sz, T->P, T->grads, Zsz, lastIdx);
+		default:
+			return ann_Zdecompose(T->Nmax, T->Sz, T->P, T->heights, Zsz, lastIdx);
+	}
+}
+
+/**
+ * Relative RMS error of wavefront restored by coefficients Z
+ * @return error or -1 if method have no composing function
+ */
+static double rms_error(method M, testdata *T, int Zsz, double *Z){
+	double S = 0., S0 = 0.;
+	int i, N = T->Sz;
+	if(M == M_QR) return -1.; // coefficients of pseudo-annular basis
+	if(M == M_GRAD){
+		point *g = gradZcomposeR(Zsz, Z, N, T->P);
+		for(i = 0; i < N; i++){
+			double dx = g[i].x - T->grads[i].x, dy = g[i].y - T->grads[i].y;
+			S += dx*dx + dy*dy;
+			S0 += T->grads[i].x * T->grads[i].x + T->grads[i].y * T->grads[i].y;
+		}
+		FREE(g);
+	}else{
+		double *h, *h0 = T->heights;
+		if(M == M_GRID){
+			h = Zcompose(Zsz, Z, T->W, T->W);
+			h0 = T->image;
+			N = T->W * T->W;
+		}else if(M == M_ANN) h = ann_Zcompose(Zsz, Z, N, T->P);
+		else h = ZcomposeR(Zsz, Z, N, T->P);
+		for(i = 0; i < N; i++){
+			double d = h[i] - h0[i];
+			S += d*d;
+			S0 += h0[i] * h0[i];
+		}
+		FREE(h);
+	}
+	return sqrt(S / S0);
+}
+
+/**
+ * Max error of coefficients in Zernike basis
+ * @return error or -1 if coefficients are in other basis
+ */
+static double coeff_error(method M, testdata *T, int Zsz, double *Z){
+	if(M == M_QR || M == M_ANN) return -1.;
+	int p, N = (Zsz < T->pmax) ? Zsz : T->pmax;
+	double E = 0.;
+	for(p = 1; p < N; p++){
+		double d = fabs(Z[p] - T->coeffs[p]);
+		if(d > E) E = d;
+	}
+	return E;
+}
+
+/**
+ * Run test of method M on grid WxW with order Nmax in separate process
+ * (so peak RSS is measured for this test only)
+ */
+static void run_test(method M, int W, int Nmax){
+	fflush(stdout);
+	pid_t pid = fork();
+	if(pid < 0) err(1, "fork");
+	if(pid){
+		int status;
+		waitpid(pid, &status, 0);
+		if(!WIFEXITED(status) || WEXITSTATUS(status))
+			printf(RED "%-16s %5d %3d: test failed" OLDCOLOR "\n", names[M], W, Nmax);
+		return;
+	}
+	testdata T;
+	gen_data(&T, W, Nmax, M == M_ANN);
+	int Npts = (M == M_GRID) ? W*W : T.Sz;
+	if(M == M_QR && T.Sz > QR_MAXSZ){
+		printf("%-16s %5d %3d %8d  (skipped: too many points)\n", names[M], W, Nmax, Npts);
+		exit(0);
+	}
+	int Zsz, lastIdx, frames = 0;
+	double t0 = dtime();
+	double *Z = decompose(M, &T, &Zsz, &lastIdx);
+	double tfirst = dtime() - t0, t;
+	do{
+		FREE(Z);
+		Z = decompose(M, &T, &Zsz, &lastIdx);
+		++frames;
+		t = dtime() - t0 - tfirst;
+	}while(t < min_time || frames < 3);
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	double fps = frames / t, rms = rms_error(M, &T, Zsz, Z), cerr = coeff_error(M, &T, Zsz, Z);
+	printf("%-16s %5d %3d %8d %9.2f %9.1f %9.2f %8.1f ", names[M], W, Nmax, Npts,
+		tfirst*1e3, fps, fps*Npts*1e-6, ru.ru_maxrss / 1024.);
+	if(rms < 0.) printf("%10s ", "-");
+	else printf("%10.2e ", rms);
+	if(cerr < 0.) printf("%10s\n", "-");
+	else printf("%10.2e\n", cerr);
+	FREE(Z);
+	free_data(&T);
+	exit(0);
+}
+
+static void usage(char *name){
+	errx(1, "Usage: %s [-q] [-t time] [-m method]\n"
+		"\t-q        - quick run (small grids & orders)\n"
+		"\t-t time   - minimal time of each test, seconds (default 0.3)\n"
+		"\t-m method - run only given method (0..%d)", name, M_AMOUNT - 1);
+}
+
+int main(int argc, char **argv){
+	int sizes[] = {64, 128, 256, 0}, orders[] = {5, 10, 15, 0};
+	int opt, only = -1, i, j, k;
+	while((opt = getopt(argc, argv, "qt:m:")) != -1){
+		switch(opt){
+			case 'q':
+				sizes[2] = 0;
+				orders[2] = 0;
+			break;
+			case 't':
+				min_time = atof(optarg);
+				if(min_time <= 0.) usage(argv[0]);
+			break;
+			case 'm':
+				only = atoi(optarg);
+				if(only < 0 || only >= M_AMOUNT) usage(argv[0]);
+			break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	printf("SIMD level: %s\n\n", zk_level_name());
+	printf("%-16s %5s %3s %8s %9s %9s %9s %8s %10s %10s\n", "method", "grid", "N",
+		"points", "first,ms", "frames/s", "Mpts/s", "RSS,MB", "rms err", "coef err");
+	for(k = 0; k < M_AMOUNT; k++){
+		if(only > -1 && k != only) continue;
+		for(i = 0; sizes[i]; i++)
+			for(j = 0; orders[j]; j++)
+				run_test(k, sizes[i], orders[j]);
+	}
+	printf("\nfirst - time of first call (with basis calculation), frames/s & Mpts/s -\n"
+		"throughput of next calls; rms err - relative RMS error of restored wavefront\n"
+		"(gradients for gradZdecomposeR), coef err - max error of coefficients\n");
+	return 0;
+}
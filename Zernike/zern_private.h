@@ -27,6 +27,10 @@
 #include <string.h>
 #include <err.h>
 #include <stdio.h>
+#include <stdint.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #ifndef iabs
 #define iabs(a)  (((a)<(0)) ? (-a) : (a))
@@ -36,6 +40,16 @@
 #define DBG(...) do{fprintf(stderr, __VA_ARGS__); }while(0)
 #endif
 
+// don't run parallel cycles for arrays less than this size
+#define OMP_MINSZ   (16384)
+// max order of radial polynomial calculated by Horner scheme (its coefficients
+// grow as 2^n, so higher orders are calculated by recurrence)
+#define HORNER_NMAX (20)
+// index of R_n^m (0 <= m <= n, n-m is even) in table of radial polynomials
+#define RADIDX(n, m)  (((n)+1)*((n)+1)/4 + (m)/2)
+// size of table of radial polynomials with orders <= N
+#define RADSZ(N)      RADIDX((N)+1, 0)
+
 extern double *FK;
 extern double Z_prec;
 
@@ -44,8 +58,49 @@ void build_factorial();
 void free_rpow(double ***Rpow, int n);
 void build_rpow(int W, int H, int n, double **Rad, double ***Rad_pow);
 double **build_rpowR(int n, int Sz, polar *P);
+void radial_recur(int Nmax, double r, double *Rnm, double *dRnm);
+void radial_arr(int n, int m, int Sz, double *R, double **Rpow, double *Rad, double *dRad);
+double **radial_table(int Nmax, int Sz, const double *R);
+double proj_subtract(int SS, double *img, const double *Z, double norm);
+void add_poly(int SS, double *img, const double *Z, double K);
+
+// zern_simd.c
+double zk_dot(const double *a, const double *b, int n);
+void zk_axpy(double K, const double *x, double *y, int n);
+void zk_mul(const double *a, const double *b, double *out, int n);
+void zk_horner(int q, const double *c, const double *r, const double *rp, double *out, int n);
+
+/**
+ * Get part of array with size SS processed by current OpenMP thread
+ * (chunks are multiple of 8 to keep SIMD loops without tails)
+ * @param SS         - size of array
+ * @param start (o)  - index of chunk start
+ * @return chunk length
+ */
+static inline int omp_chunk(int SS, int *start){
+#ifdef _OPENMP
+	int N = omp_get_num_threads(), n = omp_get_thread_num();
+#else
+	int N = 1, n = 0;
+#endif
+	int L = ((SS + N - 1) / N + 7) & ~7;
+	int s = n * L, e = s + L;
+	if(s > SS) s = SS;
+	if(e > SS) e = SS;
+	*start = s;
+	return e - s;
+}
+
+/**
+ * Normalization factor of radial polynomial R_n^m
+ */
+static inline double radial_norm(int n, int m){
+	double eps_m = (m) ? 1. : 2.;
+	return sqrt(2.*(n+1.) / M_PI / eps_m);
+}
 
 // zernike_annular.c
-polar *conv_r(polar *r0, int Sz);
+polar *conv_r(polar *r0, int Sz, double *eps);
+uint64_t points_hash(int Sz, polar *P, double *eps);
 
 #endif // __ZERN_PRIVATE_H__
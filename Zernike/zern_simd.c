@@ -0,0 +1,263 @@
+/*
+ * zern_simd.c - SIMD kernels for Zernike transforms with runtime dispatch
+ *
+ * Copyright 2013 Edward V. Emelianoff <eddy@sao.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+/*
+ * All kernels have scalar, SSE2 and AVX2+FMA realisations; the best of them is
+ * selected at startup by CPUID (gcc builtins), so binary built without
+ * -march=native works on any x86_64 CPU. On other architectures only scalar
+ * code (autovectorized by compiler) is used.
+ * Arrays shouldn't be aligned, tails are processed by scalar code (after
+ * vzeroupper: without it all following SSE code of program runs many times slower).
+ * General-purpose kernels live in _snippets/avx/vkern (canonical library), here are
+ * only kernels of this module, so that it builds standalone.
+ */
+
+#include "zernike.h"
+#include "zern_private.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ZK_X86
+#include <immintrin.h>
+#endif
+
+/*************** scalar realisation ***************/
+
+static double dot_scalar(const double *a, const double *b, int n){
+	double s = 0.;
+	int i;
+	for(i = 0; i < n; i++) s += a[i] * b[i];
+	return s;
+}
+
+static void axpy_scalar(double K, const double *x, double *y, int n){
+	int i;
+	for(i = 0; i < n; i++) y[i] += K * x[i];
+}
+
+static void mul_scalar(const double *a, const double *b, double *out, int n){
+	int i;
+	for(i = 0; i < n; i++) out[i] = a[i] * b[i];
+}
+
+static void horner_scalar(int q, const double *c, const double *r, const double *rp, double *out, int n){
+	int i, k;
+	for(i = 0; i < n; i++){
+		double x = r[i] * r[i], acc = c[0];
+		for(k = 1; k <= q; k++) acc = acc * x + c[k];
+		out[i] = rp ? acc * rp[i] : acc;
+	}
+}
+
+#ifdef ZK_X86
+/*************** SSE2 realisation ***************/
+
+__attribute__((target("sse2")))
+static double dot_sse2(const double *a, const double *b, int n){
+	__m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+	int i;
+	for(i = 0; i + 4 <= n; i += 4){
+		s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a+i), _mm_loadu_pd(b+i)));
+		s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a+i+2), _mm_loadu_pd(b+i+2)));
+	}
+	s0 = _mm_add_pd(s0, s1);
+	double tmp[2];
+	_mm_storeu_pd(tmp, s0);
+	return tmp[0] + tmp[1] + dot_scalar(a+i, b+i, n-i);
+}
+
+__attribute__((target("sse2")))
+static void axpy_sse2(double K, const double *x, double *y, int n){
+	__m128d k = _mm_set1_pd(K);
+	int i;
+	for(i = 0; i + 2 <= n; i += 2)
+		_mm_storeu_pd(y+i, _mm_add_pd(_mm_loadu_pd(y+i), _mm_mul_pd(k, _mm_loadu_pd(x+i))));
+	axpy_scalar(K, x+i, y+i, n-i);
+}
+
+__attribute__((target("sse2")))
+static void mul_sse2(const double *a, const double *b, double *out, int n){
+	int i;
+	for(i = 0; i + 2 <= n; i += 2)
+		_mm_storeu_pd(out+i, _mm_mul_pd(_mm_loadu_pd(a+i), _mm_loadu_pd(b+i)));
+	mul_scalar(a+i, b+i, out+i, n-i);
+}
+
+__attribute__((target("sse2")))
+static void horner_sse2(int q, const double *c, const double *r, const double *rp, double *out, int n){
+	int i, k;
+	for(i = 0; i + 2 <= n; i += 2){
+		__m128d rr = _mm_loadu_pd(r+i), x = _mm_mul_pd(rr, rr), acc = _mm_set1_pd(c[0]);
+		for(k = 1; k <= q; k++)
+			acc = _mm_add_pd(_mm_mul_pd(acc, x), _mm_set1_pd(c[k]));
+		if(rp) acc = _mm_mul_pd(acc, _mm_loadu_pd(rp+i));
+		_mm_storeu_pd(out+i, acc);
+	}
+	horner_scalar(q, c, r+i, rp ? rp+i : NULL, out+i, n-i);
+}
+
+/*************** AVX2 + FMA realisation ***************/
+
+__attribute__((target("avx2,fma")))
+static double dot_avx2(const double *a, const double *b, int n){
+	__m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+	int i;
+	for(i = 0; i + 8 <= n; i += 8){ // two accumulators to hide FMA latency
+		s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a+i), _mm256_loadu_pd(b+i), s0);
+		s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a+i+4), _mm256_loadu_pd(b+i+4), s1);
+	}
+	s0 = _mm256_add_pd(s0, s1);
+	// reduce: like reduce_vector2() from _snippets/avx/dotproduct.c
+	__m128d sum = _mm_add_pd(_mm256_extractf128_pd(s0, 1), _mm256_castpd256_pd128(s0));
+	sum = _mm_add_sd(sum, _mm_unpackhi_pd(sum, sum));
+	_mm256_zeroupper(); // avoid AVX->SSE transition penalty in scalar code
+	return _mm_cvtsd_f64(sum) + dot_scalar(a+i, b+i, n-i);
+}
+
+__attribute__((target("avx2,fma")))
+static void axpy_avx2(double K, const double *x, double *y, int n){
+	__m256d k = _mm256_set1_pd(K);
+	int i;
+	for(i = 0; i + 4 <= n; i += 4)
+		_mm256_storeu_pd(y+i, _mm256_fmadd_pd(k, _mm256_loadu_pd(x+i), _mm256_loadu_pd(y+i)));
+	_mm256_zeroupper();
+	axpy_scalar(K, x+i, y+i, n-i);
+}
+
+__attribute__((target("avx2,fma")))
+static void mul_avx2(const double *a, const double *b, double *out, int n){
+	int i;
+	for(i = 0; i + 4 <= n; i += 4)
+		_mm256_storeu_pd(out+i, _mm256_mul_pd(_mm256_loadu_pd(a+i), _mm256_loadu_pd(b+i)));
+	_mm256_zeroupper();
+	mul_scalar(a+i, b+i, out+i, n-i);
+}
+
+__attribute__((target("avx2,fma")))
+static void horner_avx2(int q, const double *c, const double *r, const double *rp, double *out, int n){
+	int i, k;
+	for(i = 0; i + 4 <= n; i += 4){
+		__m256d rr = _mm256_loadu_pd(r+i), x = _mm256_mul_pd(rr, rr), acc = _mm256_set1_pd(c[0]);
+		for(k = 1; k <= q; k++)
+			acc = _mm256_fmadd_pd(acc, x, _mm256_set1_pd(c[k]));
+		if(rp) acc = _mm256_mul_pd(acc, _mm256_loadu_pd(rp+i));
+		_mm256_storeu_pd(out+i, acc);
+	}
+	_mm256_zeroupper();
+	horner_scalar(q, c, r+i, rp ? rp+i : NULL, out+i, n-i);
+}
+#endif // ZK_X86
+
+/*************** dispatcher ***************/
+
+static double (*dot_fn)(const double*, const double*, int) = dot_scalar;
+static void (*axpy_fn)(double, const double*, double*, int) = axpy_scalar;
+static void (*mul_fn)(const double*, const double*, double*, int) = mul_scalar;
+static void (*horner_fn)(int, const double*, const double*, const double*, double*, int) = horner_scalar;
+static zk_level zk_current = ZK_SCALAR;
+
+static const char *zk_names[] = {
+	[ZK_SCALAR] = "scalar",
+	[ZK_SSE2] = "SSE2",
+	[ZK_AVX2] = "AVX2+FMA"
+};
+
+/**
+ * Select SIMD realisation of kernels
+ * @param level - max level allowed (real level could be less if CPU don't support it)
+ * @return selected level
+ */
+zk_level zk_set_level(zk_level level){
+	zk_level l = ZK_SCALAR;
+#ifdef ZK_X86
+	__builtin_cpu_init();
+	if(level >= ZK_AVX2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		l = ZK_AVX2;
+	else if(level >= ZK_SSE2 && __builtin_cpu_supports("sse2"))
+		l = ZK_SSE2;
+#else
+	(void) level;
+#endif
+	switch(l){
+#ifdef ZK_X86
+		case ZK_AVX2:
+			dot_fn = dot_avx2; axpy_fn = axpy_avx2; mul_fn = mul_avx2; horner_fn = horner_avx2;
+		break;
+		case ZK_SSE2:
+			dot_fn = dot_sse2; axpy_fn = axpy_sse2; mul_fn = mul_sse2; horner_fn = horner_sse2;
+		break;
+#endif
+		default:
+			dot_fn = dot_scalar; axpy_fn = axpy_scalar; mul_fn = mul_scalar; horner_fn = horner_scalar;
+	}
+	zk_current = l;
+	return l;
+}
+
+/**
+ * @return name of current SIMD realisation
+ */
+const char *zk_level_name(){
+	return zk_names[zk_current];
+}
+
+// select the best realisation at startup
+__attribute__((constructor)) static void zk_init(){
+	zk_set_level(ZK_AVX2);
+}
+
+/**
+ * Dot product of two arrays
+ * @param a, b - arrays
+ * @param n    - their length
+ * @return sum(a[i]*b[i])
+ */
+double zk_dot(const double *a, const double *b, int n){
+	return dot_fn(a, b, n);
+}
+
+/**
+ * y[i] += K*x[i]
+ */
+void zk_axpy(double K, const double *x, double *y, int n){
+	axpy_fn(K, x, y, n);
+}
+
+/**
+ * out[i] = a[i]*b[i] (e.g. R^{n+1} = R^n * R)
+ */
+void zk_mul(const double *a, const double *b, double *out, int n){
+	mul_fn(a, b, out, n);
+}
+
+/**
+ * Evaluation of polynomial by R^2 by Horner scheme:
+ *     out[i] = rp[i] * (c[0]*x^q + c[1]*x^{q-1} + ... + c[q]), x = r[i]^2
+ * (so radial Zernike polynomial R_n^m is evaluated with q=(n-|m|)/2 and rp=R^|m|)
+ * @param q  - power of polynomial by x
+ * @param c  - coefficients (q+1 values), c[0] is for highest power
+ * @param r  - array with R
+ * @param rp - array of multipliers (or NULL)
+ * @param out- output array
+ * @param n  - length of arrays
+ */
+void zk_horner(int q, const double *c, const double *r, const double *rp, double *out, int n){
+	horner_fn(q, c, r, rp, out, n);
+}
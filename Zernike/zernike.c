@@ -64,6 +64,60 @@ void *my_alloc(size_t N, size_t S){
 	return p;
 }
 
+/**
+ * Allocate 2D array in one contiguous block (rows are aligned to 64 bytes)
+ * @param len  - size of rows
+ * @param num  - number of rows
+ * @param cols - 1D arrays are columns (len x num matrix) instead of rows
+ * @return array filled with zeros
+ */
+static _2D *alloc_2D(int len, int num, bool cols){
+	_2D *r = MALLOC(_2D, 1);
+	size_t W = cols ? num : len, H = cols ? len : num, x;
+	r->tda = (W + 7) & ~(size_t)7;
+	if(r->tda == 0) r->tda = 8;
+	size_t S = r->tda * H * sizeof(double);
+	if(S == 0) S = 64;
+	if(posix_memalign((void**)&r->block, 64, S)) err(1, "posix_memalign");
+	memset(r->block, 0, S);
+	r->len = (size_t)len;
+	r->num = (size_t)num;
+	r->cols = cols;
+	if(!cols){
+		r->data = MALLOC(double*, num);
+		for(x = 0; x < H; x++)
+			r->data[x] = &r->block[x * r->tda];
+	}
+	return r;
+}
+
+/**
+ * Allocate 2D array (num arrays of length len)
+ * @param len - array's width  (number of elements in each 1D array
+ * @param num - array's height (number of 1D arrays)
+ * @return dinamically allocated 2D array filled with zeros
+ */
+_2D *_2ALLOC(int len, int num){
+	return alloc_2D(len, num, false);
+}
+
+/**
+ * Allocate 2D array whose 1D arrays are columns of len x num matrix
+ * (e.g. design matrix for GSL: get it by _2D_view), data field is NULL
+ * @param len - number of elements in each 1D array (rows)
+ * @param num - number of 1D arrays (columns)
+ * @return dinamically allocated 2D array filled with zeros
+ */
+_2D *_2ALLOC_COLS(int len, int num){
+	return alloc_2D(len, num, true);
+}
+
+void _2FREE(_2D **a){
+	free((*a)->block);
+	free((*a)->data);
+	FREE(*a);
+}
+
 double *FK = NULL;
 /**
  * Build pre-computed array of factorials from 1 to 100
@@ -91,6 +145,62 @@ double get_prec(){
 	return Z_prec;
 }
 
+/**
+ * Set amount of threads for parallel calculations
+ * @param N - number of threads (N < 1 - use all available cores)
+ */
+void set_threads(int N){
+#ifdef _OPENMP
+	if(N < 1) N = omp_get_num_procs();
+	omp_set_num_threads(N);
+#else
+	(void) N;
+#endif
+}
+
+/**
+ * Find projection of image to polynomial & subtract it from image
+ * (if projection is less than Z_prec, image stays unchanged)
+ * Image is divided into tiles processed by different threads with
+ * partial sums collected by reduction
+ * @param SS       - size of arrays
+ * @param img (io) - image (will be modified)
+ * @param Z (i)    - polynomial values
+ * @param norm     - polynomial's norm, sum(Z^2)
+ * @return coefficient of decomposition
+ */
+double proj_subtract(int SS, double *img, const double *Z, double norm){
+	double K = 0.;
+	#pragma omp parallel reduction(+:K) if(SS > OMP_MINSZ)
+	{
+		int from, len = omp_chunk(SS, &from);
+		K += zk_dot(&Z[from], &img[from], len); // multiply matrixes to get coefficient
+	}
+	K /= norm;
+	if(fabs(K) < Z_prec) return K;
+	#pragma omp parallel if(SS > OMP_MINSZ)
+	{
+		int from, len = omp_chunk(SS, &from);
+		zk_axpy(-K, &Z[from], &img[from], len); // subtract composed coefficient to reduce high orders values
+	}
+	return K;
+}
+
+/**
+ * Add polynomial multiplied by K to image
+ * @param SS       - size of arrays
+ * @param img (io) - image
+ * @param Z (i)    - polynomial values
+ * @param K        - coefficient
+ */
+void add_poly(int SS, double *img, const double *Z, double K){
+	#pragma omp parallel if(SS > OMP_MINSZ)
+	{
+		int from, len = omp_chunk(SS, &from);
+		zk_axpy(K, &Z[from], &img[from], len); // add next Zernike polynomial
+	}
+}
+
 /**
  * Convert polynomial order in Noll notation into n/m
  * @param p (i) - order of Zernike polynomial in Noll notation
@@ -124,7 +234,7 @@ void free_rpow(double ***Rpow, int n){
  */
 void build_rpow(int W, int H, int n, double **Rad, double ***Rad_pow){
 	double Rnorm = fmax((W - 1.) / 2., (H - 1.) / 2.);
-	int i,j, k, N = n+1, w = (W+1)/2, h = (H+1)/2, S = w*h;
+	int i,j, N = n+1, w = (W+1)/2, h = (H+1)/2, S = w*h;
 	double **Rpow = MALLOC(double*, N); // powers of R
 	Rpow[0] = MALLOC(double, S);
 	for(j = 0; j < S; j++) Rpow[0][j] = 1.; // zero's power
@@ -140,13 +250,7 @@ void build_rpow(int W, int H, int n, double **Rad, double ***Rad_pow){
 	}
 	for(i = 1; i < N; i++){ // Rpow - is quater I of cartesian coordinates ('cause other are fully simmetrical)
 		Rpow[i] = MALLOC(double, S);
-		double *rp = Rpow[i], *rpo = Rpow[i-1];
-		for(j = 0; j < h; j++){
-			int idx = j*w;
-			double *pt = &rp[idx], *pto = &rpo[idx], *r = &R[idx];
-			for(k = 0; k < w; k++, pt++, pto++, r++)
-				*pt = (*pto) * (*r); // R^{n+1} = R^n * R
-		}
+		zk_mul(Rpow[i-1], R, Rpow[i], S); // R^{n+1} = R^n * R
 	}
 	if(Rad) *Rad = R;
 	else FREE(R);
@@ -154,6 +258,196 @@ void build_rpow(int W, int H, int n, double **Rad, double ***Rad_pow){
 	else free_rpow(&Rpow, n);
 }
 
+/**
+ * Calculate coefficients of normalized radial polynomial R_n^m and its derivative
+ * for Horner scheme by R^2 (see zk_horner):
+ *   R_n^m = R^|m| * Horner(c, R^2),  dR_n^m/dR = R^e * Horner(dc, R^2),
+ *   where e = |m|-1 for m != 0 and e = 1 for m == 0
+ * @param n, m   - orders of polynomial
+ * @param c (o)  - coefficients of R_n^m ((n-|m|)/2+1 values)
+ * @param dc (o) - NULL or coefficients of derivative (the same size)
+ * @return power of derivative polynomial by R^2
+ */
+static int radial_coefs(int n, int m, double *c, double *dc){
+	int k, m_abs = iabs(m), iup = (n-m_abs)/2;
+	double sq = radial_norm(n, m);
+	for(k = 0; k <= iup; k++){
+		c[k] = sq * (1. - 2. * (k % 2)) * FK[n - k]        //       (-1)^k * (n-k)!
+			/(//----------------------------------- -----   -------------------------------
+				FK[k]*FK[(n+m_abs)/2-k]*FK[(n-m_abs)/2-k] // k!((n+|m|)/2-k)!((n-|m|)/2-k)!
+			);
+		if(dc) dc[k] = c[k] * (n - 2*k); // d(R^{n-2k})/dR = (n-2k)*R^{n-2k-1}
+	}
+	// for m == 0 the last term is constant, its derivative is zero
+	return (m_abs) ? iup : iup - 1;
+}
+
+/**
+ * Calculate all radial polynomials R_n^m (n <= Nmax, 0 <= m <= n, n-m even) in one point
+ * by Kintner's recurrence (no factorials, so it is stable for high orders):
+ *   R_n^m = r(R_{n-1}^{|m-1|} + R_{n-1}^{m+1}) - R_{n-2}^m,  R_0^0 = 1,
+ *   terms with m > n are zero
+ * @param Nmax     - max order of polynomials
+ * @param r        - radius
+ * @param Rnm (o)  - array with RADSZ(Nmax) not normalized R_n^m (index RADIDX(n,m))
+ * @param dRnm (o) - NULL or array with dR_n^m/dr (the same size)
+ */
+void radial_recur(int Nmax, double r, double *Rnm, double *dRnm){
+	int n, m;
+	Rnm[0] = 1.;
+	if(dRnm) dRnm[0] = 0.;
+	for(n = 1; n <= Nmax; n++){
+		int cur = RADIDX(n, 0), prev = RADIDX(n-1, 0), prev2 = (n > 1) ? RADIDX(n-2, 0) : 0;
+		for(m = n % 2; m <= n; m += 2){
+			int i1 = prev + iabs(m-1)/2, i2 = prev + (m+1)/2, i3 = prev2 + m/2;
+			bool low = (m < n - 1); // R_{n-1}^{m+1} and R_{n-2}^m exist
+			double sum = Rnm[i1] + (low ? Rnm[i2] : 0.);
+			Rnm[cur + m/2] = r * sum - (low ? Rnm[i3] : 0.);
+			if(!dRnm) continue;
+			double dsum = dRnm[i1] + (low ? dRnm[i2] : 0.);
+			dRnm[cur + m/2] = sum + r * dsum - (low ? dRnm[i3] : 0.);
+		}
+	}
+}
+
+/**
+ * Calculate radial polynomial (and its derivative) on array of points in parallel
+ * (e.g. quater I of matrix); low orders are calculated by Horner scheme, high - by recurrence
+ * @param n, m      - orders of polynomial
+ * @param Sz        - amount of points
+ * @param R, Rpow   - arrays with R and its powers (power >= n)
+ * @param Rad (o)   - normalized R_n^m
+ * @param dRad (o)  - NULL or dR_n^m/dR
+ */
+void radial_arr(int n, int m, int Sz, double *R, double **Rpow, double *Rad, double *dRad){
+	int m_abs = iabs(m), iup = (n-m_abs)/2;
+	if(n > HORNER_NMAX){
+		int idx = RADIDX(n, m_abs);
+		double sq = radial_norm(n, m);
+		#pragma omp parallel if(Sz > OMP_MINSZ / 16)
+		{
+			int j;
+			double *Rnm = MALLOC(double, RADSZ(n)), *dRnm = NULL;
+			if(dRad) dRnm = MALLOC(double, RADSZ(n));
+			#pragma omp for
+			for(j = 0; j < Sz; j++){
+				radial_recur(n, R[j], Rnm, dRnm);
+				Rad[j] = sq * Rnm[idx];
+				if(dRad) dRad[j] = sq * dRnm[idx];
+			}
+			FREE(Rnm);
+			FREE(dRnm);
+		}
+		return;
+	}
+	double c[iup+1], dc[iup+1];
+	int dq = radial_coefs(n, m, c, dRad ? dc : NULL);
+	double *dp = NULL;
+	if(dRad) dp = (m_abs) ? Rpow[m_abs-1] : R;
+	#pragma omp parallel if(Sz > OMP_MINSZ)
+	{
+		int from, len = omp_chunk(Sz, &from);
+		zk_horner(iup, c, &R[from], &Rpow[m_abs][from], &Rad[from], len);
+		if(dRad && dq >= 0) zk_horner(dq, dc, &R[from], &dp[from], &dRad[from], len);
+	}
+}
+
+/**
+ * Calculate all normalized radial polynomials with orders <= Nmax on array of points
+ * by recurrence in one pass (points are processed in parallel)
+ * @param Nmax  - max order of polynomials
+ * @param Sz    - amount of points
+ * @param R (i) - array with R
+ * @return table with RADSZ(Nmax) arrays of size Sz, R_n^m is in RADIDX(n,m)'th array
+ *         (free it by free_rpow(&table, RADSZ(Nmax)-1))
+ */
+double **radial_table(int Nmax, int Sz, const double *R){
+	int n, m, N = RADSZ(Nmax);
+	double **tab = MALLOC(double*, N), sq[N];
+	for(n = 0; n <= Nmax; n++)
+		for(m = n % 2; m <= n; m += 2){
+			tab[RADIDX(n, m)] = MALLOC(double, Sz);
+			sq[RADIDX(n, m)] = radial_norm(n, m);
+		}
+	#pragma omp parallel if(Sz > OMP_MINSZ / 16)
+	{
+		int i, j;
+		double *Rnm = MALLOC(double, N);
+		#pragma omp for
+		for(j = 0; j < Sz; j++){
+			radial_recur(Nmax, R[j], Rnm, NULL);
+			for(i = 0; i < N; i++) tab[i][j] = sq[i] * Rnm[i];
+		}
+		FREE(Rnm);
+	}
+	return tab;
+}
+
+/**
+ * Calculate sin(m*theta) & cos(m*theta) for point (dx, dy) without atan2:
+ *    cos/sin of theta are dx/r & dy/r, m-th power of (cos + i*sin) is got by recurrence
+ * @param dx, dy      - point coordinates relative to center
+ * @param m_abs       - |m|
+ * @param s1, c1 (o)  - sin(theta), cos(theta) (may be NULL)
+ * @param sm, cm (o)  - sin(m*theta), cos(m*theta)
+ */
+static inline void sincos_m(double dx, double dy, int m_abs,
+				double *s1, double *c1, double *sm, double *cm){
+	double r = sqrt(dx*dx + dy*dy), st = 0., ct = 1.; // atan2(0,0) == 0
+	if(r > 0.){ st = dy / r; ct = dx / r; }
+	if(s1) *s1 = st;
+	if(c1) *c1 = ct;
+	double s = 0., c = 1.;
+	while(m_abs--){
+		double cn = c*ct - s*st;
+		s = s*ct + c*st;
+		c = cn;
+	}
+	*sm = s; *cm = c;
+}
+
+/**
+ * Fill array Zarr by values of Zernike polynomial Z(n,m) on rectangular matrix WxH
+ * using pre-computed R and normalized R_n^m on quater I
+ * @param m        - angular order of polynomial (should be checked before call)
+ * @param W, H     - size of matrix
+ * @param R (i)    - array with R in quater I
+ * @param Rad (i)  - array with R_n^m in quater I
+ * @param Zarr (o) - output array (W*H, filled by zeros)
+ * @return sum(Z^2) - normalize factor
+ */
+static double zern_fill(int m, int W, int H, const double *R, const double *Rad, double *Zarr){
+	double Xc = (W - 1.) / 2., Yc = (H - 1.) / 2.; // coordinate of circle's middle
+	int j, m_abs = iabs(m), w = (W+1)/2;
+	double ZSum = 0.;
+	// rows are independent, so they can be calculated in parallel
+	#pragma omp parallel for reduction(+:ZSum) if(W*H > OMP_MINSZ)
+	for(j = 0; j < H; j++){
+		int i;
+		double *Zptr = &Zarr[j*W];
+		double Ryd = fabs(j - Yc);
+		int Ry = w * (int)Ryd; // Y coordinate on R matrix
+		for(i = 0; i < W; i++, Zptr++){
+			double Rxd = fabs(i - Xc);
+			int Ridx = Ry + (int)Rxd; // coordinate on R matrix
+			if(R[Ridx] > 1.) continue; // throw out points with R>1
+			double Z = Rad[Ridx]; // R_n^m
+			// multiply to angular function:
+			if(m){
+				double sm, cm;
+				sincos_m(i - Xc, j - Yc, m_abs, NULL, NULL, &sm, &cm);
+				if(m > 0)
+					Z *= cm;
+				else
+					Z *= sm;
+			}
+			*Zptr = Z;
+			ZSum += Z*Z;
+		}
+	}
+	return ZSum;
+}
+
 /**
  * Calculate value of Zernike polynomial on rectangular matrix WxH pixels
  * Center of matrix will be zero point
@@ -166,7 +460,7 @@ void build_rpow(int W, int H, int n, double **Rad, double ***Rad_pow){
  * @return array of Zernike polynomials on given matrix
  */
 double *zernfun(int n, int m, int W, int H, double *norm){
-	double Z = 0., *Zarr = NULL;
+	double *Zarr = NULL;
 	bool erparm = false;
 	if(W < 2 || H < 2)
 		errx(1, "Sizes of matrix must be > 2!");
@@ -179,48 +473,18 @@ double *zernfun(int n, int m, int W, int H, double *norm){
 	if(erparm)
 		errx(1, "Wrong parameters of Zernike polynomial (%d, %d)", n, m);
 	if(!FK) build_factorial();
-	double Xc = (W - 1.) / 2., Yc = (H - 1.) / 2.; // coordinate of circle's middle
-	int i, j, k, m_abs = iabs(m), iup = (n-m_abs)/2, w = (W+1)/2;
 	double *R, **Rpow;
 	build_rpow(W, H, n, &R, &Rpow);
-	int SS = W * H;
-	double ZSum = 0.;
 	// now fill output matrix
-	Zarr = MALLOC(double, SS); // output matrix W*H pixels
-	for(j = 0; j < H; j++){
-		double *Zptr = &Zarr[j*W];
-		double Ryd = fabs(j - Yc);
-		int Ry = w * (int)Ryd; // Y coordinate on R matrix
-		for(i = 0; i < W; i++, Zptr++){
-			Z = 0.;
-			double Rxd = fabs(i - Xc);
-			int Ridx = Ry + (int)Rxd; // coordinate on R matrix
-			if(R[Ridx] > 1.) continue; // throw out points with R>1
-			// calculate R_n^m
-			for(k = 0; k <= iup; k++){ // Sum
-				double z = (1. - 2. * (k % 2)) * FK[n - k]        //       (-1)^k * (n-k)!
-					/(//----------------------------------- -----   -------------------------------
-						FK[k]*FK[(n+m_abs)/2-k]*FK[(n-m_abs)/2-k] // k!((n+|m|)/2-k)!((n-|m|)/2-k)!
-					);
-				Z += z * Rpow[n-2*k][Ridx];  // *R^{n-2k}
-			}
-			// normalize
-			double eps_m = (m) ? 1. : 2.;
-			Z *= sqrt(2.*(n+1.) / M_PI / eps_m);
-			double theta = atan2(j - Yc, i - Xc);
-			// multiply to angular function:
-			if(m){
-				if(m > 0)
-					Z *= cos(theta*(double)m_abs);
-				else
-					Z *= sin(theta*(double)m_abs);
-			}
-			*Zptr = Z;
-			ZSum += Z*Z;
-		}
-	}
+	Zarr = MALLOC(double, W * H); // output matrix W*H pixels
+	// normalized R_n^m is the same for all quaters, so calculate it once
+	int S = ((W+1)/2) * ((H+1)/2);
+	double *Rad = MALLOC(double, S);
+	radial_arr(n, m, S, R, Rpow, Rad, NULL);
+	double ZSum = zern_fill(m, W, H, R, Rad, Zarr);
 	if(norm) *norm = ZSum;
 	// free unneeded memory
+	FREE(Rad);
 	FREE(R);
 	free_rpow(&Rpow, n);
 	return Zarr;
@@ -257,19 +521,14 @@ double *Zdecompose(int Nmax, int W, int H, double *image, int *Zsz, int *lastIdx
 	*Zsz = pmax;
 	for(i = 0; i < pmax; i++){ // now we fill array
 		double norm, *Zcoeff = zernfunN(i, W, H, &norm);
-		int j;
-		double *iptr = icopy, *zptr = Zcoeff, K = 0.;
-		for(j = 0; j < SS; j++, iptr++, zptr++)
-			K += (*zptr) * (*iptr) / norm; // multiply matrixes to get coefficient
+		double K = proj_subtract(SS, icopy, Zcoeff, norm);
 		Zidxs[i] = K;
 		if(fabs(K) < Z_prec){
 			Zidxs[i] = 0.;
+			FREE(Zcoeff);
 			continue; // there's no need to substract values that are less than our precision
 		}
 		maxIdx = i;
-		iptr = icopy; zptr = Zcoeff;
-		for(j = 0; j < SS; j++, iptr++, zptr++)
-			*iptr -= K * (*zptr); // subtract composed coefficient to reduce high orders values
 		FREE(Zcoeff);
 	}
 	if(lastIdx) *lastIdx = maxIdx;
@@ -291,15 +550,107 @@ double *Zcompose(int Zsz, double *Zidxs, int W, int H){
 		double K = Zidxs[i];
 		if(fabs(K) < Z_prec) continue;
 		double *Zcoeff = zernfunN(i, W, H, NULL);
-		int j;
-		double *iptr = image, *zptr = Zcoeff;
-		for(j = 0; j < SS; j++, iptr++, zptr++)
-			*iptr += K * (*zptr); // add next Zernike polynomial
+		add_poly(SS, image, Zcoeff, K);
 		FREE(Zcoeff);
 	}
 	return image;
 }
 
+/**
+ * Build Zernike basis plan: all polynomials with order <= Nmax on matrix WxH
+ * are calculated once (with common R powers), so the plan can be reused for
+ * decomposition/composition of any amount of images with the same geometry
+ * @param Nmax - maximum power of Zernike polinomial
+ * @param W, H - size of image
+ * @return dynamically allocated plan (free it by Zplan_free)
+ */
+Zplan *Zplan_new(int Nmax, int W, int H){
+	if(W < 2 || H < 2)
+		errx(1, "Sizes of matrix must be > 2!");
+	if(Nmax < 0 || Nmax > 100)
+		errx(1, "Order of Zernike polynomial must be in [0, 100]!");
+	int p, SS = W*H, pmax = (Nmax + 1) * (Nmax + 2) / 2; // max Z number in Noll notation
+	Zplan *plan = MALLOC(Zplan, 1);
+	plan->W = W; plan->H = H;
+	plan->Nmax = Nmax; plan->pmax = pmax;
+	plan->Z = MALLOC(double*, pmax);
+	plan->norm = MALLOC(double, pmax);
+	double *R;
+	build_rpow(W, H, 0, &R, NULL);
+	// all radial polynomials are calculated at once by recurrence
+	double **Rad = radial_table(Nmax, ((W+1)/2) * ((H+1)/2), R);
+	// polynomials are independent: calculate them in parallel (nested loop in zern_fill
+	// won't be parallelized as nested parallelism is off by default)
+	#pragma omp parallel for schedule(dynamic)
+	for(p = 0; p < pmax; p++){
+		int n, m;
+		convert_Zidx(p, &n, &m);
+		plan->Z[p] = MALLOC(double, SS);
+		plan->norm[p] = zern_fill(m, W, H, R, Rad[RADIDX(n, iabs(m))], plan->Z[p]);
+	}
+	FREE(R);
+	free_rpow(&Rad, RADSZ(Nmax) - 1);
+	return plan;
+}
+
+/**
+ * Free memory allocated for plan
+ * @param plan (io) - plan to free (will be set to NULL)
+ */
+void Zplan_free(Zplan **plan){
+	if(!plan || !*plan) return;
+	int p, pmax = (*plan)->pmax;
+	for(p = 0; p < pmax; p++) FREE((*plan)->Z[p]);
+	FREE((*plan)->Z);
+	FREE((*plan)->norm);
+	FREE(*plan);
+}
+
+/**
+ * Zernike decomposition of image by pre-computed basis
+ * @param plan (i)    - basis plan (built for image size and Nmax)
+ * @param image(i)    - image itself (plan->W x plan->H pixels)
+ * @param Zsz  (o)    - size of Z coefficients array
+ * @param lastIdx (o) - (if !NULL) last non-zero coefficient
+ * @return array of Zernike coefficients (the same as Zdecompose)
+ */
+double *Zdecompose_plan(Zplan *plan, double *image, int *Zsz, int *lastIdx){
+	int i, SS = plan->W * plan->H, pmax = plan->pmax, maxIdx = 0;
+	double *Zidxs = MALLOC(double, pmax), *icopy = MALLOC(double, SS);
+	memcpy(icopy, image, SS*sizeof(double)); // make image copy to leave it unchanged
+	*Zsz = pmax;
+	for(i = 0; i < pmax; i++){
+		double K = proj_subtract(SS, icopy, plan->Z[i], plan->norm[i]);
+		if(fabs(K) < Z_prec)
+			continue; // there's no need to substract values that are less than our precision
+		Zidxs[i] = K;
+		maxIdx = i;
+	}
+	if(lastIdx) *lastIdx = maxIdx;
+	FREE(icopy);
+	return Zidxs;
+}
+
+/**
+ * Zernike restoration of image by pre-computed basis
+ * @param plan (i) - basis plan
+ * @param Zsz  (i) - number of elements in coefficients array (<= plan->pmax)
+ * @param Zidxs(i) - array with Zernike coefficients
+ * @return restored image (plan->W x plan->H pixels)
+ */
+double *Zcompose_plan(Zplan *plan, int Zsz, double *Zidxs){
+	int i, SS = plan->W * plan->H;
+	if(Zsz > plan->pmax)
+		errx(1, "Plan contains only %d polynomials (%d requested)!", plan->pmax, Zsz);
+	double *image = MALLOC(double, SS);
+	for(i = 0; i < Zsz; i++){
+		double K = Zidxs[i];
+		if(fabs(K) < Z_prec) continue;
+		add_poly(SS, image, plan->Z[i], K);
+	}
+	return image;
+}
+
 
 /**
  * Components of Zj gradient without constant factor
@@ -321,10 +672,13 @@ point *gradZ(int n, int m, int W, int H, double *norm){
 		errx(1, "Wrong parameters of  gradient of Zernike polynomial (%d, %d)", n, m);
 	if(!FK) build_factorial();
 	double Xc = (W - 1.) / 2., Yc = (H - 1.) / 2.; // coordinate of circle's middle
-	int i, j, k, m_abs = iabs(m), iup = (n-m_abs)/2, isum = (n+m_abs)/2, w = (W+1)/2;
+	int i, j, m_abs = iabs(m), w = (W+1)/2, S = w * ((H+1)/2);
 	double *R, **Rpow;
 	build_rpow(W, H, n, &R, &Rpow);
 	int SS = W * H;
+	// normalized R_j & dR_j/dr on quater I
+	double *Rad = MALLOC(double, S), *dRad = MALLOC(double, S);
+	radial_arr(n, m, S, R, Rpow, Rad, dRad);
 	// now fill output matrix
 	gZ = MALLOC(point, SS);
 	double ZSum = 0.;
@@ -337,12 +691,12 @@ point *gradZ(int n, int m, int W, int H, double *norm){
 			int Ridx = Ry + (int)Rxd; // coordinate on R matrix
 			double Rcurr = R[Ridx];
 			if(Rcurr > 1. || fabs(Rcurr) < DBL_EPSILON) continue; // throw out points with R>1
-			double theta = atan2(j - Yc, i - Xc);
+			double sint, cost, costm, sintm;
+			sincos_m(i - Xc, j - Yc, m_abs, &sint, &cost, &sintm, &costm);
 			// components of grad Zj:
 
 			// 1. Theta_j
-			double Tj = 1., costm, sintm;
-			sincos(theta*(double)m_abs, &sintm, &costm);
+			double Tj = 1.;
 			if(m){
 				if(m > 0)
 					Tj = costm;
@@ -358,25 +712,8 @@ point *gradZ(int n, int m, int W, int H, double *norm){
 				else
 					dTj = -m_abs * sintm;
 			}
-			// 3. R_j & dR_j/dr
-			double Rj = 0., dRj = 0.;
-			for(k = 0; k <= iup; k++){
-				double rj = (1. - 2. * (k % 2)) * FK[n - k]        //       (-1)^k * (n-k)!
-					/(//----------------------------------- -----   -------------------------------
-						FK[k]*FK[isum-k]*FK[iup-k] // k!((n+|m|)/2-k)!((n-|m|)/2-k)!
-					);
-//DBG("rj = %g (n=%d, k=%d)\n",rj, n, k);
-				int kidx = n - 2*k;
-				Rj += rj * Rpow[kidx][Ridx];  // *R^{n-2k}
-				if(kidx > 0)
-					dRj += rj * kidx * Rpow[kidx - 1][Ridx];
-			}
-			// normalisation for Zernike
-			double eps_m = (m) ? 1. : 2., sq =  sqrt(2.*(double)(n+1) / M_PI / eps_m);
-			Rj *= sq, dRj *= sq;
-			// 4. sin/cos
-			double sint, cost;
-			sincos(theta, &sint, &cost);
+			// 3. R_j & dR_j/dr (normalized)
+			double Rj = Rad[Ridx], dRj = dRad[Ridx];
 
 			// projections of gradZj
 			double TdR = Tj * dRj, RdT = Rj * dTj / Rcurr;
@@ -388,6 +725,7 @@ point *gradZ(int n, int m, int W, int H, double *norm){
 	}
 	if(norm) *norm = ZSum;
 	// free unneeded memory
+	FREE(Rad); FREE(dRad);
 	FREE(R);
 	free_rpow(&Rpow, n);
 	return gZ;
@@ -41,12 +41,45 @@ typedef struct{
 	double r,theta;
 } polar;
 
-// 2D array
+// 2D array: all 1D arrays are stored in one aligned block with stride tda
 typedef struct{
-	double **data;
-	size_t len; // size of 1D arrays
-	size_t num; // number of 1D arrays
+	double **data; // data[i] - i'th 1D array (NULL for "columns" array)
+	size_t len;    // size of 1D arrays
+	size_t num;    // number of 1D arrays
+	double *block; // contiguous storage
+	size_t tda;    // stride (in doubles) between rows of block
+	bool cols;     // 1D arrays are columns of block (len rows of num elements)
 }_2D;
+// j'th element of i'th 1D array
+#define _2D_AT(a, i, j)  ((a)->cols ? (a)->block[(j)*(a)->tda + (i)] : (a)->block[(i)*(a)->tda + (j)])
+
+// pre-computed Zernike basis on rectangular WxH matrix
+typedef struct{
+	int W, H;     // size of matrix
+	int Nmax;     // max order of polynomials
+	int pmax;     // amount of polynomials (in Noll notation)
+	double **Z;   // Z[p] - values of p'th polynomial
+	double *norm; // norm[p] - sum(Z[p]^2)
+} Zplan;
+
+// pre-factorized least squares fitting on fixed points set (see ZRplan_new)
+typedef struct ZRplan ZRplan;
+typedef enum{
+	ZR_LS,        // results like LS_decompose
+	ZR_QR         // results like QR_decompose
+} ZRmethod;
+
+// pre-computed Zhao's vector polynomials on fixed points set (see gradZRplan_new)
+typedef struct gradZRplan gradZRplan;
+
+// statistics of annular bases cache
+typedef struct{
+	size_t hits;      // bases got from cache
+	size_t misses;    // bases calculated
+	size_t evictions; // bases removed from cache
+	size_t entries;   // amount of cached bases
+	size_t bytes;     // memory used by them
+} ann_cache_stat;
 
 #ifndef DBL_EPSILON
 #define DBL_EPSILON        2.2204460492503131e-16
@@ -56,11 +89,24 @@ typedef struct{
 #define MALLOC(type, size) ((type*)my_alloc(size, sizeof(type)))
 #define FREE(ptr)  do{free(ptr); ptr = NULL;}while(0)
 void *my_alloc(size_t N, size_t S);
+_2D *_2ALLOC(int len, int num);
+_2D *_2ALLOC_COLS(int len, int num);
+void _2FREE(_2D **a);
 
 /*************** Base functions ***************/
 void convert_Zidx(int p, int *N, int *M);
 void set_prec(double val);
 double get_prec();
+void set_threads(int N);
+
+/*************** SIMD kernels ***************/
+typedef enum{
+	ZK_SCALAR,
+	ZK_SSE2,
+	ZK_AVX2
+} zk_level;
+zk_level zk_set_level(zk_level level);
+const char *zk_level_name();
 
 /*************** Zernike on rectangular equidistant coordinate matrix ***************/
 double *zernfun(int n, int m, int W, int H, double *norm);
@@ -69,6 +115,11 @@ double *zernfunN(int p, int W, int H, double *norm);
 double *Zdecompose(int Nmax, int W, int H, double *image, int *Zsz, int *lastIdx);
 double *Zcompose(int Zsz, double *Zidxs, int W, int H);
 
+Zplan *Zplan_new(int Nmax, int W, int H);
+void Zplan_free(Zplan **plan);
+double *Zdecompose_plan(Zplan *plan, double *image, int *Zsz, int *lastIdx);
+double *Zcompose_plan(Zplan *plan, int Zsz, double *Zidxs);
+
 double *gradZdecompose(int Nmax, int W, int H, point *image, int *Zsz, int *lastIdx);
 point *gradZcompose(int Zsz, double *Zidxs, int W, int H);
 double *convGradIdxs(double *gradIdxs, int Zsz);
@@ -78,15 +129,27 @@ double *zernfunR(int n, int m, int Sz, polar *P, double *norm);
 double *zernfunNR(int p, int Sz, polar *P, double *norm);
 double *ZdecomposeR(int Nmax, int Sz, polar *P, double *heights, int *Zsz, int *lastIdx);
 double *ZcomposeR(int Zsz, double *Zidxs, int Sz, polar *P);
+_2D *ZbasisR(int Nmax, int Sz, polar *P, double **Norm);
 double *LS_decompose(int Nmax, int Sz, polar *P, double *heights, int *Zsz, int *lastIdx);
 double *QR_decompose(int Nmax, int Sz, polar *P, double *heights, int *Zsz, int *lastIdx);
+ZRplan *ZRplan_new(int Nmax, int Sz, polar *P, ZRmethod method);
+void ZRplan_free(ZRplan **plan);
+double *ZRdecompose_plan(ZRplan *plan, int Nframes, double *heights, int *Zsz, int *lastIdx);
 double *gradZdecomposeR(int Nmax, int Sz, polar *P,  point *grads, int *Zsz, int *lastIdx);
 double *LS_gradZdecomposeR(int Nmax, int Sz, polar *P,  point *grads, int *Zsz, int *lastIdx);
 point *gradZcomposeR(int Zsz, double *Zidxs, int Sz, polar *P);
+_2D *gradZbasisR(int Nmax, int Sz, polar *P, double **Norm);
+gradZRplan *gradZRplan_new(int Nmax, int Sz, polar *P);
+void gradZRplan_free(gradZRplan **plan);
+double *gradZRdecompose_plan(gradZRplan *plan, point *grads, int *Zsz, int *lastIdx);
+point *gradZRcompose_plan(gradZRplan *plan, int Zsz, double *Zidxs);
 
 /*************** Annular Zernike ***************/
 _2D *ann_Z(int pmax, int Sz, polar *P, double **Norm);
 double *ann_Zcompose(int Zsz, double *Zidxs, int Sz, polar *P);
 double *ann_Zdecompose(int Nmax, int Sz, polar *P, double *heights, int *Zsz, int *lastIdx);
+void ann_cache_setsize(int N);
+void ann_cache_clear();
+void ann_cache_stats(ann_cache_stat *st);
 
 #endif // __ZERNIKE_H__
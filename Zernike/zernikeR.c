@@ -19,6 +19,7 @@
  * MA 02110-1301, USA.
  */
 
+#include <pthread.h>
 #include <gsl/gsl_linalg.h>
 #include <gsl/gsl_matrix.h>
 #include <gsl/gsl_blas.h>
@@ -48,7 +49,14 @@ double **build_rpowR(int n, int Sz, polar *P){
 	return Rpow;
 }
 
-bool check_parameters(n, m, Sz, P){
+/**
+ * Check parameters of Zernike polynomial on points set (exit with error if they're wrong)
+ * @param n,m   - orders of polynomial
+ * @param Sz    - number of points
+ * @param P (i) - array with points coordinates
+ * @return false if all OK
+ */
+static bool check_parameters(int n, int m, int Sz, polar *P){
 	bool erparm = false;
 	if(Sz < 3 || !P)
 		errx(1, "Size of matrix must be > 2!");
@@ -74,27 +82,20 @@ bool check_parameters(n, m, Sz, P){
  */
 double *zernfunR(int n, int m, int Sz, polar *P, double *norm){
 	if(check_parameters(n, m, Sz, P)) return NULL;
-	int j, k, m_abs = iabs(m), iup = (n-m_abs)/2;
+	int j, m_abs = iabs(m);
 	double **Rpow = build_rpowR(n, Sz, P);
 	double ZSum = 0.;
+	// normalized R_n^m
+	double *R = MALLOC(double, Sz), *Rad = MALLOC(double, Sz);
+	for(j = 0; j < Sz; j++) R[j] = P[j].r;
+	radial_arr(n, m, Sz, R, Rpow, Rad, NULL);
 	// now fill output matrix
 	double *Zarr = MALLOC(double, Sz); // output matrix
 	double *Zptr = Zarr;
 	polar *p = P;
 	for(j = 0; j < Sz; j++, p++, Zptr++){
-		double Z = 0.;
 		if(p->r > 1.) continue; // throw out points with R>1
-		// calculate R_n^m
-		for(k = 0; k <= iup; k++){ // Sum
-			double z = (1. - 2. * (k % 2)) * FK[n - k]        //       (-1)^k * (n-k)!
-				/(//----------------------------------- -----   -------------------------------
-					FK[k]*FK[(n+m_abs)/2-k]*FK[(n-m_abs)/2-k] // k!((n+|m|)/2-k)!((n-|m|)/2-k)!
-				);
-			Z += z * Rpow[n-2*k][j];  // *R^{n-2k}
-		}
-		// normalize
-		double eps_m = (m) ? 1. : 2.;
-		Z *= sqrt(2.*(n+1.) / M_PI / eps_m  );
+		double Z = Rad[j];
 		double m_theta = (double)m_abs * p->theta;
 		// multiply to angular function:
 		if(m){
@@ -108,6 +109,8 @@ double *zernfunR(int n, int m, int Sz, polar *P, double *norm){
 	}
 	if(norm) *norm = ZSum;
 	// free unneeded memory
+	FREE(R);
+	FREE(Rad);
 	free_rpow(&Rpow, n);
 	return Zarr;
 }
@@ -124,6 +127,132 @@ double *zernfunNR(int p, int Sz, polar *P, double *norm){
 	return zernfunR(n,m,Sz,P,norm);
 }
 
+/**
+ * Build all Zernike polynomials with orders <= Nmax on points set at once
+ * (radial parts are calculated by recurrence in one pass over points,
+ * angular - by Chebyshev recurrence for cos(m*theta) & sin(m*theta))
+ * @param Nmax     - maximum order of polynomials
+ * @param Sz, P(i) - size (Sz) of points array (P)
+ * @param Norm (o) - (if !NULL) array with norms of polynomials, sum(Z^2)
+ * @param cols     - polynomials are columns of result (design matrix for GSL)
+ * @return 2D array: its p'th 1D array is polynomial in Noll notation (zero for r > 1)
+ */
+static _2D *Zbasis(int Nmax, int Sz, polar *P, double **Norm, bool cols){
+	if(Sz < 1 || !P)
+		errx(1, "Size of matrix must be > 0!");
+	if(Nmax < 0 || Nmax > 100)
+		errx(1, "Order of Zernike polynomial must be in [0, 100]!");
+	int i, j, m, p, pmax = (Nmax + 1) * (Nmax + 2) / 2; // max Z number in Noll notation
+	double *R = MALLOC(double, Sz);
+	for(j = 0; j < Sz; j++) R[j] = P[j].r;
+	double **Rad = radial_table(Nmax, Sz, R);
+	FREE(R);
+	// cos(m*theta) & sin(m*theta): X_m = 2cos(theta)X_{m-1} - X_{m-2}
+	_2D *Cm = _2ALLOC(Sz, Nmax + 1), *Sm = _2ALLOC(Sz, Nmax + 1);
+	for(j = 0; j < Sz; j++){
+		Cm->data[0][j] = 1.;
+		if(Nmax) sincos(P[j].theta, &Sm->data[1][j], &Cm->data[1][j]);
+	}
+	for(m = 2; m <= Nmax; m++){
+		double *c = Cm->data[m], *c1 = Cm->data[m-1], *c2 = Cm->data[m-2];
+		double *s = Sm->data[m], *s1 = Sm->data[m-1], *s2 = Sm->data[m-2];
+		double *ct = Cm->data[1];
+		for(j = 0; j < Sz; j++){
+			c[j] = 2.*ct[j]*c1[j] - c2[j];
+			s[j] = 2.*ct[j]*s1[j] - s2[j];
+		}
+	}
+	// radial & angular parts of each polynomial
+	double *rad[pmax], *ang[pmax];
+	for(p = 0; p < pmax; p++){
+		int n, mm;
+		convert_Zidx(p, &n, &mm);
+		rad[p] = Rad[RADIDX(n, iabs(mm))];
+		ang[p] = (mm > 0) ? Cm->data[mm] : ((mm < 0) ? Sm->data[-mm] : NULL);
+	}
+	_2D *Z = cols ? _2ALLOC_COLS(Sz, pmax) : _2ALLOC(Sz, pmax);
+	double *N = MALLOC(double, pmax);
+	if(cols){ // fill matrix by rows (points)
+		#pragma omp parallel for if(pmax*Sz > OMP_MINSZ)
+		for(i = 0; i < Sz; i++){
+			if(P[i].r > 1.) continue; // throw out points with R>1
+			double *row = &Z->block[i * Z->tda];
+			int pp;
+			for(pp = 0; pp < pmax; pp++)
+				row[pp] = ang[pp] ? rad[pp][i] * ang[pp][i] : rad[pp][i];
+		}
+		for(i = 0; i < Sz; i++){
+			double *row = &Z->block[i * Z->tda];
+			for(p = 0; p < pmax; p++) N[p] += row[p] * row[p];
+		}
+	}else{
+		#pragma omp parallel for schedule(dynamic) if(pmax*Sz > OMP_MINSZ)
+		for(p = 0; p < pmax; p++){
+			double *r = rad[p], *a = ang[p], *Zptr = Z->data[p], sum = 0.;
+			int ii;
+			for(ii = 0; ii < Sz; ii++){
+				if(P[ii].r > 1.) continue; // throw out points with R>1
+				double z = a ? r[ii] * a[ii] : r[ii];
+				Zptr[ii] = z;
+				sum += z*z;
+			}
+			N[p] = sum;
+		}
+	}
+	_2FREE(&Cm);
+	_2FREE(&Sm);
+	free_rpow(&Rad, RADSZ(Nmax) - 1);
+	if(Norm) *Norm = N;
+	else FREE(N);
+	return Z;
+}
+
+/**
+ * Build all Zernike polynomials with orders <= Nmax on points set at once
+ * @param Nmax     - maximum order of polynomials
+ * @param Sz, P(i) - size (Sz) of points array (P)
+ * @param Norm (o) - (if !NULL) array with norms of polynomials, sum(Z^2)
+ * @return 2D array: its p'th 1D array is polynomial in Noll notation (zero for r > 1)
+ */
+_2D *ZbasisR(int Nmax, int Sz, polar *P, double **Norm){
+	return Zbasis(Nmax, Sz, P, Norm, false);
+}
+
+/**
+ * Build design matrix for least squares fitting: its Nth row is equation
+ * for Nth data point, Mth column is Z_M
+ * @param Nmax     - maximum order of polynomials
+ * @param Sz, P(i) - size (Sz) of points array (P)
+ * @param normed   - divide polynomials by their norms
+ * @return 2D array with polynomials in columns (use _2D_view to get gsl_matrix)
+ */
+static _2D *design_matrix(int Nmax, int Sz, polar *P, bool normed){
+	double *norm;
+	_2D *B = Zbasis(Nmax, Sz, P, &norm, true);
+	if(normed){
+		int x, y, pmax = B->num;
+		for(x = 0; x < pmax; x++) norm[x] = 1. / norm[x];
+		for(y = 0; y < Sz; y++){
+			double *row = &B->block[y * B->tda];
+			for(x = 0; x < pmax; x++) row[x] *= norm[x];
+		}
+	}
+	FREE(norm);
+	return B;
+}
+
+/**
+ * Get GSL view of 2D array (without copying): num x len matrix for common
+ * arrays or len x num matrix for arrays allocated by _2ALLOC_COLS
+ * @param a (i) - array
+ * @return matrix view
+ */
+static gsl_matrix_view _2D_view(_2D *a){
+	if(a->cols)
+		return gsl_matrix_view_array_with_tda(a->block, a->len, a->num, a->tda);
+	return gsl_matrix_view_array_with_tda(a->block, a->num, a->len, a->tda);
+}
+
 /**
  * Zernike decomposition of image 'image' WxH pixels
  * @param Nmax (i)   - maximum power of Zernike polinomial for decomposition
@@ -135,31 +264,24 @@ double *zernfunNR(int p, int Sz, polar *P, double *norm){
  */
 double *ZdecomposeR(int Nmax, int Sz, polar *P, double *heights, int *Zsz, int *lastIdx){
 	int i, pmax, maxIdx = 0;
-	double *Zidxs = NULL, *icopy = NULL;
+	double *Zidxs = NULL, *icopy = NULL, *norm;
 	pmax = (Nmax + 1) * (Nmax + 2) / 2; // max Z number in Noll notation
+	_2D *B = ZbasisR(Nmax, Sz, P, &norm);
 	Zidxs = MALLOC(double, pmax);
 	icopy = MALLOC(double, Sz);
 	memcpy(icopy, heights, Sz*sizeof(double)); // make image copy to leave it unchanged
 	*Zsz = pmax;
 	for(i = 0; i < pmax; i++){ // now we fill array
-		double norm, *Zcoeff = zernfunNR(i, Sz, P, &norm);
-		int j;
-		double *iptr = icopy, *zptr = Zcoeff, K = 0.;
-		for(j = 0; j < Sz; j++, iptr++, zptr++)
-			K += (*zptr) * (*iptr) / norm; // multiply matrixes to get coefficient
+		double K = proj_subtract(Sz, icopy, B->data[i], norm[i]);
 		if(fabs(K) < Z_prec)
 			continue; // there's no need to substract values that are less than our precision
 		Zidxs[i] = K;
 		maxIdx = i;
-
-		iptr = icopy; zptr = Zcoeff;
-		for(j = 0; j < Sz; j++, iptr++, zptr++)
-			*iptr -= K * (*zptr); // subtract composed coefficient to reduce high orders values
-
-		FREE(Zcoeff);
 	}
 	if(lastIdx) *lastIdx = maxIdx;
 	FREE(icopy);
+	FREE(norm);
+	_2FREE(&B);
 	return Zidxs;
 }
 
@@ -171,18 +293,17 @@ double *ZdecomposeR(int Nmax, int Sz, polar *P, double *heights, int *Zsz, int *
  * @return restored image
  */
 double *ZcomposeR(int Zsz, double *Zidxs, int Sz, polar *P){
-	int i;
+	int i, Nmax, m;
 	double *image = MALLOC(double, Sz);
+	if(Zsz < 1) return image;
+	convert_Zidx(Zsz - 1, &Nmax, &m);
+	_2D *B = ZbasisR(Nmax, Sz, P, NULL);
 	for(i = 0; i < Zsz; i++){ // now we fill array
 		double K = Zidxs[i];
 		if(fabs(K) < Z_prec) continue;
-		double *Zcoeff = zernfunNR(i, Sz, P, NULL);
-		int j;
-		double *iptr = image, *zptr = Zcoeff;
-		for(j = 0; j < Sz; j++, iptr++, zptr++)
-			*iptr += K * (*zptr); // add next Zernike polynomial
-		FREE(Zcoeff);
+		add_poly(Sz, image, B->data[i], K); // add next Zernike polynomial
 	}
+	_2FREE(&B);
 	return image;
 }
 
@@ -241,17 +362,11 @@ double *LS_decompose(int Nmax, int Sz, polar *P, double *heights, int *Zsz, int
 */
 	// Now allocate matrix: its Nth row is equation for Nth data point,
 	// Mth column is Z_M
-	gsl_matrix *M = gsl_matrix_calloc(Sz, pmax);
-	// fill matrix with coefficients
-	int x,y;
-	size_t T = M->tda;
-	for(x = 0; x < pmax; x++){
-		double norm, *Zcoeff = zernfunNR(x, Sz, P, &norm), *Zptr = Zcoeff;
-		double *ptr = &(M->data[x]);
-		for(y = 0; y < Sz; y++, ptr+=T, Zptr++) // fill xth polynomial
-			*ptr = (*Zptr);
-		FREE(Zcoeff);
-	}
+	int x;
+	_2D *B = design_matrix(Nmax, Sz, P, false);
+	gsl_matrix_view Mv = _2D_view(B);
+	gsl_matrix *M = &Mv.matrix;
+	if(Zsz) *Zsz = pmax;
 
 	gsl_vector *ans = gsl_vector_calloc(pmax);
 
@@ -270,7 +385,7 @@ double *LS_decompose(int Nmax, int Sz, polar *P, double *heights, int *Zsz, int
 		maxIdx = x;
 	}
 
-	gsl_matrix_free(M);
+	_2FREE(&B);
 	gsl_vector_free(ans);
 	gsl_vector_free(tau);
 	gsl_vector_free(residual);
@@ -321,31 +436,26 @@ double *QR_decompose(int Nmax, int Sz, polar *P, double *heights, int *Zsz, int
 	int k, x,y;
 
 	//make new polar
-	polar *Pn = conv_r(P, Sz);
+	polar *Pn = conv_r(P, Sz, NULL);
 	// Now allocate matrix: its Nth row is equation for Nth data point,
 	// Mth column is Z_M
-	gsl_matrix *M = gsl_matrix_calloc(Sz, pmax);
+	_2D *B = design_matrix(Nmax, Sz, Pn, true);
+	gsl_matrix_view Mv = _2D_view(B);
+	gsl_matrix *M = &Mv.matrix;
 	// Q-matrix (its first pmax columns is our basis)
 	gsl_matrix *Q = gsl_matrix_calloc(Sz, Sz);
 	// R-matrix (coefficients)
 	gsl_matrix *R = gsl_matrix_calloc(Sz, pmax);
-	// fill matrix with coefficients
-	size_t T = M->tda;
-	for(x = 0; x < pmax; x++){
-		double norm, *Zcoeff = zernfunNR(x, Sz, Pn, &norm), *Zptr = Zcoeff;
-		double *ptr = &(M->data[x]);
-		for(y = 0; y < Sz; y++, ptr+=T, Zptr++) // fill xth polynomial
-			*ptr = (*Zptr) / norm;
-		FREE(Zcoeff);
-	}
+	if(Zsz) *Zsz = pmax;
 
 	gsl_vector *tau = gsl_vector_calloc(pmax); // min(size(M))
 	gsl_linalg_QR_decomp(M, tau);
 
 	gsl_linalg_QR_unpack(M, tau, Q, R);
 //print_matrix(R);
-	gsl_matrix_free(M);
+	_2FREE(&B);
 	gsl_vector_free(tau);
+	size_t T;
 
 	double *Zidxs = MALLOC(double, pmax);
 	T = Q->tda;
@@ -382,6 +492,108 @@ double *QR_decompose(int Nmax, int Sz, polar *P, double *heights, int *Zsz, int
 }
 
 
+/*
+ * Batch fitting of many height sets on the same points set.
+ * Both LS_decompose and QR_decompose are linear by heights: coefficients are
+ * T*heights, where (after QR-decomposition of design matrix M = QR with Qp as
+ * first pmax columns of Q and Rp as upper pmax x pmax part of R)
+ *    T = Rp^{-1} Qp^T for LS_decompose  (least-squares solution)
+ *    T = Rp Qp^T      for QR_decompose  (its Zidxs_corr)
+ * So the plan makes factorization once and keeps only matrix T (pmax x Sz);
+ * coefficients for any amount of frames are calculated by matrix product.
+ */
+struct ZRplan{
+	int Sz;        // number of points
+	int pmax;      // amount of polynomials (in Noll notation)
+	gsl_matrix *T; // matrix to get coefficients from heights
+};
+
+/**
+ * Build plan for batch decomposition on points set P
+ * @param Nmax     - maximum power of Zernike polinomial for decomposition
+ * @param Sz, P(i) - size (Sz) of points array (P)
+ * @param method   - ZR_LS for LS_decompose or ZR_QR for QR_decompose results
+ * @return dynamically allocated plan (free it by ZRplan_free)
+ */
+ZRplan *ZRplan_new(int Nmax, int Sz, polar *P, ZRmethod method){
+	int pmax = (Nmax + 1) * (Nmax + 2) / 2; // max Z number in Noll notation
+	if(Sz < pmax) errx(1, "Number of points must be >= number of polynomials!");
+	int x;
+	polar *Pn = (method == ZR_QR) ? conv_r(P, Sz, NULL) : P;
+	// Nth row is equation for Nth data point, Mth column is Z_M
+	_2D *B = design_matrix(Nmax, Sz, Pn, method == ZR_QR);
+	gsl_matrix_view Mv = _2D_view(B);
+	gsl_matrix *M = &Mv.matrix;
+	if(Pn != P) FREE(Pn);
+	gsl_vector *tau = gsl_vector_calloc(pmax);
+	gsl_linalg_QR_decomp(M, tau);
+	ZRplan *plan = MALLOC(ZRplan, 1);
+	plan->Sz = Sz;
+	plan->pmax = pmax;
+	// Qp^T: k'th row is Q*e_k
+	plan->T = gsl_matrix_calloc(pmax, Sz);
+	#pragma omp parallel for if(pmax*Sz > OMP_MINSZ)
+	for(x = 0; x < pmax; x++){
+		gsl_vector_view v = gsl_matrix_row(plan->T, x);
+		v.vector.data[x] = 1.;
+		gsl_linalg_QR_Qvec(M, tau, &v.vector);
+	}
+	gsl_matrix_view Rp = gsl_matrix_submatrix(M, 0, 0, pmax, pmax); // upper triangle is R
+	if(method == ZR_QR)
+		gsl_blas_dtrmm(CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit, 1., &Rp.matrix, plan->T);
+	else
+		gsl_blas_dtrsm(CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit, 1., &Rp.matrix, plan->T);
+	_2FREE(&B);
+	gsl_vector_free(tau);
+	return plan;
+}
+
+/**
+ * Free memory allocated for plan
+ * @param plan (io) - plan to free (will be set to NULL)
+ */
+void ZRplan_free(ZRplan **plan){
+	if(!plan || !*plan) return;
+	gsl_matrix_free((*plan)->T);
+	FREE(*plan);
+}
+
+/**
+ * Decomposition of many height sets by pre-factorized plan
+ * (frames are processed by blocks in parallel)
+ * @param plan (i)     - plan built by ZRplan_new
+ * @param Nframes      - amount of height sets
+ * @param heights (i)  - heights: Nframes arrays of plan's Sz values one after another
+ * @param Zsz  (o)     - size of Z coefficients array for one frame
+ * @param lastIdx (o)  - (if !NULL) array (Nframes values) with last non-zero coefficient of each frame
+ * @return array of Zernike coefficients: Nframes arrays of Zsz values one after another
+ */
+double *ZRdecompose_plan(ZRplan *plan, int Nframes, double *heights, int *Zsz, int *lastIdx){
+	int f, Sz = plan->Sz, pmax = plan->pmax;
+	double *Zidxs = MALLOC(double, Nframes * pmax);
+	if(Zsz) *Zsz = pmax;
+	#pragma omp parallel if(Nframes > 1 && (double)Nframes*Sz*pmax > OMP_MINSZ)
+	{
+		int from, len = omp_chunk(Nframes, &from);
+		if(len > 0){
+			gsl_matrix_const_view h = gsl_matrix_const_view_array(&heights[from*Sz], len, Sz);
+			gsl_matrix_view z = gsl_matrix_view_array(&Zidxs[from*pmax], len, pmax);
+			// Z^T = T * H^T
+			gsl_blas_dgemm(CblasNoTrans, CblasTrans, 1., &h.matrix, plan->T, 0., &z.matrix);
+		}
+	}
+	for(f = 0; f < Nframes; f++){
+		int x, maxIdx = 0;
+		double *ptr = &Zidxs[f*pmax];
+		for(x = 0; x < pmax; x++, ptr++){
+			if(fabs(*ptr) < Z_prec) *ptr = 0.;
+			else maxIdx = x;
+		}
+		if(lastIdx) lastIdx[f] = maxIdx;
+	}
+	return Zidxs;
+}
+
 /**
  * Components of Zj gradient without constant factor
  * @param n,m      - orders of polynomial
@@ -393,8 +605,12 @@ double *QR_decompose(int Nmax, int Sz, polar *P, double *heights, int *Zsz, int
 point *gradZR(int n, int m, int Sz, polar *P, double *norm){
 	if(check_parameters(n, m, Sz, P)) return NULL;
 	point *gZ = NULL;
-	int j, k, m_abs = iabs(m), iup = (n-m_abs)/2, isum = (n+m_abs)/2;
+	int j, m_abs = iabs(m);
 	double **Rpow = build_rpowR(n, Sz, P);
+	// normalized R_j & dR_j/dr
+	double *R = MALLOC(double, Sz), *Rad = MALLOC(double, Sz), *dRad = MALLOC(double, Sz);
+	for(j = 0; j < Sz; j++) R[j] = P[j].r;
+	radial_arr(n, m, Sz, R, Rpow, Rad, dRad);
 	// now fill output matrix
 	gZ = MALLOC(point, Sz);
 	point *Zptr = gZ;
@@ -420,21 +636,7 @@ point *gradZR(int n, int m, int Sz, polar *P, double *norm){
 		}
 
 		// 3. R_j & dR_j/dr
-		double Rj = 0., dRj = 0.;
-		for(k = 0; k <= iup; k++){
-			double rj = (1. - 2. * (k % 2)) * FK[n - k]        //       (-1)^k * (n-k)!
-				/(//----------------------------------- -----   -------------------------------
-					FK[k]*FK[isum-k]*FK[iup-k]                 // k!((n+|m|)/2-k)!((n-|m|)/2-k)!
-				);
-//DBG("rj = %g (n=%d, k=%d)\n",rj, n, k);
-			int kidx = n - 2*k;
-			Rj += rj * Rpow[kidx][j];  // *R^{n-2k}
-			if(kidx > 0)
-				dRj += rj * kidx * Rpow[kidx - 1][j]; // *(n-2k)*R^{n-2k-1}
-		}
-		// normalisation for Zernike
-		double eps_m = (m) ? 1. : 2., sq =  sqrt(2.*(double)(n+1) / M_PI / eps_m);
-		Rj *= sq, dRj *= sq;
+		double Rj = Rad[j], dRj = dRad[j];
 		// 4. sin/cos
 		double sint, cost;
 		sincos(theta, &sint, &cost);
@@ -448,6 +650,9 @@ point *gradZR(int n, int m, int Sz, polar *P, double *norm){
 	}
 	if(norm) *norm = ZSum;
 	// free unneeded memory
+	FREE(R);
+	FREE(Rad);
+	FREE(dRad);
 	free_rpow(&Rpow, n);
 	return gZ;
 }
@@ -551,8 +756,244 @@ double *LS_gradZdecomposeR(int Nmax, int Sz, polar *P,  point *grads, int *Zsz,
 	return Zidxs;
 }
 
+/**
+ * Build all Zhao's vector polynomials S_p (see zerngradR) with orders <= Nmax
+ * on points set in one pass: R_n^m & dR_n^m/dr for all orders are calculated by
+ * recurrence for each point, cos/sin(m*theta) - by multiplication by e^{i*theta}
+ * (points with r > 1 and r == 0 are thrown out)
+ * @param Nmax     - maximum order of polynomials
+ * @param Sz, P(i) - size (Sz) of points array (P)
+ * @param Norm (o) - (if !NULL) array with norms of polynomials, sum(S_x^2 + S_y^2)
+ * @return 2D array with 1D arrays of length 2*Sz: p'th array contains x components
+ *         of S_p for all points and after them y components (S_0 == 0)
+ */
+_2D *gradZbasisR(int Nmax, int Sz, polar *P, double **Norm){
+	if(Sz < 1 || !P)
+		errx(1, "Size of matrix must be > 0!");
+	if(Nmax < 1 || Nmax > 100)
+		errx(1, "Order of gradient Z must be in [1, 100]!");
+	int p, pmax = (Nmax + 1) * (Nmax + 2) / 2, NR = RADSZ(Nmax);
+	int pidx[pmax], pidx2[pmax], pm[pmax];
+	double Kp[pmax], sq[NR];
+	for(p = 0; p < pmax; p++){
+		int n, m;
+		convert_Zidx(p, &n, &m);
+		pm[p] = m;
+		pidx[p] = RADIDX(n, iabs(m));
+		sq[pidx[p]] = radial_norm(n, m);
+		// S_p = grad Z_n^m - K * grad Z_{n-2}^m
+		pidx2[p] = -1; Kp[p] = 0.;
+		if(n != iabs(m) && n > 2){
+			pidx2[p] = RADIDX(n-2, iabs(m));
+			Kp[p] = sqrt(((double)n+1.)/(n-1.));
+		}
+	}
+	_2D *S = _2ALLOC(2*Sz, pmax);
+	#pragma omp parallel if(Sz > OMP_MINSZ / 16)
+	{
+		int j, k;
+		double *Rnm = MALLOC(double, NR), *dRnm = MALLOC(double, NR);
+		double cm[Nmax+1], sm[Nmax+1];
+		#pragma omp for
+		for(j = 0; j < Sz; j++){
+			double r = P[j].r;
+			if(r > 1. || r < DBL_EPSILON) continue; // throw out points with R>1 & center
+			radial_recur(Nmax, r, Rnm, dRnm);
+			for(k = 0; k < NR; k++){
+				Rnm[k] *= sq[k];
+				dRnm[k] *= sq[k];
+			}
+			double sint, cost;
+			sincos(P[j].theta, &sint, &cost);
+			cm[0] = 1.; sm[0] = 0.;
+			for(k = 1; k <= Nmax; k++){
+				cm[k] = cm[k-1]*cost - sm[k-1]*sint;
+				sm[k] = sm[k-1]*cost + cm[k-1]*sint;
+			}
+			int pp;
+			for(pp = 1; pp < pmax; pp++){
+				int m = pm[pp], ma = iabs(m);
+				// Theta_j & dTheta_j/Dtheta
+				double Tj = 1., dTj = 0.;
+				if(m > 0){
+					Tj = cm[ma];
+					dTj = -ma * sm[ma];
+				}else if(m < 0){
+					Tj = sm[ma];
+					dTj = ma * cm[ma];
+				}
+				double Rj = Rnm[pidx[pp]], dRj = dRnm[pidx[pp]];
+				if(pidx2[pp] > -1){
+					Rj -= Kp[pp] * Rnm[pidx2[pp]];
+					dRj -= Kp[pp] * dRnm[pidx2[pp]];
+				}
+				// projections of gradient
+				double TdR = Tj * dRj, RdT = Rj * dTj / r;
+				S->data[pp][j] = TdR * cost - RdT * sint;
+				S->data[pp][j+Sz] = TdR * sint + RdT * cost;
+			}
+		}
+		FREE(Rnm);
+		FREE(dRnm);
+	}
+	if(Norm){
+		double *N = MALLOC(double, pmax);
+		#pragma omp parallel for if(pmax*Sz > OMP_MINSZ)
+		for(p = 1; p < pmax; p++)
+			N[p] = zk_dot(S->data[p], S->data[p], 2*Sz);
+		*Norm = N;
+	}
+	return S;
+}
+
+// pre-computed Zhao's polynomials on fixed points set
+struct gradZRplan{
+	int Nmax;     // max order of polynomials
+	int pmax;     // amount of polynomials
+	int Sz;       // amount of points
+	polar *P;     // copy of points (for cache)
+	uint64_t hash;// hash of points
+	_2D *S;       // basis (see gradZbasisR)
+	double *norm; // its norms
+	int refcount; // amount of users
+};
+
+/**
+ * Pre-compute Zhao's polynomials with orders <= Nmax on points set P: plan can be
+ * reused for any amount of gradients sets measured in the same points
+ * @param Nmax     - maximum order of polynomials
+ * @param Sz, P(i) - size (Sz) of points array (P)
+ * @return plan (free it by gradZRplan_free)
+ */
+gradZRplan *gradZRplan_new(int Nmax, int Sz, polar *P){
+	gradZRplan *plan = MALLOC(gradZRplan, 1);
+	plan->S = gradZbasisR(Nmax, Sz, P, &plan->norm);
+	plan->Nmax = Nmax;
+	plan->pmax = (Nmax + 1) * (Nmax + 2) / 2;
+	plan->Sz = Sz;
+	plan->refcount = 1;
+	return plan;
+}
+
+static pthread_mutex_t gradZR_mutex = PTHREAD_MUTEX_INITIALIZER;
+static gradZRplan *gradZR_last = NULL; // plan for last points set used by gradZ[de]composeR
+
+/**
+ * Free plan got by gradZRplan_new
+ */
+void gradZRplan_free(gradZRplan **plan){
+	if(!plan || !*plan) return;
+	gradZRplan *p = *plan;
+	*plan = NULL;
+	pthread_mutex_lock(&gradZR_mutex);
+	int refs = --p->refcount;
+	pthread_mutex_unlock(&gradZR_mutex);
+	if(refs > 0) return;
+	_2FREE(&p->S);
+	FREE(p->norm);
+	FREE(p->P);
+	FREE(p);
+}
+
+/**
+ * Get plan for last used points set or build new one (and store it instead of old)
+ * @param Nmax     - maximum order of polynomials
+ * @param Sz, P(i) - size (Sz) of points array (P)
+ * @return plan (release it by gradZRplan_free)
+ */
+static gradZRplan *gradZR_get(int Nmax, int Sz, polar *P){
+	double rmin;
+	if(Nmax < 1) Nmax = 1;
+	uint64_t hash = points_hash(Sz, P, &rmin);
+	pthread_mutex_lock(&gradZR_mutex);
+	gradZRplan *plan = gradZR_last;
+	if(plan && plan->hash == hash && plan->Sz == Sz && plan->Nmax >= Nmax
+			&& !memcmp(plan->P, P, Sz*sizeof(polar))){
+		plan->refcount++;
+		pthread_mutex_unlock(&gradZR_mutex);
+		return plan;
+	}
+	pthread_mutex_unlock(&gradZR_mutex);
+	plan = gradZRplan_new(Nmax, Sz, P);
+	plan->hash = hash;
+	plan->P = MALLOC(polar, Sz);
+	memcpy(plan->P, P, Sz*sizeof(polar));
+	plan->refcount = 2; // cache & caller
+	pthread_mutex_lock(&gradZR_mutex);
+	gradZRplan *old = gradZR_last;
+	gradZR_last = plan;
+	pthread_mutex_unlock(&gradZR_mutex);
+	gradZRplan_free(&old);
+	return plan;
+}
+
+/**
+ * Decomposition of wavefront gradients by first pmax polynomials of plan
+ */
+static double *grad_decompose(gradZRplan *plan, int pmax, point *grads, int *Zsz, int *lastIdx){
+	int i, maxIdx = 0, Sz = plan->Sz;
+	double *Zidxs = MALLOC(double, pmax);
+	// copy of gradients: x components and after them y components
+	double *icopy = MALLOC(double, 2*Sz);
+	for(i = 0; i < Sz; i++){
+		icopy[i] = grads[i].x;
+		icopy[i+Sz] = grads[i].y;
+	}
+	if(Zsz) *Zsz = pmax;
+	for(i = 1; i < pmax; i++){
+		double K = proj_subtract(2*Sz, icopy, plan->S->data[i], plan->norm[i]);
+		if(fabs(K) < Z_prec) continue;
+		Zidxs[i] = K;
+		maxIdx = i;
+	}
+	if(lastIdx) *lastIdx = maxIdx;
+	FREE(icopy);
+	return Zidxs;
+}
+
+/**
+ * Decomposition of wavefront gradients by pre-computed Zhao's polynomials
+ * (like gradZdecomposeR)
+ * @param plan     - plan got by gradZRplan_new
+ * @param grads(i) - wavefront gradients values in plan's points
+ * @param Zsz  (o)   - size of Z coefficients array
+ * @param lastIdx(o) - (if !NULL) last non-zero coefficient
+ * @return array of coefficients
+ */
+double *gradZRdecompose_plan(gradZRplan *plan, point *grads, int *Zsz, int *lastIdx){
+	return grad_decompose(plan, plan->pmax, grads, Zsz, lastIdx);
+}
+
+/**
+ * Restoration of wavefront gradients by pre-computed Zhao's polynomials
+ * (like gradZcomposeR)
+ * @param plan      - plan got by gradZRplan_new
+ * @param Zsz       - size of coefficients array (polynomials with p >= plan's pmax are ignored)
+ * @param Zidxs (i) - coefficients
+ * @return restored gradients
+ */
+point *gradZRcompose_plan(gradZRplan *plan, int Zsz, double *Zidxs){
+	int i, Sz = plan->Sz;
+	if(Zsz > plan->pmax) Zsz = plan->pmax;
+	double *img = MALLOC(double, 2*Sz);
+	for(i = 1; i < Zsz; i++){
+		double K = Zidxs[i];
+		if(fabs(K) < Z_prec) continue;
+		add_poly(2*Sz, img, plan->S->data[i], K);
+	}
+	point *image = MALLOC(point, Sz);
+	for(i = 0; i < Sz; i++){
+		image[i].x = img[i];
+		image[i].y = img[i+Sz];
+	}
+	FREE(img);
+	return image;
+}
+
 /**
  * Decomposition of image with normals to wavefront by Zhao's polynomials
+ * (basis for last used points set is kept, so sequential calls for the same
+ * points don't recalculate it)
  * @param Nmax (i)   - maximum power of Zernike polinomial for decomposition
  * @param Sz, P(i)   - size (Sz) of points array (P)
  * @param grads(i) - wavefront gradients values in points P
@@ -561,34 +1002,10 @@ double *LS_gradZdecomposeR(int Nmax, int Sz, polar *P,  point *grads, int *Zsz,
  * @return array of coefficients
  */
 double *gradZdecomposeR(int Nmax, int Sz, polar *P,  point *grads, int *Zsz, int *lastIdx){
-	int i, pmax, maxIdx = 0;
-	pmax = (Nmax + 1) * (Nmax + 2) / 2; // max Z number in Noll notation
-	double *Zidxs = MALLOC(double, pmax);
-	point *icopy = MALLOC(point, Sz);
-	memcpy(icopy, grads, Sz*sizeof(point)); // make image copy to leave it unchanged
-	*Zsz = pmax;
-	for(i = 1; i < pmax; i++){ // now we fill array
-		double norm;
-		point *dZcoeff = zerngradR(i, Sz, P, &norm);
-		int j;
-		point *iptr = icopy, *zptr = dZcoeff;
-		double K = 0.;
-		for(j = 0; j < Sz; j++, iptr++, zptr++)
-			K += zptr->x*iptr->x + zptr->y*iptr->y; // multiply matrixes to get coefficient
-		K /= norm;
-		if(fabs(K) < Z_prec)
-			continue; // there's no need to substract values that are less than our precision
-		Zidxs[i] = K;
-		maxIdx = i;
-		iptr = icopy; zptr = dZcoeff;
-		for(j = 0; j < Sz; j++, iptr++, zptr++){
-			iptr->x -= K * zptr->x; // subtract composed coefficient to reduce high orders values
-			iptr->y -= K * zptr->y;
-		}
-		FREE(dZcoeff);
-	}
-	if(lastIdx) *lastIdx = maxIdx;
-	FREE(icopy);
+	gradZRplan *plan = gradZR_get(Nmax, Sz, P);
+	// plan can contain more polynomials
+	double *Zidxs = grad_decompose(plan, (Nmax + 1) * (Nmax + 2) / 2, grads, Zsz, lastIdx);
+	gradZRplan_free(&plan);
 	return Zidxs;
 }
 
@@ -598,19 +1015,11 @@ double *gradZdecomposeR(int Nmax, int Sz, polar *P,  point *grads, int *Zsz, int
  * @return restored image
  */
 point *gradZcomposeR(int Zsz, double *Zidxs, int Sz, polar *P){
-	int i;
-	point *image = MALLOC(point, Sz);
-	for(i = 1; i < Zsz; i++){ // now we fill array
-		double K = Zidxs[i];
-		if(fabs(K) < Z_prec) continue;
-		point *Zcoeff = zerngradR(i, Sz, P, NULL);
-		int j;
-		point *iptr = image, *zptr = Zcoeff;
-		for(j = 0; j < Sz; j++, iptr++, zptr++){
-			iptr->x += K * zptr->x;
-			iptr->y += K * zptr->y;
-		}
-		FREE(Zcoeff);
-	}
+	int Nmax, m;
+	if(Zsz < 2) return MALLOC(point, Sz);
+	convert_Zidx(Zsz - 1, &Nmax, &m);
+	gradZRplan *plan = gradZR_get(Nmax, Sz, P);
+	point *image = gradZRcompose_plan(plan, Zsz, Zidxs);
+	gradZRplan_free(&plan);
 	return image;
 }
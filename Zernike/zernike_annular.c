@@ -50,21 +50,22 @@
 }
  */
 
+#include <pthread.h>
+#include <stdint.h>
+
 #include "zernike.h"
 #include "zern_private.h"
 
-// epsilon (==rmin)
-double eps = -1., eps2 = -1.;  // this global variable changes with each conv_r call!
-
 /**
  * convert coordinates of points on ring into normalized coordinates in [0, 1]
  * for further calculations of annular Zernike (expression for R_k^0)
  * @param r0  (i) - original coordinates array
  * @param Sz      - size of r0
+ * @param eps (o) - (if !NULL) epsilon (==rmin)
  * @return dinamically allocated array with new coordinates, which zero element is
  * 			(0,0)
  */
-polar *conv_r(polar *r0, int Sz){
+polar *conv_r(polar *r0, int Sz, double *eps){
 	int x;
 	polar *Pn = MALLOC(polar, Sz);
 	double rmax = -1., rmin = 2.;
@@ -75,8 +76,8 @@ polar *conv_r(polar *r0, int Sz){
 	}
 	if(rmin > rmax || fabs(rmin - rmax) <= DBL_EPSILON || rmax > 1. || rmin < 0.)
 		errx(1, "polar coordinates should be in [0,1]!");
-	eps = rmin;
-	eps2 = eps*eps;
+	double eps2 = rmin*rmin;
+	if(eps) *eps = rmin;
 	p = r0;
 	//rmax = 1. - eps2; // 1 - eps^2   -- denominator
 	rmax = rmax*rmax - eps2;
@@ -87,30 +88,6 @@ polar *conv_r(polar *r0, int Sz){
 	return Pn;
 }
 
-/**
- * Allocate 2D array (H arrays of length W)
- * @param len - array's width  (number of elements in each 1D array
- * @param num - array's height (number of 1D arrays)
- * @return dinamically allocated 2D array filled with zeros
- */
-_2D *_2ALLOC(int len, int num){
-	_2D *r = MALLOC(_2D, 1);
-	r->data = MALLOC(double*, num);
-	int x;
-	for(x = 0; x < num; x++)
-		r->data[x] = MALLOC(double, len);
-	r->len = (size_t)len;
-	r->num = (size_t)num;
-	return r;
-}
-
-void _2FREE(_2D **a){
-	int x, W = (*a)->num;
-	for(x = 0; x < W; x++) free((*a)->data[x]);
-	free((*a)->data);
-	FREE(*a);
-}
-
 /**
  * Zernike radial function R_n^0
  * @param n     - order of polynomial
@@ -153,7 +130,7 @@ void Rn0(int n, int Sz, polar *P, double *R){
  * @param n, m - Zernike orders
  * @return order in Noll notation
  */
-inline int p_from_nm(int n, int m){
+static inline int p_from_nm(int n, int m){
 	return (n*n + 2*n + m)/2;
 }
 
@@ -174,7 +151,9 @@ _2D *ann_Z(int pmax, int Sz, polar *P, double **Norm){
 	jmax = nmax / 2;
 	mW = mmax + 1; // width of row
 	jm = jmax + mW; // height of Q0 and h
-	polar *Pn = conv_r(P, Sz);
+	double eps, eps2;
+	polar *Pn = conv_r(P, Sz, &eps);
+	eps2 = eps*eps;
 	if(eps < 0. || eps2 < 0. || eps > 1. || eps2 > 1.)
 		errx(1, "Wrong epsilon value!!!");
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -200,10 +179,12 @@ DBG("Q,h [%d][0], h=%g\n", j, hd[j][0]);
 	FREE(Pn);
 	// fill h_j^m & Q_j&m
 	int JMAX = jm-1; // max number of j
+	double *acc = MALLOC(double, Sz); // running sum for Q_j^m
 	for(m = 1; m <= mmax; m++, JMAX--){ // m in outern cycle because of Q_{j+1}!
 DBG("\n\nm=%d\n",m);
 		int mminusone = m - 1;
 		int idx = mminusone;// index Q_j^{m-1}
+		memset(acc, 0, Sz*sizeof(double));
 		for(j = 0; j < JMAX; j++, idx+=mW){
 DBG("\nj=%d\n",j);
 			//             2(2j+2m-1) * h_j^{m-1}
@@ -216,17 +197,13 @@ DBG("hd[%d][%d] = %g (H = %g)\n", j, m, hd[j][m], H);
 			//                     j   Q_i^{m-1}(0) * Q_i^{m-1}(r)
 			// Q_j^m(r) = H_j^m * Sum -----------------------------
 			//                    i=0          h_i^{m-1}
+			// (sum is accumulated in acc through cycle by j)
 			if(j <= jmax){
 				int pt;
-				for(pt = 0; pt < Sz; pt++){ // cycle by points
-					int i, idx1 = mminusone;
-					double S = 0;
-					for(i = 0; i <=j; i++, idx1+=mW){ // cycle Sum
-						S += Q0d[i][mminusone] * Qd[idx1][pt] / hd[i][mminusone];
-					}
-					Qd[idx+1][pt] = H * S; // Q_j^m(rho^2)
-//DBG("Q[%d][%d](%d) = %g\n", j, m, pt, H * S);
-				}
+				double *q = Qd[idx+1];
+				zk_axpy(Q0d[j][mminusone] / hd[j][mminusone], Qd[idx], acc, Sz);
+				for(pt = 0; pt < Sz; pt++) // cycle by points
+					q[pt] = H * acc[pt]; // Q_j^m(rho^2)
 			}
 			// and Q(0):
 			double S = 0.;
@@ -239,6 +216,7 @@ DBG("hd[%d][%d] = %g (H = %g)\n", j, m, hd[j][m], H);
 			DBG("Q[%d][%d](0) = %g\n", j, m, H * S);
 		}
 	}
+	FREE(acc);
 	_2FREE(&Q0);
 
 	// allocate memory for Z_p
@@ -326,6 +304,193 @@ DBG("R_n^m\n");
 #undef DBG
 #define DBG(...) do{fprintf(stderr, __VA_ARGS__); }while(0)
 
+/*
+ * Cache of annular bases: orthogonalization in ann_Z is the most expensive part
+ * of annular decomposition, but for the same pupil (points set) its result is
+ * the same, so bases are stored in LRU cache with key (eps, pmax, hash of points).
+ * Annular polynomial p doesn't depend on pmax, so basis with bigger pmax serves
+ * requests with less pmax too.
+ */
+typedef struct ann_entry_{
+	double eps;          // obscuration ratio (min r)
+	uint64_t hash;       // hash of points array
+	int Sz;              // amount of points
+	int pmax;            // max polynomial number (including)
+	polar *P;            // copy of points (to check collisions)
+	_2D *Z;              // basis
+	double *norm;        // its norms
+	size_t bytes;        // memory used
+	uint64_t used;       // time of last use (for LRU)
+	int refcount;        // amount of users (entry can't be removed while it's in use)
+	struct ann_entry_ *next;
+} ann_entry;
+
+static pthread_mutex_t ann_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ann_entry *ann_cache = NULL;
+static int ann_cache_max = 8;     // max amount of cached bases
+static uint64_t ann_clock = 0;    // "time" for LRU
+static ann_cache_stat ann_stat = {0};
+
+/**
+ * Calculate hash of points array & min r
+ * @param Sz, P (i) - points
+ * @param eps (o)   - min r
+ * @return hash (FNV-1a by 64-bit words)
+ */
+uint64_t points_hash(int Sz, polar *P, double *eps){
+	uint64_t h = 14695981039346656037ULL, w;
+	double rmin = 2.;
+	int i;
+	for(i = 0; i < Sz; i++){
+		if(P[i].r < rmin) rmin = P[i].r;
+		memcpy(&w, &P[i].r, 8);
+		h = (h ^ w) * 1099511628211ULL;
+		memcpy(&w, &P[i].theta, 8);
+		h = (h ^ w) * 1099511628211ULL;
+	}
+	*eps = rmin;
+	return h;
+}
+
+static void ann_entry_free(ann_entry *e){
+	_2FREE(&e->Z);
+	FREE(e->norm);
+	FREE(e->P);
+	FREE(e);
+}
+
+/**
+ * Remove least recently used unused entries while cache is bigger than max size
+ * (should be called with locked mutex)
+ */
+static void ann_cache_shrink(int max){
+	while((int)ann_stat.entries > max){
+		ann_entry **e, **lru = NULL;
+		for(e = &ann_cache; *e; e = &(*e)->next){
+			if((*e)->refcount) continue;
+			if(!lru || (*e)->used < (*lru)->used) lru = e;
+		}
+		if(!lru) return; // all entries are in use
+		ann_entry *old = *lru;
+		*lru = old->next;
+		ann_stat.entries--;
+		ann_stat.bytes -= old->bytes;
+		ann_stat.evictions++;
+		ann_entry_free(old);
+	}
+}
+
+/**
+ * Find entry in cache (should be called with locked mutex)
+ * @return entry or NULL
+ */
+static ann_entry *ann_cache_find(double eps, uint64_t hash, int pmax, int Sz, polar *P){
+	ann_entry *e;
+	for(e = ann_cache; e; e = e->next){
+		if(e->hash != hash || e->eps != eps || e->Sz != Sz || e->pmax < pmax) continue;
+		if(memcmp(e->P, P, Sz*sizeof(polar))) continue;
+		return e;
+	}
+	return NULL;
+}
+
+/**
+ * Get annular basis from cache or calculate it
+ * @param pmax, Sz, P - like in ann_Z
+ * @return cache entry (release it by ann_release after usage)
+ */
+static ann_entry *ann_get(int pmax, int Sz, polar *P){
+	double eps;
+	uint64_t hash = points_hash(Sz, P, &eps);
+	pthread_mutex_lock(&ann_mutex);
+	ann_entry *e = ann_cache_find(eps, hash, pmax, Sz, P);
+	if(e){
+		ann_stat.hits++;
+		e->refcount++;
+		e->used = ++ann_clock;
+		pthread_mutex_unlock(&ann_mutex);
+		return e;
+	}
+	ann_stat.misses++;
+	pthread_mutex_unlock(&ann_mutex);
+	// calculate basis without lock
+	e = MALLOC(ann_entry, 1);
+	e->Z = ann_Z(pmax, Sz, P, &e->norm);
+	e->eps = eps; e->hash = hash;
+	e->Sz = Sz; e->pmax = pmax;
+	e->P = MALLOC(polar, Sz);
+	memcpy(e->P, P, Sz*sizeof(polar));
+	e->bytes = (size_t)(pmax + 1) * (Sz + 1) * sizeof(double) + Sz * sizeof(polar);
+	e->refcount = 1;
+	pthread_mutex_lock(&ann_mutex);
+	// other thread could calculate the same basis meanwhile: use its copy
+	ann_entry *c = ann_cache_find(eps, hash, pmax, Sz, P);
+	if(c){
+		c->refcount++;
+		c->used = ++ann_clock;
+		pthread_mutex_unlock(&ann_mutex);
+		ann_entry_free(e);
+		return c;
+	}
+	if(ann_cache_max > 0){
+		e->used = ++ann_clock;
+		e->next = ann_cache;
+		ann_cache = e;
+		ann_stat.entries++;
+		ann_stat.bytes += e->bytes;
+		ann_cache_shrink(ann_cache_max);
+	}else e->refcount = -1; // not in cache
+	pthread_mutex_unlock(&ann_mutex);
+	return e;
+}
+
+/**
+ * Release entry got by ann_get
+ */
+static void ann_release(ann_entry *e){
+	pthread_mutex_lock(&ann_mutex);
+	if(e->refcount < 0){ // isn't cached
+		pthread_mutex_unlock(&ann_mutex);
+		ann_entry_free(e);
+		return;
+	}
+	e->refcount--;
+	ann_cache_shrink(ann_cache_max);
+	pthread_mutex_unlock(&ann_mutex);
+}
+
+/**
+ * Set max amount of cached annular bases
+ * @param N - new size (0 - turn cache off)
+ */
+void ann_cache_setsize(int N){
+	if(N < 0) N = 0;
+	pthread_mutex_lock(&ann_mutex);
+	ann_cache_max = N;
+	ann_cache_shrink(N);
+	pthread_mutex_unlock(&ann_mutex);
+}
+
+/**
+ * Remove all unused entries from cache
+ */
+void ann_cache_clear(){
+	pthread_mutex_lock(&ann_mutex);
+	ann_cache_shrink(0);
+	pthread_mutex_unlock(&ann_mutex);
+}
+
+/**
+ * Get statistics of annular bases cache
+ * @param st (o) - statistics
+ */
+void ann_cache_stats(ann_cache_stat *st){
+	if(!st) return;
+	pthread_mutex_lock(&ann_mutex);
+	*st = ann_stat;
+	pthread_mutex_unlock(&ann_mutex);
+}
+
 /**
  * Compose wavefront by koefficients of annular Zernike polynomials
  * @params like for ZcomposeR
@@ -334,18 +499,14 @@ DBG("R_n^m\n");
 double *ann_Zcompose(int Zsz, double *Zidxs, int Sz, polar *P){
 	int i;
 	double *image = MALLOC(double, Sz);
-	_2D *Zannular = ann_Z(Zsz-1, Sz, P, NULL);
-	double **Zcoeff = Zannular->data;
+	ann_entry *Zannular = ann_get(Zsz-1, Sz, P);
+	double **Zcoeff = Zannular->Z->data;
 	for(i = 0; i < Zsz; i++){ // now we fill array
 		double K = Zidxs[i];
 		if(fabs(K) < Z_prec) continue;
-		int j;
-		double *iptr = image, *zptr = Zcoeff[i];
-		for(j = 0; j < Sz; j++, iptr++, zptr++){
-			*iptr += K * (*zptr); // add next Zernike polynomial
-		}
+		add_poly(Sz, image, Zcoeff[i], K); // add next Zernike polynomial
 	}
-	_2FREE(&Zannular);
+	ann_release(Zannular);
 	return image;
 }
 
@@ -363,25 +524,17 @@ double *ann_Zdecompose(int Nmax, int Sz, polar *P, double *heights, int *Zsz, in
 	icopy = MALLOC(double, Sz);
 	memcpy(icopy, heights, Sz*sizeof(double)); // make image copy to leave it unchanged
 	*Zsz = pmax;
-	double *norm;
-	_2D *Zannular = ann_Z(pmax-1, Sz, P, &norm);
-	double **Zcoeff = Zannular->data;
+	ann_entry *Zannular = ann_get(pmax-1, Sz, P);
+	double **Zcoeff = Zannular->Z->data, *norm = Zannular->norm;
 	for(i = 0; i < pmax; i++){ // now we fill array
-		int j;
-		double *iptr = icopy, *zptr = Zcoeff[i], K = 0., norm_i = norm[i];
-		for(j = 0; j < Sz; j++, iptr++, zptr++)
-			K += (*zptr) * (*iptr) / norm_i; // multiply matrixes to get coefficient
+		double K = proj_subtract(Sz, icopy, Zcoeff[i], norm[i]);
 		if(fabs(K) < Z_prec)
 			continue; // there's no need to substract values that are less than our precision
 		Zidxs[i] = K;
 		maxIdx = i;
-		iptr = icopy; zptr = Zcoeff[i];
-		for(j = 0; j < Sz; j++, iptr++, zptr++)
-			*iptr -= K * (*zptr); // subtract composed coefficient to reduce high orders values
 	}
 	if(lastIdx) *lastIdx = maxIdx;
-	_2FREE(&Zannular);
-	FREE(norm);
+	ann_release(Zannular);
 	FREE(icopy);
 	return Zidxs;
 }
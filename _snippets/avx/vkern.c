@@ -0,0 +1,465 @@
+/*
+ * vkern.c - vectorized numeric kernels with runtime CPU dispatch
+ *
+ * Copyright 2025 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+/*
+ * All variants are compiled in this file (by `target` attributes), so it shouldn't be built
+ * with -march=native: the best supported one is chosen at start by cpuid (with check of OS
+ * support of AVX registers) & could be lowered by vk_set_isa().
+ * Vector loops go from the first item where the main array (output or the first input) is
+ * aligned to vector size (scalar head before it); tails are masked (AVX-512) or scalar.
+ * All loads & stores are unaligned ones: they cost the same on aligned addresses, and
+ * arrays not aligned even to double (e.g. packed structures) can't be aligned by head.
+ * Reductions use 4 accumulators, so results of different variants differ by rounding.
+ * vk_fms (a*b - c) is fused only in AVX2 & AVX-512 variants. NaNs in vk_minmax aren't handled.
+ */
+
+#include <math.h>
+#include <stdint.h>
+
+#include "vkern.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define VK_X86
+#include <immintrin.h>
+#endif
+
+// amount of items before the first aligned to `A` bytes (0 if x can't be aligned)
+static inline size_t head(const double *x, size_t A, size_t n){
+	uintptr_t p = (uintptr_t)x;
+	if(p % sizeof(double)) return 0;
+	size_t h = ((A - (p & (A - 1))) & (A - 1)) / sizeof(double);
+	return (h < n) ? h : n;
+}
+
+/*--- Scalar ---*/
+
+static double dot_scalar(const double *a, const double *b, size_t n){
+	double s = 0.;
+	for(size_t i = 0; i < n; ++i) s += a[i] * b[i];
+	return s;
+}
+
+static double sum_scalar(const double *x, size_t n){
+	double s = 0.;
+	for(size_t i = 0; i < n; ++i) s += x[i];
+	return s;
+}
+
+static void minmax_scalar(const double *x, size_t n, double *min, double *max){
+	double mi = INFINITY, ma = -INFINITY;
+	for(size_t i = 0; i < n; ++i){
+		if(x[i] < mi) mi = x[i];
+		if(x[i] > ma) ma = x[i];
+	}
+	*min = mi; *max = ma;
+}
+
+static void axpy_scalar(double alpha, const double *x, double *y, size_t n){
+	for(size_t i = 0; i < n; ++i) y[i] += alpha * x[i];
+}
+
+static void scale_scalar(double alpha, double *x, size_t n){
+	for(size_t i = 0; i < n; ++i) x[i] *= alpha;
+}
+
+static void fms_scalar(const double *a, const double *b, const double *c, double *out, size_t n){
+	for(size_t i = 0; i < n; ++i) out[i] = a[i] * b[i] - c[i];
+}
+
+#ifdef VK_X86
+/*--- SSE2 ---*/
+
+static inline double hsum_sse2(__m128d v){
+	return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+static double dot_sse2(const double *a, const double *b, size_t n){
+	size_t i = 0, h = head(a, 16, n);
+	double s = 0.;
+	for(; i < h; ++i) s += a[i] * b[i];
+	__m128d s0 = _mm_setzero_pd(), s1 = s0, s2 = s0, s3 = s0;
+	for(; i + 8 <= n; i += 8){
+		s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+		s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+		s2 = _mm_add_pd(s2, _mm_mul_pd(_mm_loadu_pd(a + i + 4), _mm_loadu_pd(b + i + 4)));
+		s3 = _mm_add_pd(s3, _mm_mul_pd(_mm_loadu_pd(a + i + 6), _mm_loadu_pd(b + i + 6)));
+	}
+	for(; i + 2 <= n; i += 2) s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+	s += hsum_sse2(_mm_add_pd(_mm_add_pd(s0, s1), _mm_add_pd(s2, s3)));
+	for(; i < n; ++i) s += a[i] * b[i];
+	return s;
+}
+
+static double sum_sse2(const double *x, size_t n){
+	size_t i = 0, h = head(x, 16, n);
+	double s = 0.;
+	for(; i < h; ++i) s += x[i];
+	__m128d s0 = _mm_setzero_pd(), s1 = s0, s2 = s0, s3 = s0;
+	for(; i + 8 <= n; i += 8){
+		s0 = _mm_add_pd(s0, _mm_loadu_pd(x + i));
+		s1 = _mm_add_pd(s1, _mm_loadu_pd(x + i + 2));
+		s2 = _mm_add_pd(s2, _mm_loadu_pd(x + i + 4));
+		s3 = _mm_add_pd(s3, _mm_loadu_pd(x + i + 6));
+	}
+	for(; i + 2 <= n; i += 2) s0 = _mm_add_pd(s0, _mm_loadu_pd(x + i));
+	s += hsum_sse2(_mm_add_pd(_mm_add_pd(s0, s1), _mm_add_pd(s2, s3)));
+	for(; i < n; ++i) s += x[i];
+	return s;
+}
+
+static void minmax_sse2(const double *x, size_t n, double *min, double *max){
+	size_t i = 0, h = head(x, 16, n);
+	double mi = INFINITY, ma = -INFINITY;
+	for(; i < h; ++i){
+		if(x[i] < mi) mi = x[i];
+		if(x[i] > ma) ma = x[i];
+	}
+	__m128d vmi = _mm_set1_pd(mi), vma = _mm_set1_pd(ma), vmi1 = vmi, vma1 = vma;
+	for(; i + 4 <= n; i += 4){
+		__m128d v0 = _mm_loadu_pd(x + i), v1 = _mm_loadu_pd(x + i + 2);
+		vmi = _mm_min_pd(vmi, v0); vma = _mm_max_pd(vma, v0);
+		vmi1 = _mm_min_pd(vmi1, v1); vma1 = _mm_max_pd(vma1, v1);
+	}
+	vmi = _mm_min_pd(vmi, vmi1);
+	vma = _mm_max_pd(vma, vma1);
+	vmi = _mm_min_sd(vmi, _mm_unpackhi_pd(vmi, vmi));
+	vma = _mm_max_sd(vma, _mm_unpackhi_pd(vma, vma));
+	mi = _mm_cvtsd_f64(vmi);
+	ma = _mm_cvtsd_f64(vma);
+	for(; i < n; ++i){
+		if(x[i] < mi) mi = x[i];
+		if(x[i] > ma) ma = x[i];
+	}
+	*min = mi; *max = ma;
+}
+
+static void axpy_sse2(double alpha, const double *x, double *y, size_t n){
+	size_t i = 0, h = head(y, 16, n);
+	for(; i < h; ++i) y[i] += alpha * x[i];
+	__m128d a = _mm_set1_pd(alpha);
+	for(; i + 4 <= n; i += 4){
+		_mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(a, _mm_loadu_pd(x + i))));
+		_mm_storeu_pd(y + i + 2, _mm_add_pd(_mm_loadu_pd(y + i + 2), _mm_mul_pd(a, _mm_loadu_pd(x + i + 2))));
+	}
+	for(; i < n; ++i) y[i] += alpha * x[i];
+}
+
+static void scale_sse2(double alpha, double *x, size_t n){
+	size_t i = 0, h = head(x, 16, n);
+	for(; i < h; ++i) x[i] *= alpha;
+	__m128d a = _mm_set1_pd(alpha);
+	for(; i + 4 <= n; i += 4){
+		_mm_storeu_pd(x + i, _mm_mul_pd(a, _mm_loadu_pd(x + i)));
+		_mm_storeu_pd(x + i + 2, _mm_mul_pd(a, _mm_loadu_pd(x + i + 2)));
+	}
+	for(; i < n; ++i) x[i] *= alpha;
+}
+
+static void fms_sse2(const double *a, const double *b, const double *c, double *out, size_t n){
+	size_t i = 0, h = head(out, 16, n);
+	for(; i < h; ++i) out[i] = a[i] * b[i] - c[i];
+	for(; i + 2 <= n; i += 2)
+		_mm_storeu_pd(out + i, _mm_sub_pd(_mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)), _mm_loadu_pd(c + i)));
+	for(; i < n; ++i) out[i] = a[i] * b[i] - c[i];
+}
+
+/*--- AVX2 + FMA ---*/
+
+#define AVX2    __attribute__((target("avx2,fma")))
+
+static AVX2 inline double hsum_avx2(__m256d v){
+	__m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+	return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+static AVX2 double dot_avx2(const double *a, const double *b, size_t n){
+	size_t i = 0, h = head(a, 32, n);
+	double s = 0.;
+	for(; i < h; ++i) s += a[i] * b[i];
+	__m256d s0 = _mm256_setzero_pd(), s1 = s0, s2 = s0, s3 = s0;
+	for(; i + 16 <= n; i += 16){
+		s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+		s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), s1);
+		s2 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 8), _mm256_loadu_pd(b + i + 8), s2);
+		s3 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12), s3);
+	}
+	for(; i + 4 <= n; i += 4) s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+	s += hsum_avx2(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+	for(; i < n; ++i) s += a[i] * b[i];
+	return s;
+}
+
+static AVX2 double sum_avx2(const double *x, size_t n){
+	size_t i = 0, h = head(x, 32, n);
+	double s = 0.;
+	for(; i < h; ++i) s += x[i];
+	__m256d s0 = _mm256_setzero_pd(), s1 = s0, s2 = s0, s3 = s0;
+	for(; i + 16 <= n; i += 16){
+		s0 = _mm256_add_pd(s0, _mm256_loadu_pd(x + i));
+		s1 = _mm256_add_pd(s1, _mm256_loadu_pd(x + i + 4));
+		s2 = _mm256_add_pd(s2, _mm256_loadu_pd(x + i + 8));
+		s3 = _mm256_add_pd(s3, _mm256_loadu_pd(x + i + 12));
+	}
+	for(; i + 4 <= n; i += 4) s0 = _mm256_add_pd(s0, _mm256_loadu_pd(x + i));
+	s += hsum_avx2(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+	for(; i < n; ++i) s += x[i];
+	return s;
+}
+
+static AVX2 void minmax_avx2(const double *x, size_t n, double *min, double *max){
+	size_t i = 0, h = head(x, 32, n);
+	double mi = INFINITY, ma = -INFINITY;
+	for(; i < h; ++i){
+		if(x[i] < mi) mi = x[i];
+		if(x[i] > ma) ma = x[i];
+	}
+	__m256d vmi = _mm256_set1_pd(mi), vma = _mm256_set1_pd(ma), vmi1 = vmi, vma1 = vma;
+	for(; i + 8 <= n; i += 8){
+		__m256d v0 = _mm256_loadu_pd(x + i), v1 = _mm256_loadu_pd(x + i + 4);
+		vmi = _mm256_min_pd(vmi, v0); vma = _mm256_max_pd(vma, v0);
+		vmi1 = _mm256_min_pd(vmi1, v1); vma1 = _mm256_max_pd(vma1, v1);
+	}
+	vmi = _mm256_min_pd(vmi, vmi1);
+	vma = _mm256_max_pd(vma, vma1);
+	__m128d m = _mm_min_pd(_mm256_castpd256_pd128(vmi), _mm256_extractf128_pd(vmi, 1));
+	__m128d M = _mm_max_pd(_mm256_castpd256_pd128(vma), _mm256_extractf128_pd(vma, 1));
+	mi = _mm_cvtsd_f64(_mm_min_sd(m, _mm_unpackhi_pd(m, m)));
+	ma = _mm_cvtsd_f64(_mm_max_sd(M, _mm_unpackhi_pd(M, M)));
+	for(; i < n; ++i){
+		if(x[i] < mi) mi = x[i];
+		if(x[i] > ma) ma = x[i];
+	}
+	*min = mi; *max = ma;
+}
+
+static AVX2 void axpy_avx2(double alpha, const double *x, double *y, size_t n){
+	size_t i = 0, h = head(y, 32, n);
+	for(; i < h; ++i) y[i] += alpha * x[i];
+	__m256d a = _mm256_set1_pd(alpha);
+	for(; i + 8 <= n; i += 8){
+		_mm256_storeu_pd(y + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+		_mm256_storeu_pd(y + i + 4, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+	}
+	for(; i < n; ++i) y[i] += alpha * x[i];
+}
+
+static AVX2 void scale_avx2(double alpha, double *x, size_t n){
+	size_t i = 0, h = head(x, 32, n);
+	for(; i < h; ++i) x[i] *= alpha;
+	__m256d a = _mm256_set1_pd(alpha);
+	for(; i + 8 <= n; i += 8){
+		_mm256_storeu_pd(x + i, _mm256_mul_pd(a, _mm256_loadu_pd(x + i)));
+		_mm256_storeu_pd(x + i + 4, _mm256_mul_pd(a, _mm256_loadu_pd(x + i + 4)));
+	}
+	for(; i < n; ++i) x[i] *= alpha;
+}
+
+static AVX2 void fms_avx2(const double *a, const double *b, const double *c, double *out, size_t n){
+	size_t i = 0, h = head(out, 32, n);
+	for(; i < h; ++i) out[i] = fma(a[i], b[i], -c[i]);
+	for(; i + 4 <= n; i += 4)
+		_mm256_storeu_pd(out + i, _mm256_fmsub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), _mm256_loadu_pd(c + i)));
+	for(; i < n; ++i) out[i] = fma(a[i], b[i], -c[i]);
+}
+
+/*--- AVX-512F ---*/
+
+#define AVX512  __attribute__((target("avx512f")))
+
+// mask of the first k < 8 items
+#define TAILMASK(k) ((__mmask8)((1u << (k)) - 1))
+
+static AVX512 double dot_avx512(const double *a, const double *b, size_t n){
+	size_t i = 0, h = head(a, 64, n);
+	double s = 0.;
+	for(; i < h; ++i) s += a[i] * b[i];
+	__m512d s0 = _mm512_setzero_pd(), s1 = s0, s2 = s0, s3 = s0;
+	for(; i + 32 <= n; i += 32){
+		s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), s0);
+		s1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), s1);
+		s2 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 16), _mm512_loadu_pd(b + i + 16), s2);
+		s3 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 24), _mm512_loadu_pd(b + i + 24), s3);
+	}
+	for(; i + 8 <= n; i += 8) s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), s0);
+	if(i < n){
+		__mmask8 m = TAILMASK(n - i);
+		s1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, a + i), _mm512_maskz_loadu_pd(m, b + i), s1);
+	}
+	return s + _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+}
+
+static AVX512 double sum_avx512(const double *x, size_t n){
+	size_t i = 0, h = head(x, 64, n);
+	double s = 0.;
+	for(; i < h; ++i) s += x[i];
+	__m512d s0 = _mm512_setzero_pd(), s1 = s0, s2 = s0, s3 = s0;
+	for(; i + 32 <= n; i += 32){
+		s0 = _mm512_add_pd(s0, _mm512_loadu_pd(x + i));
+		s1 = _mm512_add_pd(s1, _mm512_loadu_pd(x + i + 8));
+		s2 = _mm512_add_pd(s2, _mm512_loadu_pd(x + i + 16));
+		s3 = _mm512_add_pd(s3, _mm512_loadu_pd(x + i + 24));
+	}
+	for(; i + 8 <= n; i += 8) s0 = _mm512_add_pd(s0, _mm512_loadu_pd(x + i));
+	if(i < n) s1 = _mm512_add_pd(s1, _mm512_maskz_loadu_pd(TAILMASK(n - i), x + i));
+	return s + _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+}
+
+static AVX512 void minmax_avx512(const double *x, size_t n, double *min, double *max){
+	size_t i = 0, h = head(x, 64, n);
+	double mi = INFINITY, ma = -INFINITY;
+	for(; i < h; ++i){
+		if(x[i] < mi) mi = x[i];
+		if(x[i] > ma) ma = x[i];
+	}
+	__m512d vmi = _mm512_set1_pd(mi), vma = _mm512_set1_pd(ma), vmi1 = vmi, vma1 = vma;
+	for(; i + 16 <= n; i += 16){
+		__m512d v0 = _mm512_loadu_pd(x + i), v1 = _mm512_loadu_pd(x + i + 8);
+		vmi = _mm512_min_pd(vmi, v0); vma = _mm512_max_pd(vma, v0);
+		vmi1 = _mm512_min_pd(vmi1, v1); vma1 = _mm512_max_pd(vma1, v1);
+	}
+	for(; i < n; i += 8){ // masked-out items keep previous min & max
+		__mmask8 m = (n - i >= 8) ? 0xff : TAILMASK(n - i);
+		__m512d v = _mm512_maskz_loadu_pd(m, x + i);
+		vmi = _mm512_mask_min_pd(vmi, m, vmi, v);
+		vma = _mm512_mask_max_pd(vma, m, vma, v);
+	}
+	*min = _mm512_reduce_min_pd(_mm512_min_pd(vmi, vmi1));
+	*max = _mm512_reduce_max_pd(_mm512_max_pd(vma, vma1));
+}
+
+static AVX512 void axpy_avx512(double alpha, const double *x, double *y, size_t n){
+	size_t i = 0, h = head(y, 64, n);
+	for(; i < h; ++i) y[i] += alpha * x[i];
+	__m512d a = _mm512_set1_pd(alpha);
+	for(; i + 16 <= n; i += 16){
+		_mm512_storeu_pd(y + i, _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+		_mm512_storeu_pd(y + i + 8, _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8)));
+	}
+	for(; i < n; i += 8){
+		__mmask8 m = (n - i >= 8) ? 0xff : TAILMASK(n - i);
+		_mm512_mask_storeu_pd(y + i, m, _mm512_fmadd_pd(a, _mm512_maskz_loadu_pd(m, x + i), _mm512_maskz_loadu_pd(m, y + i)));
+	}
+}
+
+static AVX512 void scale_avx512(double alpha, double *x, size_t n){
+	size_t i = 0, h = head(x, 64, n);
+	for(; i < h; ++i) x[i] *= alpha;
+	__m512d a = _mm512_set1_pd(alpha);
+	for(; i + 16 <= n; i += 16){
+		_mm512_storeu_pd(x + i, _mm512_mul_pd(a, _mm512_loadu_pd(x + i)));
+		_mm512_storeu_pd(x + i + 8, _mm512_mul_pd(a, _mm512_loadu_pd(x + i + 8)));
+	}
+	for(; i < n; i += 8){
+		__mmask8 m = (n - i >= 8) ? 0xff : TAILMASK(n - i);
+		_mm512_mask_storeu_pd(x + i, m, _mm512_mul_pd(a, _mm512_maskz_loadu_pd(m, x + i)));
+	}
+}
+
+static AVX512 void fms_avx512(const double *a, const double *b, const double *c, double *out, size_t n){
+	size_t i = 0, h = head(out, 64, n);
+	for(; i < h; ++i) out[i] = fma(a[i], b[i], -c[i]);
+	for(; i < n; i += 8){
+		__mmask8 m = (n - i >= 8) ? 0xff : TAILMASK(n - i);
+		__m512d v = _mm512_fmsub_pd(_mm512_maskz_loadu_pd(m, a + i), _mm512_maskz_loadu_pd(m, b + i), _mm512_maskz_loadu_pd(m, c + i));
+		_mm512_mask_storeu_pd(out + i, m, v);
+	}
+}
+#endif // VK_X86
+
+/*--- Dispatch ---*/
+
+typedef struct{
+	double (*dot)(const double*, const double*, size_t);
+	double (*sum)(const double*, size_t);
+	void (*minmax)(const double*, size_t, double*, double*);
+	void (*axpy)(double, const double*, double*, size_t);
+	void (*scale)(double, double*, size_t);
+	void (*fms)(const double*, const double*, const double*, double*, size_t);
+} vk_funcs;
+
+static const vk_funcs funcs[VK_NISA] = {
+	[VK_SCALAR] = {dot_scalar, sum_scalar, minmax_scalar, axpy_scalar, scale_scalar, fms_scalar},
+#ifdef VK_X86
+	[VK_SSE2] = {dot_sse2, sum_sse2, minmax_sse2, axpy_sse2, scale_sse2, fms_sse2},
+	[VK_AVX2] = {dot_avx2, sum_avx2, minmax_avx2, axpy_avx2, scale_avx2, fms_avx2},
+	[VK_AVX512] = {dot_avx512, sum_avx512, minmax_avx512, axpy_avx512, scale_avx512, fms_avx512},
+#endif
+};
+
+static vk_isa maxisa = VK_SCALAR, curisa = VK_SCALAR;
+static vk_funcs F = {dot_scalar, sum_scalar, minmax_scalar, axpy_scalar, scale_scalar, fms_scalar};
+
+// __builtin_cpu_supports() checks cpuid & XCR0 (OS saves AVX/AVX-512 registers)
+static __attribute__((constructor)) void vk_init(){
+#ifdef VK_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx512f")) maxisa = VK_AVX512;
+	else if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) maxisa = VK_AVX2;
+	else if(__builtin_cpu_supports("sse2")) maxisa = VK_SSE2;
+#endif
+	curisa = maxisa;
+	F = funcs[curisa];
+}
+
+// the best instruction set supported
+vk_isa vk_max_isa(){ return maxisa; }
+
+// instruction set in use
+vk_isa vk_get_isa(){ return curisa; }
+
+/**
+ * Select instruction set (e.g. for tests), not thread-safe
+ * @return 0 if all OK, -1 if it isn't supported
+ */
+int vk_set_isa(vk_isa isa){
+	if(isa < VK_SCALAR || isa > maxisa) return -1;
+	curisa = isa;
+	F = funcs[isa];
+	return 0;
+}
+
+const char *vk_isa_name(vk_isa isa){
+	static const char *names[VK_NISA] = {"scalar", "SSE2", "AVX2+FMA", "AVX-512F"};
+	return (isa >= VK_SCALAR && isa < VK_NISA) ? names[isa] : "unknown";
+}
+
+// sum(a[i] * b[i])
+double vk_dot(const double *a, const double *b, size_t n){ return F.dot(a, b, n); }
+
+// sum(x[i])
+double vk_sum(const double *x, size_t n){ return F.sum(x, n); }
+
+// min & max of x (INFINITY & -INFINITY for n == 0)
+void vk_minmax(const double *x, size_t n, double *min, double *max){
+	double mi, ma;
+	F.minmax(x, n, &mi, &ma);
+	if(min) *min = mi;
+	if(max) *max = ma;
+}
+
+// y[i] += alpha * x[i]
+void vk_axpy(double alpha, const double *x, double *y, size_t n){ F.axpy(alpha, x, y, n); }
+
+// x[i] *= alpha
+void vk_scale(double alpha, double *x, size_t n){ F.scale(alpha, x, n); }
+
+// out[i] = a[i] * b[i] - c[i]
+void vk_fms(const double *a, const double *b, const double *c, double *out, size_t n){ F.fms(a, b, c, out, n); }
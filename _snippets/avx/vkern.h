@@ -0,0 +1,50 @@
+/*
+ * vkern.h - vectorized numeric kernels with runtime CPU dispatch
+ *
+ * Copyright 2025 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#pragma once
+#ifndef __VKERN_H__
+#define __VKERN_H__
+
+#include <stddef.h>
+
+// instruction sets (each next includes previous)
+typedef enum{
+	VK_SCALAR,
+	VK_SSE2,
+	VK_AVX2,        // AVX2 + FMA
+	VK_AVX512,      // AVX-512F
+	VK_NISA
+} vk_isa;
+
+vk_isa vk_max_isa();
+vk_isa vk_get_isa();
+int vk_set_isa(vk_isa isa);
+const char *vk_isa_name(vk_isa isa);
+
+// arrays may have any length & alignment; outputs may coincide with inputs
+double vk_dot(const double *a, const double *b, size_t n);
+double vk_sum(const double *x, size_t n);
+void vk_minmax(const double *x, size_t n, double *min, double *max);
+void vk_axpy(double alpha, const double *x, double *y, size_t n);
+void vk_scale(double alpha, double *x, size_t n);
+void vk_fms(const double *a, const double *b, const double *c, double *out, size_t n);
+
+#endif // __VKERN_H__
@@ -0,0 +1,172 @@
+/*
+ * vkern_test.c - tests & benchmark of vkern kernels for all supported instruction sets
+ *
+ * Copyright 2025 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include <err.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vkern.h"
+
+#define MAXN    (300)
+// max relative error of sums (by sum of absolute values of terms)
+#define TOLERANCE   (1e-14)
+
+static double dtime(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static double rnd(){ return 2. * drand48() - 1.; }
+
+static void chk(int ok, const char *what, size_t n, int off){
+	if(!ok) errx(1, "%s: %s failed for n=%zd, offset=%d", vk_isa_name(vk_get_isa()), what, n, off);
+}
+
+// check all kernels on arrays of length n (y & R - buffers for results)
+static void check(size_t n, double *a, double *b, double *c, double *y, double *R, int off){
+	long double dot = 0., sum = 0., adot = 0., asum = 0.;
+	double mi = INFINITY, ma = -INFINITY, alpha = rnd();
+	for(size_t i = 0; i < n; ++i){
+		a[i] = rnd(); b[i] = rnd(); c[i] = rnd(); y[i] = rnd();
+		dot += (long double)a[i] * b[i];
+		adot += fabsl((long double)a[i] * b[i]);
+		sum += a[i];
+		asum += fabsl(a[i]);
+		if(a[i] < mi) mi = a[i];
+		if(a[i] > ma) ma = a[i];
+	}
+	chk(fabsl(vk_dot(a, b, n) - dot) <= TOLERANCE * adot, "dot", n, off);
+	chk(fabsl(vk_sum(a, n) - sum) <= TOLERANCE * asum, "sum", n, off);
+	double m, M;
+	vk_minmax(a, n, &m, &M);
+	chk(m == mi && M == ma, "minmax", n, off);
+	for(size_t i = 0; i < n; ++i) R[i] = y[i] + alpha * a[i];
+	vk_axpy(alpha, a, y, n);
+	for(size_t i = 0; i < n; ++i) chk(fabs(y[i] - R[i]) <= 1e-15, "axpy", n, off);
+	for(size_t i = 0; i < n; ++i) R[i] = b[i] * alpha;
+	vk_scale(alpha, b, n);
+	chk(!memcmp(b, R, n * sizeof(double)), "scale", n, off);
+	for(size_t i = 0; i < n; ++i) R[i] = a[i] * b[i] - c[i];
+	vk_fms(a, b, c, y, n);
+	for(size_t i = 0; i < n; ++i) chk(fabs(y[i] - R[i]) <= 1e-15, "fms", n, off);
+	vk_fms(a, b, c, a, n); // in-place
+	for(size_t i = 0; i < n; ++i) chk(fabs(a[i] - R[i]) <= 1e-15, "fms in-place", n, off);
+}
+
+// check all kernels for all lengths <= MAXN & all offsets of arrays
+static void test(){
+	double *A = malloc((MAXN + 16) * sizeof(double)), *B = malloc((MAXN + 16) * sizeof(double));
+	double *C = malloc((MAXN + 16) * sizeof(double)), *Y = malloc((MAXN + 16) * sizeof(double));
+	double *R = malloc((MAXN + 16) * sizeof(double));
+	for(size_t n = 0; n <= MAXN; ++n) for(int off = 0; off < 8; ++off){
+		check(n, A + off, B + (off * 3) % 8, C + (off * 5) % 8, Y + (7 - off), R, off);
+		// guards around arrays are untouched
+		if(n == MAXN && off == 0){
+			for(size_t i = 0; i < 8; ++i) Y[7 + n + i] = 42.;
+			vk_axpy(1., A, Y + 7, n);
+			vk_scale(2., Y + 7, n);
+			for(size_t i = 0; i < 8; ++i) chk(Y[7 + n + i] == 42., "tail guard", n, off);
+		}
+	}
+	free(A); free(B); free(C); free(Y); free(R);
+}
+
+// check all kernels on arrays not aligned even to double (shifted by 1..7 bytes);
+// data is moved by memcpy & reference results are calculated on aligned copies
+static void test_bytes(){
+	size_t sz = MAXN * sizeof(double), step = sz + 16;
+	char *buf = malloc(4 * step);
+	double *a = malloc(5 * sz), *b = a + MAXN, *c = b + MAXN, *y = c + MAXN, *R = y + MAXN;
+	for(size_t n = 0; n <= MAXN; ++n) for(int off = 1; off < 8; ++off){
+		double *ua = (double*)(buf + off), *ub = (double*)(buf + step + off);
+		double *uc = (double*)(buf + 2 * step + off), *uy = (double*)(buf + 3 * step + off);
+		long double dot = 0., sum = 0., adot = 0., asum = 0.;
+		double mi = INFINITY, ma = -INFINITY, alpha = rnd(), m, M;
+		for(size_t i = 0; i < n; ++i){
+			a[i] = rnd(); b[i] = rnd(); c[i] = rnd(); y[i] = rnd();
+			dot += (long double)a[i] * b[i];
+			adot += fabsl((long double)a[i] * b[i]);
+			sum += a[i];
+			asum += fabsl(a[i]);
+			if(a[i] < mi) mi = a[i];
+			if(a[i] > ma) ma = a[i];
+		}
+		memcpy(ua, a, sz); memcpy(ub, b, sz); memcpy(uc, c, sz); memcpy(uy, y, sz);
+		chk(fabsl(vk_dot(ua, ub, n) - dot) <= TOLERANCE * adot, "dot (bytes)", n, off);
+		chk(fabsl(vk_sum(ua, n) - sum) <= TOLERANCE * asum, "sum (bytes)", n, off);
+		vk_minmax(ua, n, &m, &M);
+		chk(m == mi && M == ma, "minmax (bytes)", n, off);
+		vk_axpy(alpha, ua, uy, n);
+		memcpy(R, uy, sz);
+		for(size_t i = 0; i < n; ++i) chk(fabs(R[i] - (y[i] + alpha * a[i])) <= 1e-15, "axpy (bytes)", n, off);
+		vk_scale(alpha, ub, n);
+		memcpy(R, ub, sz);
+		for(size_t i = 0; i < n; ++i) chk(R[i] == b[i] * alpha, "scale (bytes)", n, off);
+		for(size_t i = 0; i < n; ++i) b[i] *= alpha;
+		vk_fms(ua, ub, uc, uy, n);
+		memcpy(R, uy, sz);
+		for(size_t i = 0; i < n; ++i) chk(fabs(R[i] - (a[i] * b[i] - c[i])) <= 1e-15, "fms (bytes)", n, off);
+	}
+	free(buf); free(a);
+}
+
+// ns per element for arrays of n items
+static void bench(size_t n){
+	double *a = malloc((n + 1) * sizeof(double)), *b = malloc(n * sizeof(double)), *y = malloc(n * sizeof(double));
+	for(size_t i = 0; i < n; ++i){ a[i] = rnd(); b[i] = rnd(); y[i] = rnd(); }
+	++a; // unaligned
+	size_t niter = 200000000 / n + 1;
+	double t[4], sink = 0.;
+	printf("%9zd:", n);
+	t[0] = dtime();
+	for(size_t k = 0; k < niter; ++k) sink += vk_dot(a, b, n);
+	t[1] = dtime();
+	for(size_t k = 0; k < niter; ++k) vk_axpy(1e-9, a, y, n);
+	t[2] = dtime();
+	for(size_t k = 0; k < niter; ++k){ double m, M; vk_minmax(y, n, &m, &M); sink += m; }
+	t[3] = dtime();
+	double f = 1e9 / (double)(niter * n);
+	printf(" dot %6.3f, axpy %6.3f, minmax %6.3f ns/item", (t[1] - t[0]) * f, (t[2] - t[1]) * f, (t[3] - t[2]) * f);
+	printf("%s\n", (sink == 1.) ? " " : "");
+	free(a - 1); free(b); free(y);
+}
+
+int main(){
+	vk_isa max = vk_max_isa();
+	printf("Best instruction set: %s\n", vk_isa_name(max));
+	for(vk_isa isa = VK_SCALAR; isa <= max; ++isa){
+		if(vk_set_isa(isa)) errx(1, "can't set %s", vk_isa_name(isa));
+		test();
+		test_bytes();
+		printf("%s: tests passed\n", vk_isa_name(isa));
+	}
+	static const size_t sizes[] = {1000, 100000, 10000000};
+	for(vk_isa isa = VK_SCALAR; isa <= max; ++isa){
+		vk_set_isa(isa);
+		printf("\n%s\n", vk_isa_name(isa));
+		for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) bench(sizes[i]);
+	}
+	return 0;
+}
@@ -0,0 +1,665 @@
+/*
+ * bptree.c - B+-tree: ordered index with wide nodes & pool allocation
+ *
+ * Copyright 2025 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+/*
+ * Inner nodes keep keys[i] == min key of subtree child[i+1], all data is in leaves,
+ * leaves are linked in list for ordered scans. Nodes have size BPT_NODESZ and are
+ * taken from chunks of BPT_POOLNODES nodes (freed nodes go to free list).
+ * Insertion to the end of the last leaf (monotonic keys, e.g. timestamps) splits
+ * nodes unevenly: left node stays full, so such trees are as dense as bulk-loaded.
+ * compile test: gcc -O2 -DSTANDALONE bptree.c -o bptree
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <err.h>
+
+#include "bptree.h"
+
+#ifndef FREE
+#define FREE(arg) do{free(arg); arg = NULL;}while(0)
+#endif
+
+// min amount of keys in non-root nodes (after removing)
+#define INNER_MIN   ((int)BPT_INNER_KEYS / 2)
+#define LEAF_MIN    ((int)BPT_LEAF_KEYS / 2)
+
+_Static_assert(sizeof(bpt_inner) <= BPT_NODESZ && sizeof(bpt_leaf) <= BPT_NODESZ, "BPT_NODESZ is too small");
+_Static_assert(BPT_INNER_KEYS >= 3 && BPT_LEAF_KEYS >= 2, "BPT_NODESZ is too small");
+
+/*--- Pool of nodes ---*/
+
+static void *node_alloc(bptree *t){
+	void *p;
+	if(t->freelist){
+		p = t->freelist;
+		t->freelist = *(void**)p;
+	}else{
+		if(!t->chunk || t->chunkused == BPT_POOLNODES){
+			if(t->nchunks == t->chunksalloc){
+				size_t na = t->chunksalloc ? t->chunksalloc * 2 : 16;
+				char **c = realloc(t->chunks, na * sizeof(char*));
+				if(!c) return NULL;
+				t->chunks = c;
+				t->chunksalloc = na;
+			}
+			if(posix_memalign((void**)&t->chunk, 64, (size_t)BPT_POOLNODES * BPT_NODESZ)){
+				t->chunk = NULL;
+				return NULL;
+			}
+			t->chunks[t->nchunks++] = t->chunk;
+			t->chunkused = 0;
+		}
+		p = t->chunk + (size_t)BPT_NODESZ * t->chunkused++;
+	}
+	++t->nnodes;
+	return p;
+}
+
+static void node_free(bptree *t, void *p){
+	*(void**)p = t->freelist;
+	t->freelist = p;
+	--t->nnodes;
+}
+
+// free all nodes
+static void pool_clear(bptree *t){
+	for(size_t i = 0; i < t->nchunks; ++i) free(t->chunks[i]);
+	t->nchunks = 0;
+	t->chunk = NULL;
+	t->freelist = NULL;
+	t->nnodes = 0;
+	t->root = NULL;
+	t->height = 0;
+	t->size = 0;
+	t->first = t->last = NULL;
+}
+
+static bpt_leaf *leaf_init(void *p){
+	bpt_leaf *l = p;
+	if(!l) return NULL;
+	l->leaf = 1;
+	l->n = 0;
+	l->prev = l->next = NULL;
+	return l;
+}
+static bpt_inner *inner_init(void *p){
+	bpt_inner *in = p;
+	if(!in) return NULL;
+	in->leaf = 0;
+	in->n = 0;
+	return in;
+}
+static bpt_leaf *leaf_new(bptree *t){ return leaf_init(node_alloc(t)); }
+static bpt_inner *inner_new(bptree *t){ return inner_init(node_alloc(t)); }
+
+/*--- Search ---*/
+
+// index of first key >= k
+static inline int lbound(const bpt_key *keys, int n, bpt_key k){
+	int lo = 0, hi = n;
+	while(lo < hi){
+		int mid = (lo + hi) >> 1;
+		if(BPT_LESS(keys[mid], k)) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+// index of first key > k (number of child to go)
+static inline int ubound(const bpt_key *keys, int n, bpt_key k){
+	int lo = 0, hi = n;
+	while(lo < hi){
+		int mid = (lo + hi) >> 1;
+		if(BPT_LESS(k, keys[mid])) hi = mid;
+		else lo = mid + 1;
+	}
+	return lo;
+}
+
+/**
+ * Find leaf which can contain `key`
+ * @param path, idx - (if !NULL) inner nodes from root & numbers of children on path
+ * @return leaf (NULL for empty tree)
+ */
+static bpt_leaf *find_leaf(const bptree *t, bpt_key key, bpt_inner **path, int *idx){
+	void *n = t->root;
+	for(int d = 0; d < t->height - 1; ++d){
+		bpt_inner *in = n;
+		int i = ubound(in->keys, in->n, key);
+		if(path){ path[d] = in; idx[d] = i; }
+		n = in->child[i];
+	}
+	return n;
+}
+
+/*--- Public Interface ---*/
+
+bptree *bpt_new(){
+	bptree *t = calloc(1, sizeof(bptree));
+	if(!t) err(1, "calloc");
+	return t;
+}
+
+void bpt_free(bptree **t){
+	if(!t || !*t) return;
+	pool_clear(*t);
+	FREE((*t)->chunks);
+	FREE(*t);
+}
+
+/**
+ * Get value by key
+ * @param val - (if !NULL) value
+ * @return 1 if found, 0 if not
+ */
+int bpt_get(const bptree *t, bpt_key key, bpt_val *val){
+	bpt_leaf *l = find_leaf(t, key, NULL, NULL);
+	if(!l) return 0;
+	int pos = lbound(l->keys, l->n, key);
+	if(pos == l->n || BPT_LESS(key, l->keys[pos])) return 0;
+	if(val) *val = l->vals[pos];
+	return 1;
+}
+
+/**
+ * Insert pair key-value (or replace value of existing key)
+ * @return 1 if inserted, 0 if replaced, -1 if can't allocate memory (tree isn't changed)
+ */
+int bpt_insert(bptree *t, bpt_key key, bpt_val val){
+	if(!t->root){
+		bpt_leaf *l = leaf_new(t);
+		if(!l) return -1;
+		l->keys[0] = key;
+		l->vals[0] = val;
+		l->n = 1;
+		t->root = t->first = t->last = l;
+		t->height = 1;
+		t->size = 1;
+		return 1;
+	}
+	bpt_inner *path[BPT_MAXHEIGHT];
+	int idx[BPT_MAXHEIGHT], depth = t->height - 1;
+	bpt_leaf *l = find_leaf(t, key, path, idx);
+	int n = l->n, pos = lbound(l->keys, n, key);
+	if(pos < n && !BPT_LESS(key, l->keys[pos])){
+		l->vals[pos] = val;
+		return 0;
+	}
+	if(n < (int)BPT_LEAF_KEYS){
+		memmove(&l->keys[pos+1], &l->keys[pos], (n - pos) * sizeof(bpt_key));
+		memmove(&l->vals[pos+1], &l->vals[pos], (n - pos) * sizeof(bpt_val));
+		l->keys[pos] = key;
+		l->vals[pos] = val;
+		++l->n;
+		++t->size;
+		return 1;
+	}
+	// reserve all nodes split may need (new leaf, full parents & new root)
+	// before changing anything, so failed allocation leaves tree intact
+	int nfull = 0;
+	while(nfull < depth && path[depth - 1 - nfull]->n == (int)BPT_INNER_KEYS) ++nfull;
+	if(nfull == depth && t->height == BPT_MAXHEIGHT) errx(1, "bpt_insert: tree is too high");
+	void *spare[BPT_MAXHEIGHT + 1];
+	int nspare = 1 + nfull + (nfull == depth), used = 0;
+	for(int j = 0; j < nspare; ++j){
+		if((spare[j] = node_alloc(t))) continue;
+		while(j--) node_free(t, spare[j]);
+		return -1;
+	}
+	// split leaf: left keeps `s` of n+1 items; appending to the last leaf keeps it full
+	int append = (l == t->last && pos == n);
+	int s = append ? n : (n + 1) / 2;
+	bpt_leaf *r = leaf_init(spare[used++]);
+	bpt_leaf *ins = l;
+	if(pos < s){ // new item goes to left part
+		r->n = n - s + 1;
+		memcpy(r->keys, &l->keys[s-1], r->n * sizeof(bpt_key));
+		memcpy(r->vals, &l->vals[s-1], r->n * sizeof(bpt_val));
+		l->n = s - 1;
+	}else{
+		r->n = n - s;
+		memcpy(r->keys, &l->keys[s], r->n * sizeof(bpt_key));
+		memcpy(r->vals, &l->vals[s], r->n * sizeof(bpt_val));
+		l->n = s;
+		ins = r;
+		pos -= s;
+	}
+	memmove(&ins->keys[pos+1], &ins->keys[pos], (ins->n - pos) * sizeof(bpt_key));
+	memmove(&ins->vals[pos+1], &ins->vals[pos], (ins->n - pos) * sizeof(bpt_val));
+	ins->keys[pos] = key;
+	ins->vals[pos] = val;
+	++ins->n;
+	r->next = l->next;
+	if(r->next) r->next->prev = r;
+	else t->last = r;
+	r->prev = l;
+	l->next = r;
+	++t->size;
+	// insert separator into parents
+	bpt_key sep = r->keys[0];
+	void *right = r;
+	for(int d = depth - 1; d >= 0; --d){
+		bpt_inner *in = path[d];
+		int i = idx[d], k = in->n;
+		if(k < (int)BPT_INNER_KEYS){
+			memmove(&in->keys[i+1], &in->keys[i], (k - i) * sizeof(bpt_key));
+			memmove(&in->child[i+2], &in->child[i+1], (k - i) * sizeof(void*));
+			in->keys[i] = sep;
+			in->child[i+1] = right;
+			++in->n;
+			return 1;
+		}
+		// split inner node: k+1 keys & k+2 children
+		bpt_key tk[BPT_INNER_KEYS + 1];
+		void *tc[BPT_INNER_KEYS + 2];
+		memcpy(tk, in->keys, i * sizeof(bpt_key));
+		tk[i] = sep;
+		memcpy(&tk[i+1], &in->keys[i], (k - i) * sizeof(bpt_key));
+		memcpy(tc, in->child, (i + 1) * sizeof(void*));
+		tc[i+1] = right;
+		memcpy(&tc[i+2], &in->child[i+1], (k - i) * sizeof(void*));
+		int m = append ? k - 1 : (k + 1) / 2; // left: m keys, tk[m] goes up
+		bpt_inner *rn = inner_init(spare[used++]);
+		in->n = m;
+		memcpy(in->keys, tk, m * sizeof(bpt_key));
+		memcpy(in->child, tc, (m + 1) * sizeof(void*));
+		rn->n = k - m;
+		memcpy(rn->keys, &tk[m+1], rn->n * sizeof(bpt_key));
+		memcpy(rn->child, &tc[m+1], (rn->n + 1) * sizeof(void*));
+		sep = tk[m];
+		right = rn;
+	}
+	// new root
+	bpt_inner *root = inner_init(spare[used]);
+	root->n = 1;
+	root->keys[0] = sep;
+	root->child[0] = t->root;
+	root->child[1] = right;
+	t->root = root;
+	++t->height;
+	return 1;
+}
+
+// remove key[k] & child[k+1] from inner node
+static void inner_delete(bpt_inner *in, int k){
+	memmove(&in->keys[k], &in->keys[k+1], (in->n - k - 1) * sizeof(bpt_key));
+	memmove(&in->child[k+1], &in->child[k+2], (in->n - k - 1) * sizeof(void*));
+	--in->n;
+}
+
+// fix underflow of leaf `l` which is child `i` of `p`; return TRUE if parent lost a key
+static int leaf_fix(bptree *t, bpt_leaf *l, bpt_inner *p, int i){
+	bpt_leaf *L = (i > 0) ? p->child[i-1] : NULL, *R = (i < p->n) ? p->child[i+1] : NULL;
+	if(L && L->n > LEAF_MIN){ // borrow the last item of left sibling
+		memmove(&l->keys[1], l->keys, l->n * sizeof(bpt_key));
+		memmove(&l->vals[1], l->vals, l->n * sizeof(bpt_val));
+		--L->n;
+		l->keys[0] = L->keys[L->n];
+		l->vals[0] = L->vals[L->n];
+		++l->n;
+		p->keys[i-1] = l->keys[0];
+		return 0;
+	}
+	if(R && R->n > LEAF_MIN){ // borrow the first item of right sibling
+		l->keys[l->n] = R->keys[0];
+		l->vals[l->n] = R->vals[0];
+		++l->n;
+		--R->n;
+		memmove(R->keys, &R->keys[1], R->n * sizeof(bpt_key));
+		memmove(R->vals, &R->vals[1], R->n * sizeof(bpt_val));
+		p->keys[i] = R->keys[0];
+		return 0;
+	}
+	if(L){ R = l; --i; } // merge with left sibling
+	else{ L = l; }       // merge right sibling into l
+	memcpy(&L->keys[L->n], R->keys, R->n * sizeof(bpt_key));
+	memcpy(&L->vals[L->n], R->vals, R->n * sizeof(bpt_val));
+	L->n += R->n;
+	L->next = R->next;
+	if(L->next) L->next->prev = L;
+	else t->last = L;
+	node_free(t, R);
+	inner_delete(p, i);
+	return 1;
+}
+
+// fix underflow of inner node `in` which is child `i` of `p`; return TRUE if parent lost a key
+static int inner_fix(bptree *t, bpt_inner *in, bpt_inner *p, int i){
+	bpt_inner *L = (i > 0) ? p->child[i-1] : NULL, *R = (i < p->n) ? p->child[i+1] : NULL;
+	if(L && L->n > INNER_MIN){ // rotate right
+		memmove(&in->keys[1], in->keys, in->n * sizeof(bpt_key));
+		memmove(&in->child[1], in->child, (in->n + 1) * sizeof(void*));
+		in->keys[0] = p->keys[i-1];
+		in->child[0] = L->child[L->n];
+		p->keys[i-1] = L->keys[L->n - 1];
+		--L->n;
+		++in->n;
+		return 0;
+	}
+	if(R && R->n > INNER_MIN){ // rotate left
+		in->keys[in->n] = p->keys[i];
+		in->child[in->n + 1] = R->child[0];
+		++in->n;
+		p->keys[i] = R->keys[0];
+		memmove(R->keys, &R->keys[1], (R->n - 1) * sizeof(bpt_key));
+		memmove(R->child, &R->child[1], R->n * sizeof(void*));
+		--R->n;
+		return 0;
+	}
+	if(L){ R = in; --i; }
+	else{ L = in; }
+	L->keys[L->n] = p->keys[i];
+	memcpy(&L->keys[L->n + 1], R->keys, R->n * sizeof(bpt_key));
+	memcpy(&L->child[L->n + 1], R->child, (R->n + 1) * sizeof(void*));
+	L->n += R->n + 1;
+	node_free(t, R);
+	inner_delete(p, i);
+	return 1;
+}
+
+/**
+ * Remove key
+ * @param val - (if !NULL) its value
+ * @return 1 if removed, 0 if there's no such key
+ */
+int bpt_remove(bptree *t, bpt_key key, bpt_val *val){
+	bpt_inner *path[BPT_MAXHEIGHT];
+	int idx[BPT_MAXHEIGHT], depth = t->height - 1;
+	bpt_leaf *l = find_leaf(t, key, path, idx);
+	if(!l) return 0;
+	int pos = lbound(l->keys, l->n, key);
+	if(pos == l->n || BPT_LESS(key, l->keys[pos])) return 0;
+	if(val) *val = l->vals[pos];
+	--l->n;
+	memmove(&l->keys[pos], &l->keys[pos+1], (l->n - pos) * sizeof(bpt_key));
+	memmove(&l->vals[pos], &l->vals[pos+1], (l->n - pos) * sizeof(bpt_val));
+	--t->size;
+	if(depth == 0){ // root is leaf
+		if(!l->n){
+			node_free(t, l);
+			t->root = t->first = t->last = NULL;
+			t->height = 0;
+		}
+		return 1;
+	}
+	if(l->n >= LEAF_MIN || !leaf_fix(t, l, path[depth-1], idx[depth-1])) return 1;
+	for(int d = depth - 1; d > 0; --d){
+		if(path[d]->n >= INNER_MIN || !inner_fix(t, path[d], path[d-1], idx[d-1])) return 1;
+	}
+	bpt_inner *root = path[0];
+	if(!root->n){ // root have only one child
+		t->root = root->child[0];
+		node_free(t, root);
+		--t->height;
+	}
+	return 1;
+}
+
+/**
+ * Build tree from sorted data (tree should be empty)
+ * @param keys - strictly increasing keys
+ * @param vals - values (or NULL to fill them by zeros)
+ * @param n - amount of data
+ * @return 0 if all OK, -1 if tree isn't empty, keys aren't sorted or no memory
+ */
+int bpt_bulkload(bptree *t, const bpt_key *keys, const bpt_val *vals, size_t n){
+	if(t->root || !keys) return -1;
+	if(!n) return 0;
+	for(size_t i = 1; i < n; ++i) if(!BPT_LESS(keys[i-1], keys[i])) return -1;
+	// data is spread evenly, so all nodes have not less than minimal amount of keys
+	size_t cnt = (n + BPT_LEAF_KEYS - 1) / BPT_LEAF_KEYS, k = 0;
+	void **level = malloc(cnt * sizeof(void*));
+	bpt_key *low = malloc(cnt * sizeof(bpt_key)); // min keys of subtrees
+	if(!level || !low) goto fail;
+	bpt_leaf *prev = NULL;
+	for(size_t j = 0; j < cnt; ++j){
+		bpt_leaf *l = leaf_new(t);
+		if(!l) goto fail;
+		l->n = n / cnt + (j < n % cnt);
+		memcpy(l->keys, &keys[k], l->n * sizeof(bpt_key));
+		if(vals) memcpy(l->vals, &vals[k], l->n * sizeof(bpt_val));
+		else memset(l->vals, 0, l->n * sizeof(bpt_val));
+		l->prev = prev;
+		if(prev) prev->next = l;
+		else t->first = l;
+		prev = l;
+		level[j] = l;
+		low[j] = keys[k];
+		k += l->n;
+	}
+	t->last = prev;
+	int h = 1;
+	while(cnt > 1){
+		size_t nn = (cnt + BPT_INNER_KEYS) / (BPT_INNER_KEYS + 1), c = 0;
+		for(size_t j = 0; j < nn; ++j){
+			size_t nc = cnt / nn + (j < cnt % nn);
+			bpt_inner *in = inner_new(t);
+			if(!in) goto fail;
+			in->n = nc - 1;
+			for(size_t q = 0; q < nc; ++q){
+				in->child[q] = level[c+q];
+				if(q) in->keys[q-1] = low[c+q];
+			}
+			level[j] = in;
+			low[j] = low[c];
+			c += nc;
+		}
+		cnt = nn;
+		++h;
+	}
+	t->root = level[0];
+	t->height = h;
+	t->size = n;
+	free(level);
+	free(low);
+	return 0;
+fail:
+	pool_clear(t);
+	free(level);
+	free(low);
+	return -1;
+}
+
+// iterator to the first key
+void bpt_first(const bptree *t, bpt_iter *it){
+	it->leaf = t->first;
+	it->pos = 0;
+}
+
+// iterator to the first key >= `key`
+void bpt_seek(const bptree *t, bpt_key key, bpt_iter *it){
+	it->leaf = find_leaf(t, key, NULL, NULL);
+	it->pos = it->leaf ? lbound(it->leaf->keys, it->leaf->n, key) : 0;
+}
+
+/**
+ * Get next pair of iterator
+ * @param key, val - (if !NULL) pair
+ * @return 0 if there's no more data
+ */
+int bpt_next(bpt_iter *it, bpt_key *key, bpt_val *val){
+	while(it->leaf && it->pos >= it->leaf->n){
+		it->leaf = it->leaf->next;
+		it->pos = 0;
+	}
+	if(!it->leaf) return 0;
+	if(key) *key = it->leaf->keys[it->pos];
+	if(val) *val = it->leaf->vals[it->pos];
+	++it->pos;
+	return 1;
+}
+
+/**
+ * Run `cb` for all pairs with lo <= key < hi in order of keys (while it returns 0)
+ * @return amount of pairs processed
+ */
+size_t bpt_range(const bptree *t, bpt_key lo, bpt_key hi, int (*cb)(bpt_key key, bpt_val val, void *arg), void *arg){
+	bpt_iter it;
+	bpt_key k;
+	bpt_val v;
+	size_t N = 0;
+	bpt_seek(t, lo, &it);
+	while(bpt_next(&it, &k, &v) && BPT_LESS(k, hi)){
+		++N;
+		if(cb && cb(k, v, arg)) break;
+	}
+	return N;
+}
+
+#ifdef STANDALONE
+#include <time.h>
+
+static double dtime(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// check structure of subtree, return its amount of keys
+static size_t check_node(const void *node, int h, const bpt_key *lo, const bpt_key *hi, int isroot){
+	const bpt_leaf *l = node;
+	if(h == 1){
+		if(!l->leaf) errx(1, "inner node on leaf level");
+		if(!l->n && !isroot) errx(1, "empty leaf");
+		for(int i = 0; i < l->n; ++i){
+			if(i && !BPT_LESS(l->keys[i-1], l->keys[i])) errx(1, "unsorted leaf");
+			if((lo && BPT_LESS(l->keys[i], *lo)) || (hi && !BPT_LESS(l->keys[i], *hi))) errx(1, "key out of range");
+		}
+		return l->n;
+	}
+	const bpt_inner *in = node;
+	if(in->leaf || !in->n) errx(1, "bad inner node");
+	size_t N = 0;
+	for(int i = 0; i <= in->n; ++i)
+		N += check_node(in->child[i], h - 1, i ? &in->keys[i-1] : lo, (i < in->n) ? &in->keys[i] : hi, 0);
+	return N;
+}
+
+static void check_tree(const bptree *t){
+	if(!t->root){
+		if(t->size) errx(1, "empty tree with size %zd", t->size);
+		return;
+	}
+	size_t N = check_node(t->root, t->height, NULL, NULL, 1), L = 0;
+	if(N != t->size) errx(1, "size %zd instead of %zd", N, t->size);
+	for(bpt_leaf *l = t->first; l; l = l->next){
+		if(l->next && l->next->prev != l) errx(1, "bad list of leaves");
+		if(!l->next && l != t->last) errx(1, "bad last leaf");
+		L += l->n;
+	}
+	if(L != N) errx(1, "list of leaves have %zd keys instead of %zd", L, N);
+}
+
+static int cmpkeys(const void *a, const void *b){
+	bpt_key x = *(const bpt_key*)a, y = *(const bpt_key*)b;
+	return BPT_LESS(x, y) ? -1 : BPT_LESS(y, x);
+}
+
+#define VAL(k) ((bpt_val)(intptr_t)((k) * 3))
+
+static void stat(const char *name, bptree *t, double dt, size_t nops){
+	double fill = (double)t->size / (t->nnodes * (double)BPT_LEAF_KEYS);
+	printf("%-24s %7.1f ns/op; keys: %zd, height: %d, nodes: %zd (%.1f MB), fill: %.2f\n", name, dt * 1e9 / nops,
+		t->size, t->height, t->nnodes, t->nnodes * (double)BPT_NODESZ / 1048576., fill);
+}
+
+int main(int argc, char **argv){
+	size_t N = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000, i;
+	if(N < 10) errx(1, "Usage: %s [amount of keys]", argv[0]);
+	printf("Node: %d bytes, %zd keys in inner nodes, %zd in leaves\n", BPT_NODESZ, BPT_INNER_KEYS, BPT_LEAF_KEYS);
+	bpt_key *keys = malloc(N * sizeof(bpt_key)), *ref = malloc(N * sizeof(bpt_key));
+	// monotonic keys (timestamps)
+	bptree *t = bpt_new();
+	double t0 = dtime();
+	for(i = 0; i < N; ++i) if(bpt_insert(t, (bpt_key)(i * 10), VAL(i * 10)) != 1) errx(1, "insert");
+	stat("monotonic insert", t, dtime() - t0, N);
+	check_tree(t);
+	t0 = dtime();
+	for(i = 0; i < N; ++i){
+		bpt_val v;
+		bpt_key k = (bpt_key)((lrand48() % N) * 10);
+		if(!bpt_get(t, k, &v) || v != VAL(k)) errx(1, "get");
+	}
+	stat("random get", t, dtime() - t0, N);
+	bpt_free(&t);
+	// random keys with repeats: compare with sorted array
+	t = bpt_new();
+	srand48(1);
+	for(i = 0; i < N; ++i) keys[i] = lrand48() % (N * 4);
+	t0 = dtime();
+	for(i = 0; i < N; ++i) if(bpt_insert(t, keys[i], VAL(keys[i])) < 0) errx(1, "insert");
+	stat("random insert", t, dtime() - t0, N);
+	check_tree(t);
+	memcpy(ref, keys, N * sizeof(bpt_key));
+	qsort(ref, N, sizeof(bpt_key), cmpkeys);
+	size_t nref = 1;
+	for(i = 1; i < N; ++i) if(ref[i] != ref[nref-1]) ref[nref++] = ref[i];
+	if(nref != t->size) errx(1, "size %zd instead of %zd", t->size, nref);
+	bpt_iter it;
+	bpt_key k;
+	bpt_val v;
+	bpt_first(t, &it);
+	for(i = 0; bpt_next(&it, &k, &v); ++i) if(i >= nref || k != ref[i] || v != VAL(k)) errx(1, "iteration");
+	if(i != nref) errx(1, "iteration: %zd keys instead of %zd", i, nref);
+	// range scans
+	t0 = dtime();
+	size_t nscans = 10000, total = 0;
+	for(i = 0; i < nscans; ++i){
+		bpt_key lo = lrand48() % (N * 4), hi = lo + lrand48() % 1000;
+		size_t n = bpt_range(t, lo, hi, NULL, NULL);
+		size_t a = lbound(ref, nref, lo), b = lbound(ref, nref, hi);
+		if(n != b - a) errx(1, "range [%ld, %ld): %zd instead of %zd", (long)lo, (long)hi, n, b - a);
+		total += n;
+	}
+	printf("%-24s %7.1f ns/key (%zd scans, %zd keys)\n", "range scan", (dtime() - t0) * 1e9 / total, nscans, total);
+	// remove a half
+	t0 = dtime();
+	for(i = 0; i < N; i += 2) bpt_remove(t, keys[i], NULL);
+	stat("random remove", t, dtime() - t0, N / 2);
+	check_tree(t);
+	for(i = 0; i < N; ++i){
+		int in = bpt_get(t, keys[i], NULL);
+		size_t p = lbound(ref, nref, keys[i]);
+		if(p >= nref || ref[p] != keys[i]) errx(1, "lost key");
+		int must = 1;
+		for(size_t j = 0; j < N; j += 2) if(keys[j] == keys[i]){ must = 0; break; }
+		if(in != must) errx(1, "key %ld: found=%d", (long)keys[i], in);
+		if(i > 2000) break; // O(N^2) check: only for part of keys
+	}
+	for(i = 0; i < N; ++i) bpt_remove(t, keys[i], NULL);
+	if(t->size || t->root || t->nnodes) errx(1, "tree isn't empty after removing all keys");
+	// bulk load
+	t0 = dtime();
+	if(bpt_bulkload(t, ref, NULL, nref)) errx(1, "bulkload");
+	stat("bulk load", t, dtime() - t0, nref);
+	check_tree(t);
+	t0 = dtime();
+	for(i = 0; i < N; ++i) bpt_get(t, keys[i], NULL);
+	stat("random get", t, dtime() - t0, N);
+	bpt_free(&t);
+	free(keys);
+	free(ref);
+	printf("All OK\n");
+	return 0;
+}
+#endif
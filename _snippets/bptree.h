@@ -0,0 +1,102 @@
+/*
+ * bptree.h - B+-tree: ordered index with wide nodes & pool allocation
+ *
+ * Copyright 2025 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#pragma once
+#ifndef __BPTREE_H__
+#define __BPTREE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// customize for your data: key & value types (-DBPT_KEY_T=double etc), keys comparison
+#ifndef BPT_KEY_T
+#define BPT_KEY_T int64_t
+#endif
+#ifndef BPT_VAL_T
+#define BPT_VAL_T void*
+#endif
+#ifndef BPT_LESS
+#define BPT_LESS(a,b) ((a)<(b))
+#endif
+typedef BPT_KEY_T bpt_key;
+typedef BPT_VAL_T bpt_val;
+
+// size of node (multiple of cache line size)
+#ifndef BPT_NODESZ
+#define BPT_NODESZ      (256)
+#endif
+// amount of nodes in one chunk of pool
+#define BPT_POOLNODES   (1024)
+// max height of tree
+#define BPT_MAXHEIGHT   (32)
+
+// capacities of inner nodes & leaves
+#define BPT_INNER_KEYS  ((BPT_NODESZ - 2*sizeof(uint16_t) - sizeof(void*)) / (sizeof(bpt_key) + sizeof(void*)))
+#define BPT_LEAF_KEYS   ((BPT_NODESZ - 2*sizeof(uint16_t) - 2*sizeof(void*)) / (sizeof(bpt_key) + sizeof(bpt_val)))
+
+typedef struct{
+	uint16_t leaf;                      // == 0
+	uint16_t n;                         // amount of keys
+	bpt_key keys[BPT_INNER_KEYS];       // keys[i] - min key of child[i+1]
+	void *child[BPT_INNER_KEYS + 1];
+} bpt_inner;
+
+typedef struct bpt_leaf{
+	uint16_t leaf;                      // == 1
+	uint16_t n;                         // amount of keys
+	bpt_key keys[BPT_LEAF_KEYS];
+	bpt_val vals[BPT_LEAF_KEYS];
+	struct bpt_leaf *prev, *next;       // neighbours (for ordered iteration)
+} bpt_leaf;
+
+typedef struct{
+	void *root;                         // root node (NULL for empty tree)
+	int height;                         // 0 - empty, 1 - root is leaf
+	size_t size;                        // amount of keys
+	bpt_leaf *first, *last;             // the first & last leaves
+	// pool of nodes
+	void *freelist;                     // list of free nodes
+	char *chunk;                        // current chunk
+	size_t chunkused;                   // amount of nodes used in it
+	char **chunks;                      // all chunks
+	size_t nchunks, chunksalloc;
+	size_t nnodes;                      // amount of nodes in tree
+} bptree;
+
+// iterator for ordered scans
+typedef struct{
+	bpt_leaf *leaf;
+	int pos;
+} bpt_iter;
+
+bptree *bpt_new();
+void bpt_free(bptree **t);
+int bpt_insert(bptree *t, bpt_key key, bpt_val val);
+int bpt_get(const bptree *t, bpt_key key, bpt_val *val);
+int bpt_remove(bptree *t, bpt_key key, bpt_val *val);
+int bpt_bulkload(bptree *t, const bpt_key *keys, const bpt_val *vals, size_t n);
+
+void bpt_first(const bptree *t, bpt_iter *it);
+void bpt_seek(const bptree *t, bpt_key key, bpt_iter *it);
+int bpt_next(bpt_iter *it, bpt_key *key, bpt_val *val);
+size_t bpt_range(const bptree *t, bpt_key lo, bpt_key hi, int (*cb)(bpt_key key, bpt_val val, void *arg), void *arg);
+
+#endif // __BPTREE_H__
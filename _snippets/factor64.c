@@ -0,0 +1,453 @@
+/*
+ * factor64.c - factorization of 64-bit numbers: Miller-Rabin & Pollard-Brent rho
+ *
+ * Copyright 2025 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+/*
+ * 1. Trial division by primes < FACT_TDLIM (table made by sieve.c): divisibility is checked
+ *    by multiplication to inverse of p modulo 2^64 (n*inv <= UINT64_MAX/p) without division.
+ * 2. The rest is checked by deterministic Miller-Rabin test (7 bases are enough for 64 bits).
+ * 3. Composites are split by Pollard rho with Brent's cycle detection & batched gcd.
+ * All arithmetics modulo n is in Montgomery form (no 128-bit divisions in loops).
+ * compile test: gcc -O3 -march=native -fopenmp -c sieve.c && gcc -O3 -march=native -fopenmp -DSTANDALONE factor64.c sieve.o -o factor64 -lm
+ */
+
+#include <err.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "factor64.h"
+#include "sieve.h"
+
+typedef unsigned __int128 u128;
+
+/*--- Montgomery arithmetics modulo odd n, R = 2^64 ---*/
+
+typedef struct{
+	uint64_t n;     // modulo
+	uint64_t inv;   // n^-1 mod 2^64
+	uint64_t one;   // R mod n
+	uint64_t r2;    // R^2 mod n
+} mont_t;
+
+// inverse of odd x modulo 2^64 (Newton's iterations)
+static inline uint64_t inverse64(uint64_t x){
+	uint64_t y = (3 * x) ^ 2; // 5 correct bits
+	for(int i = 0; i < 4; ++i) y *= 2 - x * y;
+	return y;
+}
+
+static inline void mont_init(mont_t *m, uint64_t n){
+	m->n = n;
+	m->inv = inverse64(n);
+	m->one = (-n) % n;
+	m->r2 = (uint64_t)(((u128)m->one * m->one) % n);
+}
+
+// T*R^-1 mod n for T < n*2^64
+static inline uint64_t mont_redc(const mont_t *m, u128 T){
+	uint64_t hi = (uint64_t)(T >> 64), q = (uint64_t)T * m->inv;
+	uint64_t h = (uint64_t)(((u128)q * m->n) >> 64);
+	return (hi < h) ? hi - h + m->n : hi - h;
+}
+
+static inline uint64_t mont_mul(const mont_t *m, uint64_t a, uint64_t b){
+	return mont_redc(m, (u128)a * b);
+}
+
+static inline uint64_t mont_to(const mont_t *m, uint64_t a){
+	return mont_mul(m, a % m->n, m->r2);
+}
+
+static inline uint64_t mont_add(const mont_t *m, uint64_t a, uint64_t b){
+	uint64_t s = a + b;
+	return (s < a || s >= m->n) ? s - m->n : s;
+}
+
+static inline uint64_t mont_pow(const mont_t *m, uint64_t a, uint64_t e){
+	uint64_t r = m->one;
+	for(; e; e >>= 1){
+		if(e & 1) r = mont_mul(m, r, a);
+		a = mont_mul(m, a, a);
+	}
+	return r;
+}
+
+static inline uint64_t gcd64(uint64_t a, uint64_t b){
+	if(!a) return b;
+	if(!b) return a;
+	int k = __builtin_ctzll(a | b);
+	a >>= __builtin_ctzll(a);
+	do{
+		b >>= __builtin_ctzll(b);
+		if(a > b){ uint64_t t = a; a = b; b = t; }
+		b -= a;
+	}while(b);
+	return a << k;
+}
+
+/*--- Table of small primes ---*/
+
+typedef struct{
+	uint64_t inv;   // p^-1 mod 2^64
+	uint64_t lim;   // UINT64_MAX / p
+	uint64_t p;
+} tdprime;
+
+static tdprime *tdtab = NULL;
+static int ntd = 0;
+static pthread_once_t tdonce = PTHREAD_ONCE_INIT;
+
+static void tdinit(){
+	sieve_iter it;
+	if(sieve_iter_init(&it, 3, FACT_TDLIM)) errx(1, "sieve_iter_init");
+	tdtab = malloc(FACT_TDLIM / 2 * sizeof(tdprime));
+	if(!tdtab) err(1, "malloc");
+	uint64_t p;
+	while((p = sieve_next(&it))){
+		tdtab[ntd].p = p;
+		tdtab[ntd].inv = inverse64(p);
+		tdtab[ntd].lim = UINT64_MAX / p;
+		++ntd;
+	}
+	sieve_iter_free(&it);
+}
+
+/*--- Primality test ---*/
+
+// Miller-Rabin test of odd n > 3 by base a
+static int mr_pass(const mont_t *m, uint64_t a, uint64_t d, int s){
+	a = mont_to(m, a);
+	if(!a) return 1;
+	uint64_t x = mont_pow(m, a, d), minus1 = m->n - m->one;
+	if(x == m->one || x == minus1) return 1;
+	while(--s > 0){
+		x = mont_mul(m, x, x);
+		if(x == minus1) return 1;
+	}
+	return 0;
+}
+
+// deterministic test of odd n > 3 not divisible by 3, 5, 7
+static int isprime_odd(uint64_t n){
+	static const uint64_t bases[7] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+	mont_t m;
+	mont_init(&m, n);
+	uint64_t d = n - 1;
+	int s = __builtin_ctzll(d);
+	d >>= s;
+	for(int i = 0; i < 7; ++i) if(!mr_pass(&m, bases[i], d, s)) return 0;
+	return 1;
+}
+
+/**
+ * Check primality of n
+ * @return 1 if n is prime
+ */
+int isprime64(uint64_t n){
+	if(n < 64) return (0x28208a20a08a28acULL >> n) & 1; // bits of primes < 64
+	if(!(n & 1) || n % 3 == 0 || n % 5 == 0 || n % 7 == 0) return 0;
+	if(n < 121) return 1;
+	return isprime_odd(n);
+}
+
+/*--- Pollard-Brent rho ---*/
+
+#define RHO_M   (128)
+
+// find non-trivial divisor of odd composite n
+static uint64_t rho(uint64_t n){
+	mont_t m;
+	mont_init(&m, n);
+	for(uint64_t c0 = 1; ; ++c0){
+		uint64_t c = mont_to(&m, c0), y = mont_to(&m, c0 + 1), x = y, ys = y, q = m.one, g = 1;
+#define F(v)    mont_add(&m, mont_mul(&m, v, v), c)
+		for(uint64_t r = 1; g == 1; r <<= 1){
+			x = y;
+			for(uint64_t i = 0; i < r; ++i) y = F(y);
+			for(uint64_t k = 0; k < r && g == 1; k += RHO_M){
+				ys = y;
+				uint64_t lim = (r - k < RHO_M) ? r - k : RHO_M;
+				for(uint64_t i = 0; i < lim; ++i){
+					y = F(y);
+					q = mont_mul(&m, q, (x > y) ? x - y : y - x);
+				}
+				g = gcd64(q, n);
+			}
+		}
+		if(g == n){ // product became zero: repeat the last batch step by step
+			do{
+				ys = F(ys);
+				g = gcd64((x > ys) ? x - ys : ys - x, n);
+			}while(g == 1);
+		}
+#undef F
+		if(g != n) return g;
+	}
+}
+
+// factorize n (which have no factors < FACT_TDLIM) recursively
+static int split(uint64_t n, uint64_t *f, int N){
+	if(n < (uint64_t)FACT_TDLIM * FACT_TDLIM || isprime_odd(n)){
+		f[N++] = n;
+		return N;
+	}
+	uint64_t d = rho(n);
+	N = split(d, f, N);
+	return split(n / d, f, N);
+}
+
+/**
+ * Factorize number
+ * @param n - number
+ * @param f - (o) its prime factors in ascending order (with repeats)
+ * @return amount of factors (0 for n < 2)
+ */
+int factor64(uint64_t n, uint64_t f[FACT_MAX]){
+	pthread_once(&tdonce, tdinit);
+	int N = 0;
+	if(n < 2) return 0;
+	int z = __builtin_ctzll(n);
+	n >>= z;
+	while(N < z) f[N++] = 2;
+	for(int i = 0; i < ntd && n > 1; ++i){
+		const tdprime *t = &tdtab[i];
+		if(t->p * t->p > n){ // n is prime
+			f[N++] = n;
+			return N;
+		}
+		while(n * t->inv <= t->lim){ // exact division by multiplication
+			n *= t->inv;
+			f[N++] = t->p;
+		}
+	}
+	if(n == 1) return N;
+	int N0 = N;
+	N = split(n, f, N);
+	// sort factors found by rho
+	for(int i = N0 + 1; i < N; ++i){
+		uint64_t v = f[i];
+		int j = i;
+		for(; j > N0 && f[j-1] > v; --j) f[j] = f[j-1];
+		f[j] = v;
+	}
+	return N;
+}
+
+/*--- Batch factorization ---*/
+
+// amount of numbers in one task of batch
+#define FACT_CHUNK  (4096)
+
+/**
+ * Factorize array of numbers
+ * @param n - numbers
+ * @param N - their amount
+ * @param res - (o) results (free them by factor64_batch_free)
+ * @param nthreads - amount of threads (< 1 - by OpenMP settings)
+ * @return 0 if all OK
+ */
+int factor64_batch(const uint64_t *n, size_t N, fact_batch *res, int nthreads){
+	if(!res || (!n && N)) return -1;
+	pthread_once(&tdonce, tdinit);
+	size_t nch = (N + FACT_CHUNK - 1) / FACT_CHUNK;
+	res->N = N;
+	res->factors = NULL;
+	res->offsets = calloc(N + 1, sizeof(size_t));
+	uint64_t **cbuf = calloc(nch + 1, sizeof(uint64_t*));
+	size_t *csize = calloc(nch + 1, sizeof(size_t));
+	if(!res->offsets || !cbuf || !csize) err(1, "calloc");
+	// 1. factorize chunks to their own buffers; offsets[i+1] = amount of factors of n[i]
+#ifdef _OPENMP
+	if(nthreads < 1) nthreads = omp_get_max_threads();
+	#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+#endif
+	for(size_t c = 0; c < nch; ++c){
+		size_t i0 = c * FACT_CHUNK, i1 = (i0 + FACT_CHUNK < N) ? i0 + FACT_CHUNK : N;
+		size_t sz = 0, alloc = (i1 - i0) * 4;
+		uint64_t *buf = malloc(alloc * sizeof(uint64_t)), f[FACT_MAX];
+		if(!buf) err(1, "malloc");
+		for(size_t i = i0; i < i1; ++i){
+			int k = factor64(n[i], f);
+			if(sz + k > alloc){
+				alloc *= 2;
+				buf = realloc(buf, alloc * sizeof(uint64_t));
+				if(!buf) err(1, "realloc");
+			}
+			memcpy(buf + sz, f, k * sizeof(uint64_t));
+			sz += k;
+			res->offsets[i+1] = k;
+		}
+		cbuf[c] = buf;
+		csize[c] = sz;
+	}
+	(void)nthreads;
+	// 2. offsets & flat array
+	for(size_t i = 0; i < N; ++i) res->offsets[i+1] += res->offsets[i];
+	res->factors = malloc((res->offsets[N] + 1) * sizeof(uint64_t));
+	if(!res->factors) err(1, "malloc");
+#ifdef _OPENMP
+	#pragma omp parallel for num_threads(nthreads)
+#endif
+	for(size_t c = 0; c < nch; ++c){
+		memcpy(res->factors + res->offsets[c * FACT_CHUNK], cbuf[c], csize[c] * sizeof(uint64_t));
+		free(cbuf[c]);
+	}
+	free(cbuf);
+	free(csize);
+	return 0;
+}
+
+void factor64_batch_free(fact_batch *res){
+	if(!res) return;
+	free(res->offsets);
+	free(res->factors);
+	memset(res, 0, sizeof(fact_batch));
+}
+
+#ifdef STANDALONE
+#include <stdio.h>
+#include <time.h>
+
+static double dtime(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static uint64_t rnd_state = 0x9E3779B97F4A7C15ULL;
+static uint64_t rnd(){ // splitmix64
+	uint64_t z = (rnd_state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// random prime of given bits amount
+static uint64_t rndprime(int bits){
+	uint64_t p;
+	do p = (rnd() >> (64 - bits)) | (1ULL << (bits - 1)) | 1; while(!isprime64(p));
+	return p;
+}
+
+// old way: trial division by 6k+-1
+static uint64_t tdfactor(uint64_t n){
+	if(n % 2 == 0) return 2;
+	if(n % 3 == 0) return 3;
+	for(uint64_t d = 5; d <= n / d; d += 6){
+		if(n % d == 0) return d;
+		if(n % (d + 2) == 0) return d + 2;
+	}
+	return n;
+}
+
+// check factors: product & primality
+static void check(uint64_t n, const uint64_t *f, int N){
+	uint64_t p = 1;
+	for(int i = 0; i < N; ++i){
+		if(!isprime64(f[i])) errx(1, "%lu: factor %lu isn't prime", n, f[i]);
+		if(i && f[i] < f[i-1]) errx(1, "%lu: unsorted factors", n);
+		p *= f[i];
+	}
+	if(n > 1 && p != n) errx(1, "%lu: product of factors is %lu", n, p);
+	if(n < 2 && N) errx(1, "%lu: have factors", n);
+}
+
+int main(int argc, char **argv){
+	uint64_t f[FACT_MAX];
+	if(argc == 2){
+		uint64_t n = strtoull(argv[1], NULL, 0);
+		int N = factor64(n, f);
+		printf("%lu:", n);
+		for(int i = 0; i < N; ++i) printf(" %lu", f[i]);
+		printf("\n");
+		return 0;
+	}
+	// primality: compare with sieve
+	sieve_iter it;
+	sieve_iter_init(&it, 0, 10000000);
+	uint64_t p = sieve_next(&it);
+	for(uint64_t n = 0; n < 10000000; ++n){
+		int isp = (n == p);
+		if(isp) p = sieve_next(&it);
+		if(isprime64(n) != isp) errx(1, "isprime64(%lu)", n);
+	}
+	sieve_iter_free(&it);
+	if(!isprime64(UINT64_MAX - 58) || isprime64(UINT64_MAX) || isprime64(3215031751ULL)) errx(1, "isprime64");
+	// small numbers vs trial division
+	for(uint64_t n = 0; n < 1000000; ++n){
+		int N = factor64(n, f);
+		check(n, f, N);
+		if(n > 1 && f[0] != tdfactor(n)) errx(1, "%lu: smallest factor", n);
+	}
+	// random numbers, powers, products of primes of different size
+	for(int i = 0; i < 100000; ++i){
+		uint64_t n = rnd() >> (rnd() % 64);
+		check(n, f, factor64(n, f));
+	}
+	for(uint64_t b = 2; b < 100; ++b) for(uint64_t n = b; n <= UINT64_MAX / b; n *= b) check(n, f, factor64(n, f));
+	for(int i = 0; i < 1000; ++i){
+		uint64_t a = rndprime(16 + i % 16), b = rndprime(16 + i % 16), n = a * b;
+		int N = factor64(n, f);
+		check(n, f, N);
+		if(N != 2) errx(1, "%lu = %lu * %lu: %d factors", n, a, b, N);
+	}
+	uint64_t sq = rndprime(32), nsq = sq * sq;
+	if(factor64(nsq, f) != 2 || f[0] != sq) errx(1, "%lu^2", sq);
+	printf("Tests passed\n\n");
+	// speed: 60-bit semiprimes
+	enum{NSEMI = 10000};
+	uint64_t *semi = malloc(NSEMI * sizeof(uint64_t));
+	for(int i = 0; i < NSEMI; ++i) semi[i] = rndprime(30) * rndprime(30);
+	double t0 = dtime();
+	for(int i = 0; i < NSEMI; ++i) factor64(semi[i], f);
+	printf("60-bit semiprimes: %.1f us per number\n", (dtime() - t0) * 1e6 / NSEMI);
+	t0 = dtime();
+	uint64_t d = tdfactor(semi[0]);
+	printf("Trial division of %lu = %lu * %lu: %.2f s\n", semi[0], d, semi[0] / d, dtime() - t0);
+	free(semi);
+	// batch of random numbers
+	size_t NB = 200000;
+	uint64_t *nums = malloc(NB * sizeof(uint64_t));
+	for(size_t i = 0; i < NB; ++i) nums[i] = rnd();
+	int maxthreads = 1;
+#ifdef _OPENMP
+	maxthreads = omp_get_max_threads();
+#endif
+	double t1 = 0.;
+	for(int nt = 1; nt <= maxthreads; nt *= 2){
+		fact_batch res;
+		t0 = dtime();
+		factor64_batch(nums, NB, &res, nt);
+		double t = dtime() - t0;
+		if(nt == 1) t1 = t;
+		for(size_t i = 0; i < NB; ++i)
+			check(nums[i], res.factors + res.offsets[i], (int)(res.offsets[i+1] - res.offsets[i]));
+		printf("Batch of %zd random 64-bit numbers (%zd factors), %d thread[s]: %.2f s (%.1f us per number, speedup %.2f)\n",
+			NB, res.offsets[NB], nt, t, t * 1e6 / NB, t1 / t);
+		factor64_batch_free(&res);
+	}
+	free(nums);
+	return 0;
+}
+#endif
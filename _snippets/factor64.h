@@ -0,0 +1,49 @@
+/*
+ * factor64.h - factorization of 64-bit numbers: Miller-Rabin & Pollard-Brent rho
+ *
+ * Copyright 2025 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#pragma once
+#ifndef __FACTOR64_H__
+#define __FACTOR64_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// max amount of prime factors (with repeats) of 64-bit number
+#define FACT_MAX        (64)
+// trial division by primes less than this value
+#ifndef FACT_TDLIM
+#define FACT_TDLIM      (2048)
+#endif
+
+// results of batch factorization: factors of n[i] are
+// factors[offsets[i]] .. factors[offsets[i+1]-1] in ascending order
+typedef struct{
+	size_t N;               // amount of numbers
+	size_t *offsets;        // N+1 offsets
+	uint64_t *factors;      // all factors
+} fact_batch;
+
+int isprime64(uint64_t n);
+int factor64(uint64_t n, uint64_t f[FACT_MAX]);
+int factor64_batch(const uint64_t *n, size_t N, fact_batch *res, int nthreads);
+void factor64_batch_free(fact_batch *res);
+
+#endif // __FACTOR64_H__
@@ -1,25 +1,16 @@
 //Copyright (c) 2011 ashelly.myopenid.com under <http://www.opensource.org/licenses/mit-license>
+// 2-D median filter engine: Edward V. Emelianov <edward.emelianoff@gmail.com>
+// compile demo & test: gcc -O3 -march=native -fopenmp -DSTANDALONE med.c -o med
+#include <err.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <sys/time.h>
 #include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
-#define OMP_NUM_THREADS 4
-#define Stringify(x) #x
-#define OMP_FOR(x) _Pragma(Stringify(omp parallel for x))
-
-//Customize for your data Item type
-typedef int Item;
-#define ItemLess(a,b) ((a)<(b))
-#define ItemMean(a,b) (((a)+(b))/2)
-
-typedef struct Mediator_t{
-	Item* data; // circular queue of values
-	int* pos;   // index into `heap` for each value
-	int* heap;  // max/median/min heap holding indexes into `data`.
-	int N;      // allocated size.
-	int idx;    // position in circular queue
-	int ct;     // count of items in queue
-} Mediator;
+#include "med.h"
 
 /*--- Helper Functions ---*/
 
@@ -27,12 +18,12 @@ typedef struct Mediator_t{
 #define maxCt(m) (((m)->ct)/2) //count of items in maxheap
 
 //returns 1 if heap[i] < heap[j]
-inline int mmless(Mediator* m, int i, int j){
+static inline int mmless(Mediator* m, int i, int j){
 	return ItemLess(m->data[m->heap[i]],m->data[m->heap[j]]);
 }
 
 //swaps items i&j in heap, maintains indexes
-inline int mmexchange(Mediator* m, int i, int j){
+static inline int mmexchange(Mediator* m, int i, int j){
 	int t = m->heap[i];
 	m->heap[i] = m->heap[j];
 	m->heap[j] = t;
@@ -42,12 +33,12 @@ inline int mmexchange(Mediator* m, int i, int j){
 }
 
 //swaps items i&j if i<j; returns true if swapped
-inline int mmCmpExch(Mediator* m, int i, int j){
+static inline int mmCmpExch(Mediator* m, int i, int j){
 	return (mmless(m,i,j) && mmexchange(m,i,j));
 }
 
 //maintains minheap property for all items below i/2.
-void minSortDown(Mediator* m, int i){
+static void minSortDown(Mediator* m, int i){
 	for(; i <= minCt(m); i*=2){
 		if(i>1 && i < minCt(m) && mmless(m, i+1, i)) ++i;
 		if(!mmCmpExch(m,i,i/2)) break;
@@ -55,7 +46,7 @@ void minSortDown(Mediator* m, int i){
 }
 
 //maintains maxheap property for all items below i/2. (negative indexes)
-void maxSortDown(Mediator* m, int i){
+static void maxSortDown(Mediator* m, int i){
 	for(; i >= -maxCt(m); i*=2){
 		if(i<-1 && i > -maxCt(m) && mmless(m, i, i-1)) --i;
 	if(!mmCmpExch(m,i/2,i)) break;
@@ -64,14 +55,14 @@ void maxSortDown(Mediator* m, int i){
 
 //maintains minheap property for all items above i, including median
 //returns true if median changed
-int minSortUp(Mediator* m, int i){
+static int minSortUp(Mediator* m, int i){
 	while (i > 0 && mmCmpExch(m, i, i/2)) i /= 2;
 	return (i == 0);
 }
 
 //maintains maxheap property for all items above i, including median
 //returns true if median changed
-int maxSortUp(Mediator* m, int i){
+static int maxSortUp(Mediator* m, int i){
 	while (i < 0 && mmCmpExch(m, i/2, i)) i /= 2;
 	return (i == 0);
 }
@@ -126,8 +117,8 @@ Item MediatorMedian(Mediator* m, Item *minval, Item *maxval){
 		min = v;
 		int i;
 		for(i = -maxCt(m); i < 0; ++i){
-			int v = m->data[m->heap[i]];
-			if(v < min) min = v;
+			Item x = m->data[m->heap[i]];
+			if(ItemLess(x, min)) min = x;
 		}
 		*minval = min;
 	}
@@ -135,16 +126,356 @@ Item MediatorMedian(Mediator* m, Item *minval, Item *maxval){
 		max = v;
 		int i;
 		for(i = 0; i <= minCt(m); ++i){
-			int v = m->data[m->heap[i]];
-			if(v > max) max = v;
+			Item x = m->data[m->heap[i]];
+			if(ItemLess(max, x)) max = x;
 		}
-		*maxval = v;
+		*maxval = max;
 	}
 	return v;
 }
 
+/*--- Multi-channel Mediator ---*/
+
+// pointers to arrays of channel `c`
+#define MCdata(M, c) ((Item*)((M)->blocks + (size_t)(c) * (M)->stride))
+#define MCpos(M, c)  ((int*)(MCdata(M, c) + (M)->N))
+#define MCheap(M, c) (MCpos(M, c) + (M)->N + ((M)->N / 2))
+
+//creates new multi-channel Mediator: `nChannels` running medians of `nItems` each.
+//mallocs single block of memory, caller must free.
+MediatorMC* MediatorMCNew(int nChannels, int nItems){
+	if(nChannels < 1 || nItems < 1) return NULL;
+	// data, pos & heap; each channel starts from new cache line
+	size_t stride = (nItems*(sizeof(Item) + 2*sizeof(int)) + 63) & ~(size_t)63;
+	size_t hdr = (sizeof(MediatorMC) + nChannels*sizeof(MCminmax) + 63) & ~(size_t)63;
+	char *mem;
+	if(posix_memalign((void**)&mem, 64, hdr + stride*nChannels)) return NULL;
+	MediatorMC *M = (MediatorMC*)mem;
+	M->K = nChannels;
+	M->N = nItems;
+	M->idx = M->ct = 0;
+	M->stride = stride;
+	M->mm = (MCminmax*)(M + 1);
+	M->blocks = mem + hdr;
+	for(int c = 0; c < nChannels; ++c){
+		int *pos = MCpos(M, c), *heap = MCheap(M, c);
+		for(int i = nItems - 1; i >= 0; --i){ // the same fill pattern as in MediatorNew
+			pos[i] = ((i+1)/2) * ((i&1)? -1 : 1);
+			heap[pos[i]] = i;
+		}
+	}
+	return M;
+}
+
+// find min or max of `n` items of channel's data
+static void mcrescan(const Item *data, int n, MCminmax *mm, int ismax){
+	int p = 0;
+	for(int i = 1; i < n; ++i)
+		if(ismax ? ItemLess(data[p], data[i]) : ItemLess(data[i], data[p])) p = i;
+	if(ismax){ mm->max = data[p]; mm->maxpos = p; }
+	else{ mm->min = data[p]; mm->minpos = p; }
+}
+
+//inserts next sample of all channels (v[nChannels]), O(lg nItems) for each channel;
+//min & max are updated by new value and rescanned only when they leave window
+void MediatorMCInsert(MediatorMC* M, const Item *v){
+	int N = M->N, slot = M->idx, ct = M->ct + (M->ct < N);
+	for(int c = 0; c < M->K; ++c){
+		Item x = v[c];
+		Mediator m = {.data = MCdata(M, c), .pos = MCpos(M, c), .heap = MCheap(M, c),
+			.N = N, .idx = slot, .ct = M->ct};
+		MediatorInsert(&m, x);
+		MCminmax *mm = &M->mm[c];
+		if(ct == 1){
+			mm->min = mm->max = x;
+			mm->minpos = mm->maxpos = slot;
+			continue;
+		}
+		if(!ItemLess(mm->min, x)){ mm->min = x; mm->minpos = slot; }
+		else if(mm->minpos == slot) mcrescan(m.data, ct, mm, 0);
+		if(!ItemLess(x, mm->max)){ mm->max = x; mm->maxpos = slot; }
+		else if(mm->maxpos == slot) mcrescan(m.data, ct, mm, 1);
+	}
+	if(++M->idx == N) M->idx = 0;
+	M->ct = ct;
+}
+
+//medians (average of 2 when item count is even), min & max values of all channels;
+//any of arrays can be NULL
+void MediatorMCMedian(MediatorMC* M, Item *median, Item *minval, Item *maxval){
+	if(!M->ct) return;
+	for(int c = 0; c < M->K; ++c){
+		if(median){
+			const Item *data = MCdata(M, c);
+			const int *heap = MCheap(M, c);
+			Item v = data[heap[0]];
+			if((M->ct&1) == 0) v = ItemMean(v, data[heap[-1]]);
+			median[c] = v;
+		}
+		if(minval) minval[c] = M->mm[c].min;
+		if(maxval) maxval[c] = M->mm[c].max;
+	}
+}
+
+/*--- 2-D median filter ---*/
+
+// coordinate clamped to [0, n-1] (borders are replicated)
+#define CLAMP(c, n) ((c) < 0 ? 0 : ((c) >= (n) ? (n)-1 : (c)))
+
+// median of 256-bin histogram `h` with 16-bin coarse histogram `hc`: value with rank `half`
+static inline int hist8_median(const uint16_t *h, const uint16_t *hc, int half){
+	int s = 0, c = 0, b;
+	while(s + hc[c] <= half) s += hc[c++];
+	for(b = c*16; s + h[b] <= half; ++b) s += h[b];
+	return b;
+}
+
+/*
+ * uint8_t, Perreault & Hebert: histograms of all columns of window are updated by one pixel
+ * on each next row, kernel histogram on next pixel - by adding right & subtracting left
+ * column histogram (256 + 16 bins, vectorized), so time per pixel doesn't depend on window size
+ */
+static void med_u8(const uint8_t *in, uint8_t *out, int W, int H, int hs, int y0, int y1){
+	int n = 2*hs + 1, half = n*n/2, x, y, b;
+	uint16_t (*col)[256] = calloc(W, sizeof(*col)), (*colc)[16] = calloc(W, sizeof(*colc));
+	uint16_t K[256], Kc[16];
+	if(!col || !colc) err(1, "calloc");
+	for(y = y0 - hs; y <= y0 + hs; ++y){
+		const uint8_t *row = in + CLAMP(y, H)*W;
+		for(x = 0; x < W; ++x){ ++col[x][row[x]]; ++colc[x][row[x] >> 4]; }
+	}
+	for(y = y0; y < y1; ++y){
+		if(y > y0){ // move column histograms down
+			const uint8_t *rm = in + CLAMP(y-hs-1, H)*W, *ad = in + CLAMP(y+hs, H)*W;
+			for(x = 0; x < W; ++x){
+				--col[x][rm[x]]; --colc[x][rm[x] >> 4];
+				++col[x][ad[x]]; ++colc[x][ad[x] >> 4];
+			}
+		}
+		memset(K, 0, sizeof(K)); memset(Kc, 0, sizeof(Kc));
+		for(x = -hs; x <= hs; ++x){
+			int xx = CLAMP(x, W);
+			for(b = 0; b < 256; ++b) K[b] += col[xx][b];
+			for(b = 0; b < 16; ++b) Kc[b] += colc[xx][b];
+		}
+		uint8_t *o = out + y*W;
+		for(x = 0; x < W; ++x){
+			o[x] = (uint8_t)hist8_median(K, Kc, half);
+			int xa = CLAMP(x+hs+1, W), xr = CLAMP(x-hs, W);
+			if(xa == xr) continue;
+			const uint16_t *ca = col[xa], *cr = col[xr];
+			for(b = 0; b < 256; ++b) K[b] += ca[b] - cr[b];
+			for(b = 0; b < 16; ++b) Kc[b] += colc[xa][b] - colc[xr][b];
+		}
+	}
+	free(col); free(colc);
+}
+
+/*
+ * Huang: kernel histogram (fine + coarse with 256 fine bins in each) is updated by column of
+ * window on each step; window moves by "snake" (odd rows from right to left), so histogram is
+ * never rebuilt; median is tracked from its previous value (moving by coarse bins where possible)
+ */
+
+// move median `m` (`lt` - amount of values less than m) to value with rank `half`
+static inline uint32_t track_median(const uint16_t *K, const uint16_t *Kc, uint32_t m, int *lt, int half){
+	int l = *lt;
+	while(l > half){ // move down
+		if((m & 255) == 0) while(l - Kc[(m >> 8) - 1] > half){ l -= Kc[(m >> 8) - 1]; m -= 256; }
+		l -= K[--m];
+	}
+	while(l + K[m] <= half){ // move up
+		l += K[m++];
+		if((m & 255) == 0) while(l + Kc[m >> 8] <= half){ l += Kc[m >> 8]; m += 256; }
+	}
+	*lt = l;
+	return m;
+}
+
+/**
+ * Huang filter of rows y0..y1-1 for histogram levels of type T (0..nbins-1)
+ * @param in - rows ylo.. of image (all rows of window should be there)
+ * @param out - rows oy.. of output
+ * @param K, Kc - zeroed fine (nbins) and coarse (nbins/256 + 1) histograms
+ */
+#define HUANG(name, T) \
+static void name(const T *in, int ylo, T *out, int oy, int W, int H, int hs, int y0, int y1, \
+		uint16_t *K, uint16_t *Kc){ \
+	int n = 2*hs + 1, half = n*n/2, x = 0, y, d, dir = 1, lt = 0; \
+	uint32_t m = 0; \
+	in -= (ptrdiff_t)ylo * W; out -= (ptrdiff_t)oy * W; \
+	for(y = y0 - hs; y <= y0 + hs; ++y){ \
+		const T *row = in + (ptrdiff_t)CLAMP(y, H)*W; \
+		for(d = -hs; d <= hs; ++d){ T v = row[CLAMP(d, W)]; ++K[v]; ++Kc[v >> 8]; } \
+	} \
+	for(y = y0; y < y1; ++y){ \
+		if(y > y0){ /* move down */ \
+			const T *rm = in + (ptrdiff_t)CLAMP(y-hs-1, H)*W, *ad = in + (ptrdiff_t)CLAMP(y+hs, H)*W; \
+			for(d = -hs; d <= hs; ++d){ \
+				int xx = CLAMP(x+d, W); T v = rm[xx]; \
+				--K[v]; --Kc[v >> 8]; lt -= (v < m); \
+				v = ad[xx]; ++K[v]; ++Kc[v >> 8]; lt += (v < m); \
+			} \
+		} \
+		while(1){ \
+			m = track_median(K, Kc, m, &lt, half); \
+			out[(ptrdiff_t)y*W + x] = (T)m; \
+			int xn = x + dir; \
+			if(xn < 0 || xn >= W) break; \
+			int xr = CLAMP(x - dir*hs, W), xa = CLAMP(xn + dir*hs, W); \
+			if(xr != xa) for(d = -hs; d <= hs; ++d){ \
+				const T *row = in + (ptrdiff_t)CLAMP(y+d, H)*W; \
+				T v = row[xr]; --K[v]; --Kc[v >> 8]; lt -= (v < m); \
+				v = row[xa]; ++K[v]; ++Kc[v >> 8]; lt += (v < m); \
+			} \
+			x = xn; \
+		} \
+		dir = -dir; \
+	} \
+}
+HUANG(huang16, uint16_t)
+HUANG(huang32, uint32_t)
+
+// uint16_t: Huang on pixel values
+static void med_u16(const uint16_t *in, uint16_t *out, int W, int H, int hs, int y0, int y1){
+	uint16_t *K = calloc(65536 + 256, sizeof(uint16_t));
+	if(!K) err(1, "calloc");
+	huang16(in, 0, out, 0, W, H, hs, y0, y1, K, K + 65536);
+	free(K);
+}
+
+// float -> unsigned int with the same order
+static inline uint32_t f2key(float f){
+	uint32_t i;
+	memcpy(&i, &f, sizeof(i));
+	return (i & 0x80000000) ? ~i : i | 0x80000000;
+}
+
+// and back
+static inline float key2f(uint32_t i){
+	float f;
+	i = (i & 0x80000000) ? i & 0x7fffffff : ~i;
+	memcpy(&f, &i, sizeof(f));
+	return f;
+}
+
+// float images with smaller windows are filtered by Mediator
+#define MED_FLOAT_MINHS (3)
+
+/*
+ * float, small windows: Mediator with window size; window moves along row by inserting next
+ * column, circular queue of Mediator throws out the oldest one
+ */
+static void med_float_small(const float *in, float *out, int W, int H, int hs, int y0, int y1){
+	int n = 2*hs + 1, x, y, d;
+	Mediator *m = MediatorNew(n*n);
+	if(!m) err(1, "malloc");
+	for(y = y0; y < y1; ++y){
+		for(x = -hs; x < W + hs; ++x){
+			int xx = CLAMP(x, W);
+			for(d = -hs; d <= hs; ++d) MediatorInsert(m, (Item)(f2key(in[CLAMP(y+d, H)*W + xx]) ^ 0x80000000));
+			if(x >= hs) out[y*W + x - hs] = key2f((uint32_t)MediatorMedian(m, NULL, NULL) ^ 0x80000000);
+		}
+	}
+	free(m);
+}
+
+// amount of rows of float image processed with one ranks table
+#define MED_CHUNK   (128)
+
+/*
+ * float: pixels of rows needed for MED_CHUNK output rows are replaced by their ranks
+ * (radix sort), ranks are filtered by Huang
+ */
+static void med_float(const float *in, float *out, int W, int H, int hs, int y0, int y1){
+	if(hs < MED_FLOAT_MINHS){
+		med_float_small(in, out, W, H, hs, y0, y1);
+		return;
+	}
+	int maxrows = MED_CHUNK + 2*hs;
+	if(maxrows > H) maxrows = H;
+	size_t M = (size_t)maxrows * W;
+	uint32_t *key = malloc(M * sizeof(uint32_t)), *key2 = malloc(M * sizeof(uint32_t)),
+		*idx = malloc(M * sizeof(uint32_t)), *idx2 = malloc(M * sizeof(uint32_t));
+	uint16_t *K = malloc((M + M/256 + 1) * sizeof(uint16_t));
+	if(!key || !key2 || !idx || !idx2 || !K) err(1, "malloc");
+	for(int c0 = y0; c0 < y1; c0 += MED_CHUNK){
+		int c1 = (c0 + MED_CHUNK < y1) ? c0 + MED_CHUNK : y1;
+		int ylo = CLAMP(c0 - hs, H), yhi = CLAMP(c1 - 1 + hs, H) + 1;
+		size_t N = (size_t)(yhi - ylo) * W;
+		const float *src = in + (size_t)ylo * W;
+		for(size_t i = 0; i < N; ++i){ key[i] = f2key(src[i]); idx[i] = i; }
+		for(int sh = 0; sh < 32; sh += 8){ // LSD radix sort of (key, idx)
+			size_t cnt[256] = {0}, s = 0;
+			for(size_t i = 0; i < N; ++i) ++cnt[(key[i] >> sh) & 255];
+			for(int b = 0; b < 256; ++b){ size_t t = cnt[b]; cnt[b] = s; s += t; }
+			for(size_t i = 0; i < N; ++i){
+				size_t p = cnt[(key[i] >> sh) & 255]++;
+				key2[p] = key[i]; idx2[p] = idx[i];
+			}
+			uint32_t *t = key; key = key2; key2 = t;
+			t = idx; idx = idx2; idx2 = t;
+		}
+		// dense ranks: key2 - ranks of pixels, idx2 (as float) - values of ranks
+		float *val = (float*)idx2;
+		uint32_t r = 0;
+		for(size_t i = 0; i < N; ++i){
+			if(i && key[i] != key[i-1]) ++r;
+			key2[idx[i]] = r;
+			val[r] = src[idx[i]];
+		}
+		uint32_t nbins = r + 1;
+		memset(K, 0, (nbins + nbins/256 + 1) * sizeof(uint16_t));
+		// ranks of output go to `key`
+		huang32(key2, ylo, key, c0, W, H, hs, c0, c1, K, K + nbins);
+		float *o = out + (size_t)c0 * W;
+		for(size_t i = 0, e = (size_t)(c1 - c0) * W; i < e; ++i) o[i] = val[key[i]];
+	}
+	free(key); free(key2); free(idx); free(idx2); free(K);
+}
+
+/**
+ * 2-D median filter with window (2*hs+1)x(2*hs+1), borders are replicated
+ * @param in - input image
+ * @param out - output image (should not overlap with `in`)
+ * @param W, H - image size
+ * @param hs - half-size of window (1..MED_MAXHS)
+ * @param type - pixel type
+ * @param nthreads - amount of threads (< 1 - by OpenMP settings), image is split into bands of rows
+ * @return 0 if all OK or -1 if parameters are wrong
+ */
+int median_filter(const void *in, void *out, int W, int H, int hs, med_type type, int nthreads){
+	if(!in || !out || W < 1 || H < 1 || hs < 1 || hs > MED_MAXHS) return -1;
+	if(type != MED_U8 && type != MED_U16 && type != MED_FLOAT) return -1;
+#ifdef _OPENMP
+	if(nthreads < 1) nthreads = omp_get_max_threads();
+	if(nthreads > H) nthreads = H;
+	#pragma omp parallel num_threads(nthreads)
+#endif
+	{
+		int tid = 0, nt = 1;
+#ifdef _OPENMP
+		tid = omp_get_thread_num();
+		nt = omp_get_num_threads();
+#endif
+		int y0 = (int)((int64_t)H * tid / nt), y1 = (int)((int64_t)H * (tid + 1) / nt);
+		if(y1 > y0) switch(type){
+			case MED_U8:
+				med_u8(in, out, W, H, hs, y0, y1);
+			break;
+			case MED_U16:
+				med_u16(in, out, W, H, hs, y0, y1);
+			break;
+			default:
+				med_float(in, out, W, H, hs, y0, y1);
+		}
+	}
+	(void)nthreads;
+	return 0;
+}
 
 /*--- Test Code ---*/
+#ifdef STANDALONE
 #include <stdio.h>
 void PrintMaxHeap(Mediator* m){
 	int i;
@@ -182,64 +513,125 @@ double dtime(){
 	return t;
 }
 
-#define SZ (4000)
-int main(int argc, char* argv[])
-{
-	int siz = SZ * SZ;
-	int i, *v = malloc(siz * sizeof(int)), *o = malloc(siz*sizeof(int)),
-		*small = malloc(siz * sizeof(int)), *large = malloc(siz * sizeof(int));
-
-for (i=0; i < siz; ++i){
-	int s = (rand() & 0xf) + 0xf00, d = rand() & 0xffff;
-	if(d > 0xefff) s+= 0xf000;
-	else if(d < 0xfff) s = 0;
-	v[i] = s;
-}
-double t0;
-void printmas(int *arr){
-	int  x, y, fst = SZ/2-5, lst = SZ/2+4;
-	for(y = fst; y < lst; ++y){
-		for(x = fst; x < lst; ++x)
-			printf("%5d ", arr[x + y*SZ]);
-		printf("\n");
-	}
-}
-void printels(int hsz){
-	int fulls = hsz*2+1;
-	printf("median %dx%d for %dx%d image: %g seconds\n", fulls, fulls, SZ, SZ, dtime()-t0);
-	printf("mid 10 values\n");
-	printf("ori:\n");
-	printmas(v);
-	printf("\nmed:\n");
-	printmas(o);
-	printf("\nmin:\n");
-	printmas(small);
-	printf("\nmax:\n");
-	printmas(large);
-	printf("\n\n");
-}
-
-int hs;
-for(hs = 1; hs < 5; ++hs){
-	t0 = dtime();
-	int blksz = hs*2+1, fullsz = blksz * blksz;
-	OMP_FOR(shared(o, v, small, large))
-	for(int x = hs; x < SZ - hs; ++x){
-		int xx, yy, xm = x+hs+1, y;
-		Mediator* m = MediatorNew(fullsz);
-		// initial fill
-		for(yy = 0; yy < blksz - 1; ++yy) for(xx = x-hs; xx < xm; ++xx)  MediatorInsert(m, v[xx+yy*SZ]);
-		for(y = hs; y < SZ - hs; ++y){
-			for(xx = x-hs; xx < xm; ++xx) MediatorInsert(m, v[xx+(y+hs)*SZ]);
-			int curpos = x+y*SZ;
-			o[curpos] = MediatorMedian(m, &small[curpos], &large[curpos]);
-			//ShowTree(m);
-			//if(y == 2) return 0;
-		}
-		free(m);
-	}
-	printels(hs);
-}
-free(o); free(v);
-	free(small); free(large);
+static const char *tnames[] = {"uint8", "uint16", "float"};
+static const size_t tsizes[] = {1, 2, 4};
+
+static double pixval(const void *im, med_type t, int idx){
+	switch(t){
+		case MED_U8: return ((const uint8_t*)im)[idx];
+		case MED_U16: return ((const uint16_t*)im)[idx];
+		default: return ((const float*)im)[idx];
+	}
+}
+
+// noisy image with spikes
+static void *gen_image(med_type t, int W, int H){
+	void *im = malloc(W * H * tsizes[t]);
+	for(int i = 0; i < W*H; ++i){
+		int s = (rand() & 0xf) + 0x70, d = rand() & 0xffff;
+		if(d > 0xefff) s = 0xff;
+		else if(d < 0xfff) s = 0;
+		switch(t){
+			case MED_U8: ((uint8_t*)im)[i] = s; break;
+			case MED_U16: ((uint16_t*)im)[i] = s * 0x101 + (rand() & 0xff); break;
+			default: ((float*)im)[i] = (s - 0x78) / 7.f + rand() / (float)RAND_MAX;
+		}
+	}
+	return im;
+}
+
+static int cmpd(const void *a, const void *b){
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x < y) ? -1 : (x > y);
+}
+
+// check result by naive median with sorting
+static int check(med_type t, const void *in, const void *out, int W, int H, int hs){
+	int n = 2*hs + 1;
+	double *w = malloc(n*n*sizeof(double));
+	for(int y = 0; y < H; ++y) for(int x = 0; x < W; ++x){
+		int k = 0;
+		for(int dy = -hs; dy <= hs; ++dy) for(int dx = -hs; dx <= hs; ++dx)
+			w[k++] = pixval(in, t, CLAMP(y+dy, H)*W + CLAMP(x+dx, W));
+		qsort(w, k, sizeof(double), cmpd);
+		if(w[k/2] != pixval(out, t, y*W + x)){
+			printf("%s, hs=%d: error in (%d, %d): %g instead of %g\n", tnames[t], hs, x, y,
+				pixval(out, t, y*W + x), w[k/2]);
+			free(w);
+			return 0;
+		}
+	}
+	free(w);
+	return 1;
+}
+
+// multi-channel Mediator: check by single-channel ones and compare speed
+static int test_mc(int K, int N, int nsamples){
+	MediatorMC *M = MediatorMCNew(K, N);
+	Mediator **m = malloc(K * sizeof(Mediator*));
+	Item *v = malloc(K * sizeof(Item)), *med = malloc(K * sizeof(Item)),
+		*mn = malloc(K * sizeof(Item)), *mx = malloc(K * sizeof(Item));
+	for(int c = 0; c < K; ++c) m[c] = MediatorNew(N);
+	double t1 = 0., t2 = 0.;
+	for(int i = 0; i < nsamples; ++i){
+		for(int c = 0; c < K; ++c){
+			v[c] = (rand() & 0xff) + (c << 4) + (((i / 100) & 1) ? i : -i) * 4; // noise with trends
+			if((rand() & 0xff) == 0) v[c] += 5000; // spikes
+		}
+		double t0 = dtime();
+		MediatorMCInsert(M, v);
+		MediatorMCMedian(M, med, mn, mx);
+		t1 += dtime() - t0;
+		t0 = dtime();
+		for(int c = 0; c < K; ++c){
+			Item a, b, x;
+			MediatorInsert(m[c], v[c]);
+			x = MediatorMedian(m[c], &a, &b);
+			if(x != med[c] || a != mn[c] || b != mx[c]){
+				printf("Multi-channel: error in channel %d, sample %d: %d/%d/%d instead of %d/%d/%d\n",
+					c, i, med[c], mn[c], mx[c], x, a, b);
+				return 0;
+			}
+		}
+		t2 += dtime() - t0;
+	}
+	printf("Multi-channel (%d channels, window %d): %.1f ns per sample of channel, %d Mediators: %.1f ns\n",
+		K, N, t1 * 1e9 / nsamples / K, K, t2 * 1e9 / nsamples / K);
+	for(int c = 0; c < K; ++c) free(m[c]);
+	free(m); free(M); free(v); free(med); free(mn); free(mx);
+	return 1;
+}
+
+int main(int argc, char* argv[]){
+	int SZ = (argc > 1) ? atoi(argv[1]) : 4096, maxhs = (argc > 2) ? atoi(argv[2]) : 7;
+	if(SZ < 16 || maxhs < 1 || maxhs > MED_MAXHS){
+		fprintf(stderr, "Usage: %s [size [max half-size]]\n", argv[0]);
+		return 1;
+	}
+	if(!test_mc(7, 1, 100) || !test_mc(37, 8, 1000) || !test_mc(2000, 31, 3000)) return 2;
+	// correctness on small image (with window bigger than image too)
+	for(med_type t = MED_U8; t <= MED_FLOAT; ++t){
+		int W = 23, H = 150; // more than MED_CHUNK rows
+		void *in = gen_image(t, W, H), *out = malloc(W * H * tsizes[t]);
+		for(int hs = 1; hs < 40; hs += (hs < 5) ? 1 : 17){
+			median_filter(in, out, W, H, hs, t, 3);
+			if(!check(t, in, out, W, H, hs)) return 2;
+		}
+		printf("%s: OK\n", tnames[t]);
+		free(in); free(out);
+	}
+	// timing
+	for(med_type t = MED_U8; t <= MED_FLOAT; ++t){
+		void *in = gen_image(t, SZ, SZ), *out = malloc((size_t)SZ * SZ * tsizes[t]);
+		for(int hs = 1; hs <= maxhs; hs = (hs < 3) ? hs + 1 : hs * 2 + 1){
+			double t0 = dtime();
+			median_filter(in, out, SZ, SZ, hs, t, 0);
+			t0 = dtime() - t0;
+			printf("median %dx%d for %dx%d %s image: %.3f seconds (%.1f ns/pixel)\n", 2*hs+1, 2*hs+1,
+				SZ, SZ, tnames[t], t0, t0 * 1e9 / SZ / SZ);
+		}
+		free(in); free(out);
+	}
+	return 0;
 }
+#endif
@@ -0,0 +1,63 @@
+//Copyright (c) 2011 ashelly.myopenid.com under <http://www.opensource.org/licenses/mit-license>
+// 2-D median filter engine: Edward V. Emelianov <edward.emelianoff@gmail.com>
+
+#pragma once
+#ifndef __MED_H__
+#define __MED_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+//Customize for your data Item type
+typedef int Item;
+#define ItemLess(a,b) ((a)<(b))
+#define ItemMean(a,b) (((a)+(b))/2)
+
+typedef struct Mediator_t{
+	Item* data; // circular queue of values
+	int* pos;   // index into `heap` for each value
+	int* heap;  // max/median/min heap holding indexes into `data`.
+	int N;      // allocated size.
+	int idx;    // position in circular queue
+	int ct;     // count of items in queue
+} Mediator;
+
+Mediator* MediatorNew(int nItems);
+void MediatorInsert(Mediator* m, Item v);
+Item MediatorMedian(Mediator* m, Item *minval, Item *maxval);
+
+// K channels with windows of the same size in one block; samples of all channels come together,
+// so position in circular queues is common; min & max are kept for each channel
+
+typedef struct{
+	Item min, max;
+	int minpos, maxpos; // their positions in circular queue
+} MCminmax;
+
+typedef struct MediatorMC_t{
+	int K;          // amount of channels
+	int N;          // window size
+	int idx;        // position in circular queues
+	int ct;         // count of items in queues
+	size_t stride;  // size of channel's block (data, pos & heap), bytes
+	MCminmax* mm;   // min & max of each channel
+	char* blocks;   // blocks of channels
+} MediatorMC;
+
+MediatorMC* MediatorMCNew(int nChannels, int nItems);
+void MediatorMCInsert(MediatorMC* M, const Item *v);
+void MediatorMCMedian(MediatorMC* M, Item *median, Item *minval, Item *maxval);
+
+// pixel types of median_filter
+typedef enum{
+	MED_U8,     // uint8_t: column histograms (Perreault & Hebert), O(1) per pixel
+	MED_U16,    // uint16_t: sliding two-level histogram (Huang), O(hs) per pixel
+	MED_FLOAT,  // float: the same for ranks of pixels (radix sort by chunks of rows), Mediator for hs < 3
+} med_type;
+
+// max half-size of window (counts of histograms are 16-bit)
+#define MED_MAXHS   (127)
+
+int median_filter(const void *in, void *out, int W, int H, int hs, med_type type, int nthreads);
+
+#endif // __MED_H__
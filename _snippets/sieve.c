@@ -0,0 +1,345 @@
+/*
+ * sieve.c - segmented sieve of Eratosthenes with mod 30 wheel
+ *
+ * Copyright 2025 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+/*
+ * Byte `b` holds numbers 30*b + {1, 7, 11, 13, 17, 19, 23, 29} (multiples of 2, 3 & 5
+ * are absent at all). Multiples p*m of prime p with m = 30*k + r (fixed r) lie in the
+ * same bit of bytes p*k + p*r/30, so each prime is sieved by 8 progressions with
+ * step of p bytes. Multiples of 7, 11, 13 & 17 are copied from pattern of 7*11*13*17 bytes.
+ * Segments are independent (start of each progression is calculated for every segment),
+ * so each thread sieves its own segments in its own buffer: no races and no O(N) memory;
+ * only sieving primes up to sqrt(hi) are stored (found by the same sieve).
+ * compile test: gcc -O3 -march=native -fopenmp -DSTANDALONE sieve.c -o sieve -lm
+ */
+
+#include <err.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "sieve.h"
+
+static const uint8_t wheel[8] = {1, 7, 11, 13, 17, 19, 23, 29};
+// number of bit for residue mod 30 (only for residues from wheel)
+static const uint8_t bitof[30] = {
+	[1] = 0, [7] = 1, [11] = 2, [13] = 3, [17] = 4, [19] = 5, [23] = 6, [29] = 7
+};
+
+// presieved primes: 7, 11, 13, 17; sieving begins from 19
+#define PRE_SZ      (7*11*13*17)
+#define PRE_BITS    (0x1e)
+#define FIRST_PRIME (19)
+static uint8_t pattern[PRE_SZ];
+static pthread_once_t pattern_once = PTHREAD_ONCE_INIT;
+
+static void pattern_init(){
+	static const uint32_t pre[4] = {7, 11, 13, 17};
+	memset(pattern, 0xff, PRE_SZ);
+	for(int i = 0; i < 4; ++i){
+		uint32_t p = pre[i];
+		for(int j = 0; j < 8; ++j){
+			uint32_t pr = p * wheel[j];
+			uint8_t mask = ~(1 << bitof[pr % 30]);
+			for(uint32_t b = pr / 30; b < PRE_SZ; b += p) pattern[b] &= mask;
+		}
+	}
+}
+
+static uint64_t isqrt(uint64_t x){
+	uint64_t r = (uint64_t)sqrtl((long double)x);
+	if(r > UINT32_MAX) r = UINT32_MAX;
+	while(r * r > x) --r;
+	while(r < UINT32_MAX && (r + 1) * (r + 1) <= x) ++r;
+	return r;
+}
+
+/**
+ * Sieve segment
+ * @param seg - segment
+ * @param B - its first byte
+ * @param n - its size
+ * @param primes - sieving primes (from FIRST_PRIME)
+ * @param np - their amount
+ */
+static void sieve_segment(uint8_t *seg, uint64_t B, size_t n, const uint32_t *primes, size_t np){
+	size_t off = B % PRE_SZ;
+	for(size_t done = 0; done < n; off = 0){
+		size_t l = PRE_SZ - off;
+		if(l > n - done) l = n - done;
+		memcpy(seg + done, pattern + off, l);
+		done += l;
+	}
+	if(B == 0) seg[0] = (seg[0] | PRE_BITS) & ~1; // 7..17 are primes, 1 isn't
+	uint64_t lo = B * 30, end = B + n;
+	for(size_t i = 0; i < np; ++i){
+		uint64_t p = primes[i], pp = p * p;
+		if(pp / 30 >= end) break;
+		// the first multiplier: max(p, ceil(lo/p))
+		uint64_t m0 = (pp / 30 >= B) ? p : (lo - 1) / p + 1;
+		uint64_t k = m0 / 30;
+		uint32_t r0 = m0 % 30;
+		for(int j = 0; j < 8; ++j){
+			uint64_t pr = p * wheel[j];
+			uint64_t b = p * (k + (wheel[j] < r0)) + pr / 30 - B;
+			uint8_t mask = ~(1 << bitof[pr % 30]);
+			for(; b < n; b += p) seg[b] &= mask;
+		}
+	}
+}
+
+// clear numbers out of [lo, hi) in segment [B, B+n)
+static void clip(uint8_t *seg, uint64_t B, size_t n, uint64_t lo, uint64_t hi){
+	uint64_t blo = lo / 30, bhi = (hi - 1) / 30;
+	if(blo >= B && blo < B + n){
+		uint32_t r = lo % 30;
+		for(int j = 0; j < 8; ++j) if(wheel[j] < r) seg[blo - B] &= ~(1 << j);
+	}
+	if(bhi >= B && bhi < B + n){
+		uint32_t r = (hi - 1) % 30;
+		for(int j = 0; j < 8; ++j) if(wheel[j] > r) seg[bhi - B] &= ~(1 << j);
+	}
+}
+
+// amount of 2, 3 & 5 in [lo, hi)
+static uint64_t count_small(uint64_t lo, uint64_t hi){
+	uint64_t N = 0;
+	for(uint64_t p = 2; p < 6; p += (p == 2) ? 1 : 2) if(p >= lo && p < hi) ++N;
+	return N;
+}
+
+/**
+ * Get sieving primes
+ * @param lim - max value
+ * @param np - (o) amount of primes
+ * @return array of primes FIRST_PRIME <= p <= lim (NULL if there's no such primes)
+ */
+static uint32_t *sieving_primes(uint64_t lim, size_t *np){
+	*np = 0;
+	if(lim < FIRST_PRIME) return NULL;
+	// pi(x) < 1.26 x / ln(x)
+	size_t N = 0, sz = (size_t)(1.26 * lim / log((double)lim)) + 16;
+	uint32_t *primes = malloc(sz * sizeof(uint32_t));
+	if(!primes) err(1, "malloc");
+	sieve_iter it;
+	if(sieve_iter_init(&it, FIRST_PRIME, lim + 1)) errx(1, "sieving_primes");
+	uint64_t p;
+	while((p = sieve_next(&it))){
+		if(N == sz) errx(1, "sieving_primes: too many primes");
+		primes[N++] = (uint32_t)p;
+	}
+	sieve_iter_free(&it);
+	*np = N;
+	return primes;
+}
+
+/**
+ * Count primes in [lo, hi)
+ * @param nthreads - amount of threads (< 1 - by OpenMP settings)
+ */
+uint64_t sieve_count(uint64_t lo, uint64_t hi, int nthreads){
+	if(hi <= lo) return 0;
+	pthread_once(&pattern_once, pattern_init);
+	uint64_t N = count_small(lo, hi), b0 = lo / 30, b1 = (hi - 1) / 30 + 1;
+	uint64_t nseg = (b1 - b0 + SIEVE_SEGSZ - 1) / SIEVE_SEGSZ;
+	size_t np;
+	uint32_t *primes = sieving_primes(isqrt(hi - 1), &np);
+#ifdef _OPENMP
+	if(nthreads < 1) nthreads = omp_get_max_threads();
+	if((uint64_t)nthreads > nseg) nthreads = (int)nseg;
+	#pragma omp parallel num_threads(nthreads) reduction(+:N)
+#endif
+	{
+		uint8_t *seg = aligned_alloc(64, SIEVE_SEGSZ);
+		if(!seg) err(1, "aligned_alloc");
+#ifdef _OPENMP
+		#pragma omp for schedule(dynamic, 1)
+#endif
+		for(uint64_t s = 0; s < nseg; ++s){
+			uint64_t B = b0 + s * SIEVE_SEGSZ;
+			size_t n = (b1 - B < SIEVE_SEGSZ) ? b1 - B : SIEVE_SEGSZ, i = 0;
+			sieve_segment(seg, B, n, primes, np);
+			clip(seg, B, n, lo, hi);
+			for(; i + 8 <= n; i += 8){
+				uint64_t w;
+				memcpy(&w, seg + i, 8);
+				N += __builtin_popcountll(w);
+			}
+			for(; i < n; ++i) N += __builtin_popcount(seg[i]);
+		}
+		free(seg);
+	}
+	(void)nthreads;
+	free(primes);
+	return N;
+}
+
+// sieve the next segment of iterator; return 0 if there's no more segments
+static int iter_segment(sieve_iter *it){
+	uint64_t B = it->B + it->nbytes;
+	if(B >= it->bend) return 0;
+	it->B = B;
+	it->nbytes = (it->bend - B < SIEVE_SEGSZ) ? it->bend - B : SIEVE_SEGSZ;
+	sieve_segment(it->seg, B, it->nbytes, it->primes, it->nprimes);
+	clip(it->seg, B, it->nbytes, it->lo, it->hi);
+	it->byte = 0;
+	it->bits = it->seg[0];
+	return 1;
+}
+
+/**
+ * Init iterator over primes in [lo, hi)
+ * @return 0 if all OK
+ */
+int sieve_iter_init(sieve_iter *it, uint64_t lo, uint64_t hi){
+	if(!it) return -1;
+	pthread_once(&pattern_once, pattern_init);
+	memset(it, 0, sizeof(sieve_iter));
+	it->lo = lo;
+	it->hi = hi;
+	if(hi <= lo) return 0;
+	it->seg = aligned_alloc(64, SIEVE_SEGSZ);
+	if(!it->seg) return -1;
+	it->primes = sieving_primes(isqrt(hi - 1), &it->nprimes);
+	it->B = lo / 30;
+	it->bend = (hi - 1) / 30 + 1;
+	it->nbytes = 0;
+	it->bits = 0;
+	return 0;
+}
+
+/**
+ * Get next prime of iterator
+ * @return prime or 0 if there's no more primes
+ */
+uint64_t sieve_next(sieve_iter *it){
+	static const uint8_t small[3] = {2, 3, 5};
+	while(it->small < 3){
+		uint64_t p = small[it->small++];
+		if(p >= it->lo && p < it->hi) return p;
+	}
+	while(!it->bits){
+		if(++it->byte >= it->nbytes && !iter_segment(it)) return 0;
+		if(it->byte < it->nbytes) it->bits = it->seg[it->byte];
+	}
+	int j = __builtin_ctzll(it->bits);
+	it->bits &= it->bits - 1;
+	return (it->B + it->byte) * 30 + wheel[j];
+}
+
+void sieve_iter_free(sieve_iter *it){
+	if(!it) return;
+	free(it->seg);
+	free(it->primes);
+	memset(it, 0, sizeof(sieve_iter));
+}
+
+#ifdef STANDALONE
+#include <stdio.h>
+#include <time.h>
+
+static double dtime(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int isprime(uint64_t n){
+	if(n < 2) return 0;
+	for(uint64_t d = 2; d * d <= n; ++d) if(n % d == 0) return 0;
+	return 1;
+}
+
+// check iterator & counter by trial division
+static void check_range(uint64_t lo, uint64_t hi){
+	sieve_iter it;
+	if(sieve_iter_init(&it, lo, hi)) errx(1, "sieve_iter_init");
+	uint64_t p = sieve_next(&it), N = 0;
+	for(uint64_t n = lo; n < hi; ++n){
+		if(!isprime(n)) continue;
+		if(p != n) errx(1, "[%lu, %lu): got %lu instead of %lu", lo, hi, p, n);
+		p = sieve_next(&it);
+		++N;
+	}
+	if(p) errx(1, "[%lu, %lu): extra prime %lu", lo, hi, p);
+	sieve_iter_free(&it);
+	uint64_t c = sieve_count(lo, hi, 0);
+	if(c != N) errx(1, "[%lu, %lu): count %lu instead of %lu", lo, hi, c, N);
+}
+
+int main(int argc, char **argv){
+	uint64_t hi = (argc > 1) ? strtoull(argv[1], NULL, 0) : 1000000000ULL;
+	int maxthreads = 1;
+#ifdef _OPENMP
+	maxthreads = omp_get_max_threads();
+#endif
+	// pi(10^k)
+	static const uint64_t pi10[] = {0, 4, 25, 168, 1229, 9592, 78498, 664579, 5761455, 50847534, 455052511};
+	uint64_t x = 1;
+	for(int k = 0; k < 11 && x <= hi; ++k, x *= 10){
+		uint64_t c = sieve_count(0, x + 1, 0);
+		if(c != pi10[k]) errx(1, "pi(10^%d) = %lu instead of %lu", k, c, pi10[k]);
+	}
+	for(uint64_t lo = 0; lo < 100; ++lo) for(uint64_t h = lo; h < 200; h += 7) check_range(lo, h);
+	srand48(1);
+	for(int i = 0; i < 100; ++i){
+		uint64_t lo = lrand48() % 10000000000ULL, l = lrand48() % 3000;
+		check_range(lo, lo + l);
+	}
+	check_range(1000000000000ULL - 1000, 1000000000000ULL + 1000);
+	// primes 2^64 - {95, 83, 59} (trial division is too slow here)
+	static const uint64_t top[3] = {UINT64_MAX - 94, UINT64_MAX - 82, UINT64_MAX - 58};
+	sieve_iter it;
+	sieve_iter_init(&it, UINT64_MAX - 99, UINT64_MAX);
+	for(int i = 0; i < 3; ++i) if(sieve_next(&it) != top[i]) errx(1, "wrong primes near 2^64");
+	if(sieve_next(&it)) errx(1, "extra primes near 2^64");
+	sieve_iter_free(&it);
+	sieve_iter_init(&it, 0, 1000);
+	printf("Primes < 1000:");
+	for(uint64_t p; (p = sieve_next(&it));) printf(" %lu", p);
+	printf("\n");
+	sieve_iter_free(&it);
+	printf("Tests passed\n\n");
+	// speed
+	double t0 = dtime(), t1 = 0.;
+	for(int nt = 1; nt <= maxthreads; nt *= 2){
+		t0 = dtime();
+		uint64_t c = sieve_count(0, hi, nt);
+		double t = dtime() - t0;
+		if(nt == 1) t1 = t;
+		printf("pi(%lu) = %lu; %d thread[s]: %.3fs (speedup %.2f)\n", hi, c, nt, t, t1 / t);
+	}
+	t0 = dtime();
+	sieve_iter_init(&it, 0, hi);
+	uint64_t last = 0, N = 0;
+	for(uint64_t p; (p = sieve_next(&it)); ++N) last = p;
+	sieve_iter_free(&it);
+	printf("Iterator: %lu primes, last is %lu; %.3fs\n", N, last, dtime() - t0);
+	uint64_t lo = 1000000000000ULL;
+	t0 = dtime();
+	N = sieve_count(lo, lo + 1000000000ULL, 0);
+	printf("pi([10^12, 10^12+10^9)) = %lu; %.3fs\n", N, dtime() - t0);
+	return 0;
+}
+#endif
@@ -0,0 +1,53 @@
+/*
+ * sieve.h - segmented sieve of Eratosthenes with mod 30 wheel
+ *
+ * Copyright 2025 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#pragma once
+#ifndef __SIEVE_H__
+#define __SIEVE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// size of segment in bytes (each byte holds 30 numbers); should fit in L1/L2 cache
+#ifndef SIEVE_SEGSZ
+#define SIEVE_SEGSZ     (32768)
+#endif
+
+// iterator over primes of range [lo, hi)
+typedef struct{
+	uint64_t lo, hi;        // range
+	uint64_t B;             // first byte of current segment
+	uint64_t bend;          // last byte of range + 1
+	size_t nbytes;          // size of current segment
+	size_t byte;            // current byte in it
+	uint64_t bits;          // rest of bits of current byte
+	int small;              // index of next of 2, 3, 5
+	uint8_t *seg;           // segment
+	uint32_t *primes;       // sieving primes (from 19 to sqrt(hi))
+	size_t nprimes;
+} sieve_iter;
+
+uint64_t sieve_count(uint64_t lo, uint64_t hi, int nthreads);
+int sieve_iter_init(sieve_iter *it, uint64_t lo, uint64_t hi);
+uint64_t sieve_next(sieve_iter *it);
+void sieve_iter_free(sieve_iter *it);
+
+#endif // __SIEVE_H__
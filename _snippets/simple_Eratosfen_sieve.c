@@ -1,3 +1,4 @@
+// Simple (and racy: threads clear bits of the same bytes) sieve; see sieve.c for segmented one
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
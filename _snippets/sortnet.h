@@ -0,0 +1,460 @@
+/*
+ * sortnet.h - branchless sorting networks for small arrays, their SIMD variants & hybrid sort
+ *
+ * Copyright 2025 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+/*
+ * Header-only library, for each of types int (suffix `int`), float (`float`) & double (`double`):
+ *   sn_net_X(d, n)     - sort n <= SN_MAXN items by network: with constant `n` it is unrolled
+ *                        into chain of min/max (without branches & loads of indexes);
+ *   sn_median_X(d, n)  - median (lower for even n) of n <= SN_MAXN items, `d` isn't changed;
+ *                        unused comparators are removed by compiler (n=9 has own 19-comparator net);
+ *   sn_sortn_X(d, n)   - the same as sn_net_X for any `n` (switch to unrolled networks);
+ *   sn_sort_X(a, n)    - sort of any array: LSD radix sort for n >= SN_RADIXMIN, otherwise
+ *                        introsort with networks for partitions <= SN_BASE items;
+ * SIMD (vertical: v[i] holds i-th item of 8 (4 for double) independent arrays, e.g. windows
+ * of adjacent pixels), with AVX2:
+ *   sn_net_m256i / sn_net_m256 / sn_net_m256d (v, n) - sort;
+ *   sn_median_m256i / sn_median_m256 / sn_median_m256d (v, n) - medians (`v` is changed).
+ * Networks are Batcher's odd-even merge sorts (for 2^k >= n with comparators of
+ * indexes >= n dropped), tables are generated by `sortnet_bench -g`.
+ * Floating-point data shouldn't contain NaNs.
+ */
+
+#pragma once
+#ifndef __SORTNET_H__
+#define __SORTNET_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// max size of network
+#define SN_MAXN         (32)
+// max size of partition to sort by network in introsort
+#ifndef SN_BASE
+#define SN_BASE         (16)
+#endif
+// min size of array for radix sort
+#ifndef SN_RADIXMIN
+#define SN_RADIXMIN     (2048)
+#endif
+
+#define SN_INLINE       inline __attribute__((always_inline))
+#define SN_UNROLL       _Pragma("GCC unroll 256")
+
+/*--- Networks: pairs (i, j) of comparators, min goes to d[i] ---*/
+
+static const uint8_t sn_net2[] = {0,1};
+static const uint8_t sn_net3[] = {0,1, 0,2, 1,2};
+static const uint8_t sn_net4[] = {0,1, 2,3, 0,2, 1,3, 1,2};
+static const uint8_t sn_net5[] = {0,1, 2,3, 0,2, 1,3, 1,2, 0,4, 2,4, 1,2, 3,4};
+static const uint8_t sn_net6[] = {0,1, 2,3, 4,5, 0,2, 1,3, 1,2, 0,4, 1,5, 2,4, 3,5, 1,2, 3,4};
+static const uint8_t sn_net7[] = {0,1, 2,3, 4,5, 0,2, 1,3, 4,6, 1,2, 5,6, 0,4, 1,5, 2,6, 2,4, 3,5,
+	1,2, 3,4, 5,6};
+static const uint8_t sn_net8[] = {0,1, 2,3, 4,5, 6,7, 0,2, 1,3, 4,6, 5,7, 1,2, 5,6, 0,4, 1,5, 2,6,
+	3,7, 2,4, 3,5, 1,2, 3,4, 5,6};
+static const uint8_t sn_net9[] = {0,1, 2,3, 4,5, 6,7, 0,2, 1,3, 4,6, 5,7, 1,2, 5,6, 0,4, 1,5, 2,6,
+	3,7, 2,4, 3,5, 1,2, 3,4, 5,6, 0,8, 4,8, 2,4, 3,5, 6,8, 1,2, 3,4, 5,6, 7,8};
+static const uint8_t sn_net10[] = {0,1, 2,3, 4,5, 6,7, 8,9, 0,2, 1,3, 4,6, 5,7, 1,2, 5,6, 0,4, 1,5,
+	2,6, 3,7, 2,4, 3,5, 1,2, 3,4, 5,6, 0,8, 1,9, 4,8, 5,9, 2,4, 3,5, 6,8, 7,9, 1,2, 3,4, 5,6, 7,8};
+static const uint8_t sn_net11[] = {0,1, 2,3, 4,5, 6,7, 8,9, 0,2, 1,3, 4,6, 5,7, 8,10, 1,2, 5,6, 9,10,
+	0,4, 1,5, 2,6, 3,7, 2,4, 3,5, 1,2, 3,4, 5,6, 9,10, 0,8, 1,9, 2,10, 4,8, 5,9, 6,10, 2,4, 3,5, 6,8,
+	7,9, 1,2, 3,4, 5,6, 7,8, 9,10};
+static const uint8_t sn_net12[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 0,2, 1,3, 4,6, 5,7, 8,10, 9,11,
+	1,2, 5,6, 9,10, 0,4, 1,5, 2,6, 3,7, 2,4, 3,5, 1,2, 3,4, 5,6, 9,10, 0,8, 1,9, 2,10, 3,11, 4,8,
+	5,9, 6,10, 7,11, 2,4, 3,5, 6,8, 7,9, 1,2, 3,4, 5,6, 7,8, 9,10};
+static const uint8_t sn_net13[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 0,2, 1,3, 4,6, 5,7, 8,10, 9,11,
+	1,2, 5,6, 9,10, 0,4, 1,5, 2,6, 3,7, 8,12, 2,4, 3,5, 10,12, 1,2, 3,4, 5,6, 9,10, 11,12, 0,8, 1,9,
+	2,10, 3,11, 4,12, 4,8, 5,9, 6,10, 7,11, 2,4, 3,5, 6,8, 7,9, 10,12, 1,2, 3,4, 5,6, 7,8, 9,10,
+	11,12};
+static const uint8_t sn_net14[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 0,2, 1,3, 4,6, 5,7, 8,10,
+	9,11, 1,2, 5,6, 9,10, 0,4, 1,5, 2,6, 3,7, 8,12, 9,13, 2,4, 3,5, 10,12, 11,13, 1,2, 3,4, 5,6,
+	9,10, 11,12, 0,8, 1,9, 2,10, 3,11, 4,12, 5,13, 4,8, 5,9, 6,10, 7,11, 2,4, 3,5, 6,8, 7,9, 10,12,
+	11,13, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12};
+static const uint8_t sn_net15[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 0,2, 1,3, 4,6, 5,7, 8,10,
+	9,11, 12,14, 1,2, 5,6, 9,10, 13,14, 0,4, 1,5, 2,6, 3,7, 8,12, 9,13, 10,14, 2,4, 3,5, 10,12,
+	11,13, 1,2, 3,4, 5,6, 9,10, 11,12, 13,14, 0,8, 1,9, 2,10, 3,11, 4,12, 5,13, 6,14, 4,8, 5,9, 6,10,
+	7,11, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14};
+static const uint8_t sn_net16[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 0,2, 1,3, 4,6, 5,7,
+	8,10, 9,11, 12,14, 13,15, 1,2, 5,6, 9,10, 13,14, 0,4, 1,5, 2,6, 3,7, 8,12, 9,13, 10,14, 11,15,
+	2,4, 3,5, 10,12, 11,13, 1,2, 3,4, 5,6, 9,10, 11,12, 13,14, 0,8, 1,9, 2,10, 3,11, 4,12, 5,13,
+	6,14, 7,15, 4,8, 5,9, 6,10, 7,11, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 1,2, 3,4, 5,6, 7,8, 9,10,
+	11,12, 13,14};
+static const uint8_t sn_net17[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 0,2, 1,3, 4,6, 5,7,
+	8,10, 9,11, 12,14, 13,15, 1,2, 5,6, 9,10, 13,14, 0,4, 1,5, 2,6, 3,7, 8,12, 9,13, 10,14, 11,15,
+	2,4, 3,5, 10,12, 11,13, 1,2, 3,4, 5,6, 9,10, 11,12, 13,14, 0,8, 1,9, 2,10, 3,11, 4,12, 5,13,
+	6,14, 7,15, 4,8, 5,9, 6,10, 7,11, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 1,2, 3,4, 5,6, 7,8, 9,10,
+	11,12, 13,14, 0,16, 8,16, 4,8, 5,9, 6,10, 7,11, 12,16, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 14,16,
+	1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 15,16};
+static const uint8_t sn_net18[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 16,17, 0,2, 1,3,
+	4,6, 5,7, 8,10, 9,11, 12,14, 13,15, 1,2, 5,6, 9,10, 13,14, 0,4, 1,5, 2,6, 3,7, 8,12, 9,13, 10,14,
+	11,15, 2,4, 3,5, 10,12, 11,13, 1,2, 3,4, 5,6, 9,10, 11,12, 13,14, 0,8, 1,9, 2,10, 3,11, 4,12,
+	5,13, 6,14, 7,15, 4,8, 5,9, 6,10, 7,11, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 1,2, 3,4, 5,6, 7,8,
+	9,10, 11,12, 13,14, 0,16, 1,17, 8,16, 9,17, 4,8, 5,9, 6,10, 7,11, 12,16, 13,17, 2,4, 3,5, 6,8,
+	7,9, 10,12, 11,13, 14,16, 15,17, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 15,16};
+static const uint8_t sn_net19[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 16,17, 0,2, 1,3,
+	4,6, 5,7, 8,10, 9,11, 12,14, 13,15, 16,18, 1,2, 5,6, 9,10, 13,14, 17,18, 0,4, 1,5, 2,6, 3,7,
+	8,12, 9,13, 10,14, 11,15, 2,4, 3,5, 10,12, 11,13, 1,2, 3,4, 5,6, 9,10, 11,12, 13,14, 17,18, 0,8,
+	1,9, 2,10, 3,11, 4,12, 5,13, 6,14, 7,15, 4,8, 5,9, 6,10, 7,11, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13,
+	1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 17,18, 0,16, 1,17, 2,18, 8,16, 9,17, 10,18, 4,8, 5,9,
+	6,10, 7,11, 12,16, 13,17, 14,18, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 14,16, 15,17, 1,2, 3,4, 5,6,
+	7,8, 9,10, 11,12, 13,14, 15,16, 17,18};
+static const uint8_t sn_net20[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 16,17, 18,19, 0,2,
+	1,3, 4,6, 5,7, 8,10, 9,11, 12,14, 13,15, 16,18, 17,19, 1,2, 5,6, 9,10, 13,14, 17,18, 0,4, 1,5,
+	2,6, 3,7, 8,12, 9,13, 10,14, 11,15, 2,4, 3,5, 10,12, 11,13, 1,2, 3,4, 5,6, 9,10, 11,12, 13,14,
+	17,18, 0,8, 1,9, 2,10, 3,11, 4,12, 5,13, 6,14, 7,15, 4,8, 5,9, 6,10, 7,11, 2,4, 3,5, 6,8, 7,9,
+	10,12, 11,13, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 17,18, 0,16, 1,17, 2,18, 3,19, 8,16, 9,17,
+	10,18, 11,19, 4,8, 5,9, 6,10, 7,11, 12,16, 13,17, 14,18, 15,19, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13,
+	14,16, 15,17, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 15,16, 17,18};
+static const uint8_t sn_net21[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 16,17, 18,19, 0,2,
+	1,3, 4,6, 5,7, 8,10, 9,11, 12,14, 13,15, 16,18, 17,19, 1,2, 5,6, 9,10, 13,14, 17,18, 0,4, 1,5,
+	2,6, 3,7, 8,12, 9,13, 10,14, 11,15, 16,20, 2,4, 3,5, 10,12, 11,13, 18,20, 1,2, 3,4, 5,6, 9,10,
+	11,12, 13,14, 17,18, 19,20, 0,8, 1,9, 2,10, 3,11, 4,12, 5,13, 6,14, 7,15, 4,8, 5,9, 6,10, 7,11,
+	2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 18,20, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 17,18, 19,20,
+	0,16, 1,17, 2,18, 3,19, 4,20, 8,16, 9,17, 10,18, 11,19, 12,20, 4,8, 5,9, 6,10, 7,11, 12,16,
+	13,17, 14,18, 15,19, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 14,16, 15,17, 18,20, 1,2, 3,4, 5,6, 7,8,
+	9,10, 11,12, 13,14, 15,16, 17,18, 19,20};
+static const uint8_t sn_net22[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 16,17, 18,19, 20,21,
+	0,2, 1,3, 4,6, 5,7, 8,10, 9,11, 12,14, 13,15, 16,18, 17,19, 1,2, 5,6, 9,10, 13,14, 17,18, 0,4,
+	1,5, 2,6, 3,7, 8,12, 9,13, 10,14, 11,15, 16,20, 17,21, 2,4, 3,5, 10,12, 11,13, 18,20, 19,21, 1,2,
+	3,4, 5,6, 9,10, 11,12, 13,14, 17,18, 19,20, 0,8, 1,9, 2,10, 3,11, 4,12, 5,13, 6,14, 7,15, 4,8,
+	5,9, 6,10, 7,11, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 18,20, 19,21, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12,
+	13,14, 17,18, 19,20, 0,16, 1,17, 2,18, 3,19, 4,20, 5,21, 8,16, 9,17, 10,18, 11,19, 12,20, 13,21,
+	4,8, 5,9, 6,10, 7,11, 12,16, 13,17, 14,18, 15,19, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 14,16, 15,17,
+	18,20, 19,21, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 15,16, 17,18, 19,20};
+static const uint8_t sn_net23[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 16,17, 18,19, 20,21,
+	0,2, 1,3, 4,6, 5,7, 8,10, 9,11, 12,14, 13,15, 16,18, 17,19, 20,22, 1,2, 5,6, 9,10, 13,14, 17,18,
+	21,22, 0,4, 1,5, 2,6, 3,7, 8,12, 9,13, 10,14, 11,15, 16,20, 17,21, 18,22, 2,4, 3,5, 10,12, 11,13,
+	18,20, 19,21, 1,2, 3,4, 5,6, 9,10, 11,12, 13,14, 17,18, 19,20, 21,22, 0,8, 1,9, 2,10, 3,11, 4,12,
+	5,13, 6,14, 7,15, 4,8, 5,9, 6,10, 7,11, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 18,20, 19,21, 1,2, 3,4,
+	5,6, 7,8, 9,10, 11,12, 13,14, 17,18, 19,20, 21,22, 0,16, 1,17, 2,18, 3,19, 4,20, 5,21, 6,22,
+	8,16, 9,17, 10,18, 11,19, 12,20, 13,21, 14,22, 4,8, 5,9, 6,10, 7,11, 12,16, 13,17, 14,18, 15,19,
+	2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 14,16, 15,17, 18,20, 19,21, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12,
+	13,14, 15,16, 17,18, 19,20, 21,22};
+static const uint8_t sn_net24[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 16,17, 18,19, 20,21,
+	22,23, 0,2, 1,3, 4,6, 5,7, 8,10, 9,11, 12,14, 13,15, 16,18, 17,19, 20,22, 21,23, 1,2, 5,6, 9,10,
+	13,14, 17,18, 21,22, 0,4, 1,5, 2,6, 3,7, 8,12, 9,13, 10,14, 11,15, 16,20, 17,21, 18,22, 19,23,
+	2,4, 3,5, 10,12, 11,13, 18,20, 19,21, 1,2, 3,4, 5,6, 9,10, 11,12, 13,14, 17,18, 19,20, 21,22,
+	0,8, 1,9, 2,10, 3,11, 4,12, 5,13, 6,14, 7,15, 4,8, 5,9, 6,10, 7,11, 2,4, 3,5, 6,8, 7,9, 10,12,
+	11,13, 18,20, 19,21, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 17,18, 19,20, 21,22, 0,16, 1,17,
+	2,18, 3,19, 4,20, 5,21, 6,22, 7,23, 8,16, 9,17, 10,18, 11,19, 12,20, 13,21, 14,22, 15,23, 4,8,
+	5,9, 6,10, 7,11, 12,16, 13,17, 14,18, 15,19, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 14,16, 15,17,
+	18,20, 19,21, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 15,16, 17,18, 19,20, 21,22};
+static const uint8_t sn_net25[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 16,17, 18,19, 20,21,
+	22,23, 0,2, 1,3, 4,6, 5,7, 8,10, 9,11, 12,14, 13,15, 16,18, 17,19, 20,22, 21,23, 1,2, 5,6, 9,10,
+	13,14, 17,18, 21,22, 0,4, 1,5, 2,6, 3,7, 8,12, 9,13, 10,14, 11,15, 16,20, 17,21, 18,22, 19,23,
+	2,4, 3,5, 10,12, 11,13, 18,20, 19,21, 1,2, 3,4, 5,6, 9,10, 11,12, 13,14, 17,18, 19,20, 21,22,
+	0,8, 1,9, 2,10, 3,11, 4,12, 5,13, 6,14, 7,15, 16,24, 4,8, 5,9, 6,10, 7,11, 20,24, 2,4, 3,5, 6,8,
+	7,9, 10,12, 11,13, 18,20, 19,21, 22,24, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 17,18, 19,20,
+	21,22, 23,24, 0,16, 1,17, 2,18, 3,19, 4,20, 5,21, 6,22, 7,23, 8,24, 8,16, 9,17, 10,18, 11,19,
+	12,20, 13,21, 14,22, 15,23, 4,8, 5,9, 6,10, 7,11, 12,16, 13,17, 14,18, 15,19, 20,24, 2,4, 3,5,
+	6,8, 7,9, 10,12, 11,13, 14,16, 15,17, 18,20, 19,21, 22,24, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12,
+	13,14, 15,16, 17,18, 19,20, 21,22, 23,24};
+static const uint8_t sn_net26[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 16,17, 18,19, 20,21,
+	22,23, 24,25, 0,2, 1,3, 4,6, 5,7, 8,10, 9,11, 12,14, 13,15, 16,18, 17,19, 20,22, 21,23, 1,2, 5,6,
+	9,10, 13,14, 17,18, 21,22, 0,4, 1,5, 2,6, 3,7, 8,12, 9,13, 10,14, 11,15, 16,20, 17,21, 18,22,
+	19,23, 2,4, 3,5, 10,12, 11,13, 18,20, 19,21, 1,2, 3,4, 5,6, 9,10, 11,12, 13,14, 17,18, 19,20,
+	21,22, 0,8, 1,9, 2,10, 3,11, 4,12, 5,13, 6,14, 7,15, 16,24, 17,25, 4,8, 5,9, 6,10, 7,11, 20,24,
+	21,25, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 18,20, 19,21, 22,24, 23,25, 1,2, 3,4, 5,6, 7,8, 9,10,
+	11,12, 13,14, 17,18, 19,20, 21,22, 23,24, 0,16, 1,17, 2,18, 3,19, 4,20, 5,21, 6,22, 7,23, 8,24,
+	9,25, 8,16, 9,17, 10,18, 11,19, 12,20, 13,21, 14,22, 15,23, 4,8, 5,9, 6,10, 7,11, 12,16, 13,17,
+	14,18, 15,19, 20,24, 21,25, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 14,16, 15,17, 18,20, 19,21, 22,24,
+	23,25, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 15,16, 17,18, 19,20, 21,22, 23,24};
+static const uint8_t sn_net27[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 16,17, 18,19, 20,21,
+	22,23, 24,25, 0,2, 1,3, 4,6, 5,7, 8,10, 9,11, 12,14, 13,15, 16,18, 17,19, 20,22, 21,23, 24,26,
+	1,2, 5,6, 9,10, 13,14, 17,18, 21,22, 25,26, 0,4, 1,5, 2,6, 3,7, 8,12, 9,13, 10,14, 11,15, 16,20,
+	17,21, 18,22, 19,23, 2,4, 3,5, 10,12, 11,13, 18,20, 19,21, 1,2, 3,4, 5,6, 9,10, 11,12, 13,14,
+	17,18, 19,20, 21,22, 25,26, 0,8, 1,9, 2,10, 3,11, 4,12, 5,13, 6,14, 7,15, 16,24, 17,25, 18,26,
+	4,8, 5,9, 6,10, 7,11, 20,24, 21,25, 22,26, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 18,20, 19,21, 22,24,
+	23,25, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 17,18, 19,20, 21,22, 23,24, 25,26, 0,16, 1,17,
+	2,18, 3,19, 4,20, 5,21, 6,22, 7,23, 8,24, 9,25, 10,26, 8,16, 9,17, 10,18, 11,19, 12,20, 13,21,
+	14,22, 15,23, 4,8, 5,9, 6,10, 7,11, 12,16, 13,17, 14,18, 15,19, 20,24, 21,25, 22,26, 2,4, 3,5,
+	6,8, 7,9, 10,12, 11,13, 14,16, 15,17, 18,20, 19,21, 22,24, 23,25, 1,2, 3,4, 5,6, 7,8, 9,10,
+	11,12, 13,14, 15,16, 17,18, 19,20, 21,22, 23,24, 25,26};
+static const uint8_t sn_net28[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 16,17, 18,19, 20,21,
+	22,23, 24,25, 26,27, 0,2, 1,3, 4,6, 5,7, 8,10, 9,11, 12,14, 13,15, 16,18, 17,19, 20,22, 21,23,
+	24,26, 25,27, 1,2, 5,6, 9,10, 13,14, 17,18, 21,22, 25,26, 0,4, 1,5, 2,6, 3,7, 8,12, 9,13, 10,14,
+	11,15, 16,20, 17,21, 18,22, 19,23, 2,4, 3,5, 10,12, 11,13, 18,20, 19,21, 1,2, 3,4, 5,6, 9,10,
+	11,12, 13,14, 17,18, 19,20, 21,22, 25,26, 0,8, 1,9, 2,10, 3,11, 4,12, 5,13, 6,14, 7,15, 16,24,
+	17,25, 18,26, 19,27, 4,8, 5,9, 6,10, 7,11, 20,24, 21,25, 22,26, 23,27, 2,4, 3,5, 6,8, 7,9, 10,12,
+	11,13, 18,20, 19,21, 22,24, 23,25, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 17,18, 19,20, 21,22,
+	23,24, 25,26, 0,16, 1,17, 2,18, 3,19, 4,20, 5,21, 6,22, 7,23, 8,24, 9,25, 10,26, 11,27, 8,16,
+	9,17, 10,18, 11,19, 12,20, 13,21, 14,22, 15,23, 4,8, 5,9, 6,10, 7,11, 12,16, 13,17, 14,18, 15,19,
+	20,24, 21,25, 22,26, 23,27, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 14,16, 15,17, 18,20, 19,21, 22,24,
+	23,25, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 15,16, 17,18, 19,20, 21,22, 23,24, 25,26};
+static const uint8_t sn_net29[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 16,17, 18,19, 20,21,
+	22,23, 24,25, 26,27, 0,2, 1,3, 4,6, 5,7, 8,10, 9,11, 12,14, 13,15, 16,18, 17,19, 20,22, 21,23,
+	24,26, 25,27, 1,2, 5,6, 9,10, 13,14, 17,18, 21,22, 25,26, 0,4, 1,5, 2,6, 3,7, 8,12, 9,13, 10,14,
+	11,15, 16,20, 17,21, 18,22, 19,23, 24,28, 2,4, 3,5, 10,12, 11,13, 18,20, 19,21, 26,28, 1,2, 3,4,
+	5,6, 9,10, 11,12, 13,14, 17,18, 19,20, 21,22, 25,26, 27,28, 0,8, 1,9, 2,10, 3,11, 4,12, 5,13,
+	6,14, 7,15, 16,24, 17,25, 18,26, 19,27, 20,28, 4,8, 5,9, 6,10, 7,11, 20,24, 21,25, 22,26, 23,27,
+	2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 18,20, 19,21, 22,24, 23,25, 26,28, 1,2, 3,4, 5,6, 7,8, 9,10,
+	11,12, 13,14, 17,18, 19,20, 21,22, 23,24, 25,26, 27,28, 0,16, 1,17, 2,18, 3,19, 4,20, 5,21, 6,22,
+	7,23, 8,24, 9,25, 10,26, 11,27, 12,28, 8,16, 9,17, 10,18, 11,19, 12,20, 13,21, 14,22, 15,23, 4,8,
+	5,9, 6,10, 7,11, 12,16, 13,17, 14,18, 15,19, 20,24, 21,25, 22,26, 23,27, 2,4, 3,5, 6,8, 7,9,
+	10,12, 11,13, 14,16, 15,17, 18,20, 19,21, 22,24, 23,25, 26,28, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12,
+	13,14, 15,16, 17,18, 19,20, 21,22, 23,24, 25,26, 27,28};
+static const uint8_t sn_net30[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 16,17, 18,19, 20,21,
+	22,23, 24,25, 26,27, 28,29, 0,2, 1,3, 4,6, 5,7, 8,10, 9,11, 12,14, 13,15, 16,18, 17,19, 20,22,
+	21,23, 24,26, 25,27, 1,2, 5,6, 9,10, 13,14, 17,18, 21,22, 25,26, 0,4, 1,5, 2,6, 3,7, 8,12, 9,13,
+	10,14, 11,15, 16,20, 17,21, 18,22, 19,23, 24,28, 25,29, 2,4, 3,5, 10,12, 11,13, 18,20, 19,21,
+	26,28, 27,29, 1,2, 3,4, 5,6, 9,10, 11,12, 13,14, 17,18, 19,20, 21,22, 25,26, 27,28, 0,8, 1,9,
+	2,10, 3,11, 4,12, 5,13, 6,14, 7,15, 16,24, 17,25, 18,26, 19,27, 20,28, 21,29, 4,8, 5,9, 6,10,
+	7,11, 20,24, 21,25, 22,26, 23,27, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 18,20, 19,21, 22,24, 23,25,
+	26,28, 27,29, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 17,18, 19,20, 21,22, 23,24, 25,26, 27,28,
+	0,16, 1,17, 2,18, 3,19, 4,20, 5,21, 6,22, 7,23, 8,24, 9,25, 10,26, 11,27, 12,28, 13,29, 8,16,
+	9,17, 10,18, 11,19, 12,20, 13,21, 14,22, 15,23, 4,8, 5,9, 6,10, 7,11, 12,16, 13,17, 14,18, 15,19,
+	20,24, 21,25, 22,26, 23,27, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 14,16, 15,17, 18,20, 19,21, 22,24,
+	23,25, 26,28, 27,29, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 15,16, 17,18, 19,20, 21,22, 23,24,
+	25,26, 27,28};
+static const uint8_t sn_net31[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 16,17, 18,19, 20,21,
+	22,23, 24,25, 26,27, 28,29, 0,2, 1,3, 4,6, 5,7, 8,10, 9,11, 12,14, 13,15, 16,18, 17,19, 20,22,
+	21,23, 24,26, 25,27, 28,30, 1,2, 5,6, 9,10, 13,14, 17,18, 21,22, 25,26, 29,30, 0,4, 1,5, 2,6,
+	3,7, 8,12, 9,13, 10,14, 11,15, 16,20, 17,21, 18,22, 19,23, 24,28, 25,29, 26,30, 2,4, 3,5, 10,12,
+	11,13, 18,20, 19,21, 26,28, 27,29, 1,2, 3,4, 5,6, 9,10, 11,12, 13,14, 17,18, 19,20, 21,22, 25,26,
+	27,28, 29,30, 0,8, 1,9, 2,10, 3,11, 4,12, 5,13, 6,14, 7,15, 16,24, 17,25, 18,26, 19,27, 20,28,
+	21,29, 22,30, 4,8, 5,9, 6,10, 7,11, 20,24, 21,25, 22,26, 23,27, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13,
+	18,20, 19,21, 22,24, 23,25, 26,28, 27,29, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 17,18, 19,20,
+	21,22, 23,24, 25,26, 27,28, 29,30, 0,16, 1,17, 2,18, 3,19, 4,20, 5,21, 6,22, 7,23, 8,24, 9,25,
+	10,26, 11,27, 12,28, 13,29, 14,30, 8,16, 9,17, 10,18, 11,19, 12,20, 13,21, 14,22, 15,23, 4,8,
+	5,9, 6,10, 7,11, 12,16, 13,17, 14,18, 15,19, 20,24, 21,25, 22,26, 23,27, 2,4, 3,5, 6,8, 7,9,
+	10,12, 11,13, 14,16, 15,17, 18,20, 19,21, 22,24, 23,25, 26,28, 27,29, 1,2, 3,4, 5,6, 7,8, 9,10,
+	11,12, 13,14, 15,16, 17,18, 19,20, 21,22, 23,24, 25,26, 27,28, 29,30};
+static const uint8_t sn_net32[] = {0,1, 2,3, 4,5, 6,7, 8,9, 10,11, 12,13, 14,15, 16,17, 18,19, 20,21,
+	22,23, 24,25, 26,27, 28,29, 30,31, 0,2, 1,3, 4,6, 5,7, 8,10, 9,11, 12,14, 13,15, 16,18, 17,19,
+	20,22, 21,23, 24,26, 25,27, 28,30, 29,31, 1,2, 5,6, 9,10, 13,14, 17,18, 21,22, 25,26, 29,30, 0,4,
+	1,5, 2,6, 3,7, 8,12, 9,13, 10,14, 11,15, 16,20, 17,21, 18,22, 19,23, 24,28, 25,29, 26,30, 27,31,
+	2,4, 3,5, 10,12, 11,13, 18,20, 19,21, 26,28, 27,29, 1,2, 3,4, 5,6, 9,10, 11,12, 13,14, 17,18,
+	19,20, 21,22, 25,26, 27,28, 29,30, 0,8, 1,9, 2,10, 3,11, 4,12, 5,13, 6,14, 7,15, 16,24, 17,25,
+	18,26, 19,27, 20,28, 21,29, 22,30, 23,31, 4,8, 5,9, 6,10, 7,11, 20,24, 21,25, 22,26, 23,27, 2,4,
+	3,5, 6,8, 7,9, 10,12, 11,13, 18,20, 19,21, 22,24, 23,25, 26,28, 27,29, 1,2, 3,4, 5,6, 7,8, 9,10,
+	11,12, 13,14, 17,18, 19,20, 21,22, 23,24, 25,26, 27,28, 29,30, 0,16, 1,17, 2,18, 3,19, 4,20,
+	5,21, 6,22, 7,23, 8,24, 9,25, 10,26, 11,27, 12,28, 13,29, 14,30, 15,31, 8,16, 9,17, 10,18, 11,19,
+	12,20, 13,21, 14,22, 15,23, 4,8, 5,9, 6,10, 7,11, 12,16, 13,17, 14,18, 15,19, 20,24, 21,25,
+	22,26, 23,27, 2,4, 3,5, 6,8, 7,9, 10,12, 11,13, 14,16, 15,17, 18,20, 19,21, 22,24, 23,25, 26,28,
+	27,29, 1,2, 3,4, 5,6, 7,8, 9,10, 11,12, 13,14, 15,16, 17,18, 19,20, 21,22, 23,24, 25,26, 27,28,
+	29,30};
+
+static const uint8_t *const sn_net[SN_MAXN + 1] = {NULL, NULL,
+	sn_net2, sn_net3, sn_net4, sn_net5, sn_net6, sn_net7, sn_net8, sn_net9, sn_net10, sn_net11,
+	sn_net12, sn_net13, sn_net14, sn_net15, sn_net16, sn_net17, sn_net18, sn_net19, sn_net20,
+	sn_net21, sn_net22, sn_net23, sn_net24, sn_net25, sn_net26, sn_net27, sn_net28, sn_net29,
+	sn_net30, sn_net31, sn_net32};
+
+// amount of comparators
+#define SN_LEN(n)   (sizeof(sn_net##n) / 2)
+static const uint16_t sn_netlen[SN_MAXN + 1] = {0, 0,
+	SN_LEN(2), SN_LEN(3), SN_LEN(4), SN_LEN(5), SN_LEN(6), SN_LEN(7), SN_LEN(8), SN_LEN(9),
+	SN_LEN(10), SN_LEN(11), SN_LEN(12), SN_LEN(13), SN_LEN(14), SN_LEN(15), SN_LEN(16),
+	SN_LEN(17), SN_LEN(18), SN_LEN(19), SN_LEN(20), SN_LEN(21), SN_LEN(22), SN_LEN(23),
+	SN_LEN(24), SN_LEN(25), SN_LEN(26), SN_LEN(27), SN_LEN(28), SN_LEN(29), SN_LEN(30),
+	SN_LEN(31), SN_LEN(32)};
+#undef SN_LEN
+
+// median of 9 (A.W.Paeth, Graphics Gems)
+static const uint8_t sn_med9[] = {1,2, 4,5, 7,8, 0,1, 3,4, 6,7, 1,2, 4,5, 7,8, 0,3, 5,8, 4,7,
+	3,6, 1,4, 2,5, 4,7, 4,2, 6,4, 4,2};
+
+// network (or median network if `med`) for n items
+#define SN_TABLE(n, med, t, len) do{ \
+	if((med) && (n) == 9){ t = sn_med9; len = sizeof(sn_med9) / 2; } \
+	else{ t = sn_net[n]; len = sn_netlen[n]; } \
+}while(0)
+
+// switch by constant sizes: f(d, 2) ... f(d, 32)
+#define SN_CASES(f, d) \
+	case 2: f(d, 2); break; case 3: f(d, 3); break; case 4: f(d, 4); break; \
+	case 5: f(d, 5); break; case 6: f(d, 6); break; case 7: f(d, 7); break; \
+	case 8: f(d, 8); break; case 9: f(d, 9); break; case 10: f(d, 10); break; \
+	case 11: f(d, 11); break; case 12: f(d, 12); break; case 13: f(d, 13); break; \
+	case 14: f(d, 14); break; case 15: f(d, 15); break; case 16: f(d, 16); break; \
+	case 17: f(d, 17); break; case 18: f(d, 18); break; case 19: f(d, 19); break; \
+	case 20: f(d, 20); break; case 21: f(d, 21); break; case 22: f(d, 22); break; \
+	case 23: f(d, 23); break; case 24: f(d, 24); break; case 25: f(d, 25); break; \
+	case 26: f(d, 26); break; case 27: f(d, 27); break; case 28: f(d, 28); break; \
+	case 29: f(d, 29); break; case 30: f(d, 30); break; case 31: f(d, 31); break; \
+	case 32: f(d, 32); break; default: break;
+
+/*--- Keys for radix sort (unsigned with the same order) ---*/
+
+static inline uint32_t sn_key_int(int x){ return (uint32_t)x ^ 0x80000000u; }
+static inline int sn_unkey_int(uint32_t k){ return (int)(k ^ 0x80000000u); }
+static inline uint32_t sn_key_float(float x){
+	uint32_t u;
+	memcpy(&u, &x, 4);
+	return u ^ ((uint32_t)((int32_t)u >> 31) | 0x80000000u);
+}
+static inline float sn_unkey_float(uint32_t k){
+	float x;
+	k ^= ((k >> 31) - 1) | 0x80000000u;
+	memcpy(&x, &k, 4);
+	return x;
+}
+static inline uint64_t sn_key_double(double x){
+	uint64_t u;
+	memcpy(&u, &x, 8);
+	return u ^ ((uint64_t)((int64_t)u >> 63) | 0x8000000000000000ull);
+}
+static inline double sn_unkey_double(uint64_t k){
+	double x;
+	k ^= ((k >> 63) - 1) | 0x8000000000000000ull;
+	memcpy(&x, &k, 8);
+	return x;
+}
+
+/*--- Functions for type T (keys of radix sort have type UT) ---*/
+
+#define SN_DEFINE(T, sfx, UT) \
+static SN_INLINE void sn_apply_##sfx(T *d, const uint8_t *t, int len){ \
+	SN_UNROLL \
+	for(int c = 0; c < len; ++c){ \
+		T x = d[t[2*c]], y = d[t[2*c+1]]; \
+		d[t[2*c]] = (y < x) ? y : x; /* separate conditions: minss/maxss, not branches */ \
+		d[t[2*c+1]] = (x < y) ? y : x; \
+	} \
+} \
+static SN_INLINE void sn_net_##sfx(T *d, int n){ \
+	if(n < 2 || n > SN_MAXN) return; \
+	sn_apply_##sfx(d, sn_net[n], sn_netlen[n]); \
+} \
+static SN_INLINE T sn_median_##sfx(const T *d, int n){ \
+	T v[SN_MAXN]; \
+	const uint8_t *t; \
+	int len; \
+	if(n < 1 || n > SN_MAXN) return (T)0; \
+	for(int i = 0; i < n; ++i) v[i] = d[i]; \
+	if(n < 2) return v[0]; \
+	SN_TABLE(n, 1, t, len); \
+	sn_apply_##sfx(v, t, len); \
+	return v[(n - 1) / 2]; \
+} \
+static inline void sn_sortn_##sfx(T *d, int n){ \
+	switch(n){ SN_CASES(sn_net_##sfx, d) } \
+} \
+static inline void sn_sift_##sfx(T *a, size_t s, size_t n){ \
+	T v = a[s]; \
+	for(size_t c; (c = 2 * s + 1) < n; s = c){ \
+		if(c + 1 < n && a[c] < a[c+1]) ++c; \
+		if(!(v < a[c])) break; \
+		a[s] = a[c]; \
+	} \
+	a[s] = v; \
+} \
+static inline void sn_heapsort_##sfx(T *a, size_t n){ \
+	for(size_t k = n / 2; k-- > 0;) sn_sift_##sfx(a, k, n); \
+	for(size_t m = n; m-- > 1;){ \
+		T v = a[m]; a[m] = a[0]; a[0] = v; \
+		sn_sift_##sfx(a, 0, m); \
+	} \
+} \
+static inline void sn_introsort_##sfx(T *a, size_t n, int depth){ \
+	while(n > SN_BASE){ \
+		if(depth-- == 0){ sn_heapsort_##sfx(a, n); return; } \
+		T s[3] = {a[0], a[n/2], a[n-1]}; \
+		sn_net_##sfx(s, 3); \
+		a[0] = s[0]; a[n/2] = s[1]; a[n-1] = s[2]; \
+		T p = s[1]; \
+		size_t i = 0, j = n - 1; \
+		for(;;){ /* Hoare partition: a[0] <= p & a[n-1] >= p are sentinels */ \
+			while(a[++i] < p); \
+			while(p < a[--j]); \
+			if(i >= j) break; \
+			T x = a[i]; a[i] = a[j]; a[j] = x; \
+		} \
+		/* [0, j] <= p <= [j+1, n): recursion for the smaller part */ \
+		if(j + 1 < n - j - 1){ \
+			sn_introsort_##sfx(a, j + 1, depth); \
+			a += j + 1; n -= j + 1; \
+		}else{ \
+			sn_introsort_##sfx(a + j + 1, n - j - 1, depth); \
+			n = j + 1; \
+		} \
+	} \
+	sn_sortn_##sfx(a, (int)n); \
+} \
+static inline int sn_radix_##sfx(T *a, size_t n){ \
+	UT *buf = malloc(2 * n * sizeof(UT)), *k = buf, *t = buf + n; \
+	size_t cnt[sizeof(UT)][256]; \
+	if(!buf) return -1; \
+	memset(cnt, 0, sizeof(cnt)); \
+	for(size_t i = 0; i < n; ++i){ \
+		UT x = k[i] = sn_key_##sfx(a[i]); \
+		for(size_t b = 0; b < sizeof(UT); ++b) ++cnt[b][(x >> (8 * b)) & 0xff]; \
+	} \
+	for(size_t b = 0; b < sizeof(UT); ++b){ \
+		size_t *c = cnt[b], sum = 0; \
+		int sh = 8 * b; \
+		if(c[(k[0] >> sh) & 0xff] == n) continue; /* all items have the same digit */ \
+		for(int d = 0; d < 256; ++d){ size_t x = c[d]; c[d] = sum; sum += x; } \
+		for(size_t i = 0; i < n; ++i) t[c[(k[i] >> sh) & 0xff]++] = k[i]; \
+		UT *x = k; k = t; t = x; \
+	} \
+	for(size_t i = 0; i < n; ++i) a[i] = sn_unkey_##sfx(k[i]); \
+	free(buf); \
+	return 0; \
+} \
+static inline void sn_sort_##sfx(T *a, size_t n){ \
+	if(n >= SN_RADIXMIN && !sn_radix_##sfx(a, n)) return; \
+	int depth = 0; \
+	for(size_t x = n; x; x >>= 1) depth += 2; \
+	sn_introsort_##sfx(a, n, depth); \
+}
+
+SN_DEFINE(int, int, uint32_t)
+SN_DEFINE(float, float, uint32_t)
+SN_DEFINE(double, double, uint64_t)
+
+/*--- SIMD: each comparator processes 8 (4 for double) arrays at once ---*/
+
+#ifdef __AVX2__
+#define SN_DEFINE_SIMD(V, MIN, MAX) \
+static SN_INLINE void sn_apply_##V(V *v, const uint8_t *t, int len){ \
+	SN_UNROLL \
+	for(int c = 0; c < len; ++c){ \
+		V x = v[t[2*c]], y = v[t[2*c+1]]; \
+		v[t[2*c]] = MIN(x, y); \
+		v[t[2*c+1]] = MAX(x, y); \
+	} \
+} \
+static SN_INLINE void sn_net_##V(V *v, int n){ \
+	if(n < 2 || n > SN_MAXN) return; \
+	sn_apply_##V(v, sn_net[n], sn_netlen[n]); \
+} \
+static SN_INLINE V sn_median_##V(V *v, int n){ \
+	const uint8_t *t; \
+	int len; \
+	if(n > 1 && n <= SN_MAXN){ \
+		SN_TABLE(n, 1, t, len); \
+		sn_apply_##V(v, t, len); \
+	} \
+	return v[(n - 1) / 2]; \
+}
+
+SN_DEFINE_SIMD(__m256i, _mm256_min_epi32, _mm256_max_epi32)
+SN_DEFINE_SIMD(__m256, _mm256_min_ps, _mm256_max_ps)
+SN_DEFINE_SIMD(__m256d, _mm256_min_pd, _mm256_max_pd)
+#undef SN_DEFINE_SIMD
+#endif // __AVX2__
+
+#endif // __SORTNET_H__
@@ -0,0 +1,329 @@
+/*
+ * sortnet_bench.c - tests & benchmark of sortnet.h
+ *
+ * Copyright 2025 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+// compile: gcc -O2 -march=native sortnet_bench.c -o sortnet_bench
+// run: ./sortnet_bench (tests & timings) or ./sortnet_bench -g (print tables of networks for sortnet.h)
+
+#include <err.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "sortnet.h"
+
+static __inline__ unsigned long long rdtsc(void){
+	unsigned hi, lo;
+	__asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
+	return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
+}
+
+static double dtime(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Batcher's odd-even merge sort for 2^k >= n, comparators with indexes >= n are dropped
+static void gen_tables(){
+	for(int n = 2; n <= SN_MAXN; ++n){
+		int N = 1, np = 0, col;
+		while(N < n) N <<= 1;
+		col = printf("static const uint8_t sn_net%d[] = {", n);
+		for(int p = 1; p < N; p <<= 1)
+			for(int k = p; k >= 1; k >>= 1)
+				for(int j = k % p; j + k < N; j += 2*k)
+					for(int i = 0; i < k && i + j + k < N; ++i){
+						int a = i + j, b = i + j + k;
+						if(b >= n || a / (2*p) != b / (2*p)) continue;
+						char buf[16];
+						int l = snprintf(buf, 16, "%s%d,%d", np ? ", " : "", a, b);
+						if(col + l > 100){
+							printf(",\n\t");
+							col = 4;
+							l = snprintf(buf, 16, "%d,%d", a, b);
+						}
+						col += printf("%s", buf);
+						++np;
+					}
+		printf("};\n");
+	}
+}
+
+#define CMPFN(T, sfx) \
+static int cmp_##sfx(const void *a, const void *b){ \
+	T x = *(const T*)a, y = *(const T*)b; \
+	return (x < y) ? -1 : (y < x); \
+} \
+static void insort_##sfx(T *d, int n){ \
+	for(int i = 1; i < n; ++i){ \
+		T v = d[i]; \
+		int j = i; \
+		for(; j > 0 && v < d[j-1]; --j) d[j] = d[j-1]; \
+		d[j] = v; \
+	} \
+}
+CMPFN(int, int)
+CMPFN(float, float)
+CMPFN(double, double)
+
+/*--- Tests ---*/
+
+#define TESTS(T, sfx, RND) \
+static void test_##sfx(){ \
+	T d[SN_MAXN], r[SN_MAXN]; \
+	for(int n = 1; n <= SN_MAXN; ++n) for(int iter = 0; iter < 10000; ++iter){ \
+		int range = (iter & 1) ? 4 : 1000000; /* with & without repeats */ \
+		for(int i = 0; i < n; ++i) d[i] = r[i] = (T)(RND % range) - range / 2; \
+		qsort(r, n, sizeof(T), cmp_##sfx); \
+		if(sn_median_##sfx(d, n) != r[(n-1)/2]) errx(1, #sfx ": median of %d", n); \
+		sn_sortn_##sfx(d, n); \
+		if(memcmp(d, r, n * sizeof(T))) errx(1, #sfx ": network %d", n); \
+	} \
+	static const size_t sizes[] = {0, 1, 2, 17, 33, 100, 1000, SN_RADIXMIN - 1, SN_RADIXMIN, 100000, 1000000}; \
+	size_t maxn = sizes[sizeof(sizes)/sizeof(sizes[0]) - 1]; \
+	T *a = malloc(maxn * sizeof(T)), *b = malloc(maxn * sizeof(T)), *c = malloc(maxn * sizeof(T)); \
+	for(size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); ++s) for(int kind = 0; kind < 4; ++kind){ \
+		size_t n = sizes[s]; \
+		for(size_t i = 0; i < n; ++i){ \
+			switch(kind){ \
+				case 0: a[i] = (T)RND - (T)(RAND_MAX / 2); break; /* random */ \
+				case 1: a[i] = (T)(RND % 16); break;              /* many repeats */ \
+				case 2: a[i] = (T)i; break;                       /* sorted */ \
+				default: a[i] = (T)(n - i);                       /* reversed */ \
+			} \
+		} \
+		memcpy(b, a, n * sizeof(T)); \
+		memcpy(c, a, n * sizeof(T)); \
+		qsort(b, n, sizeof(T), cmp_##sfx); \
+		sn_sort_##sfx(a, n); \
+		if(memcmp(a, b, n * sizeof(T))) errx(1, #sfx ": sn_sort of %zd items (kind %d)", n, kind); \
+		memcpy(a, c, n * sizeof(T)); \
+		sn_introsort_##sfx(a, n, 64); \
+		if(memcmp(a, b, n * sizeof(T))) errx(1, #sfx ": introsort of %zd items (kind %d)", n, kind); \
+		memcpy(a, c, n * sizeof(T)); \
+		sn_introsort_##sfx(a, n, 0); \
+		if(memcmp(a, b, n * sizeof(T))) errx(1, #sfx ": heapsort of %zd items (kind %d)", n, kind); \
+	} \
+	free(a); free(b); free(c); \
+}
+TESTS(int, int, rand())
+TESTS(float, float, rand())
+TESTS(double, double, rand())
+
+#ifdef __AVX2__
+static void test_simd(){
+	for(int n = 2; n <= SN_MAXN; ++n) for(int iter = 0; iter < 1000; ++iter){
+		int di[SN_MAXN][8];
+		float df[SN_MAXN][8];
+		double dd[SN_MAXN][4];
+		__m256i vi[SN_MAXN], mi[SN_MAXN];
+		__m256 vf[SN_MAXN], mf[SN_MAXN];
+		__m256d vd[SN_MAXN], md[SN_MAXN];
+		for(int i = 0; i < n; ++i){
+			for(int l = 0; l < 8; ++l){
+				di[i][l] = rand() % 1000 - 500;
+				df[i][l] = (float)di[i][l];
+			}
+			for(int l = 0; l < 4; ++l) dd[i][l] = (double)di[i][l];
+			mi[i] = vi[i] = _mm256_loadu_si256((const __m256i*)di[i]);
+			mf[i] = vf[i] = _mm256_loadu_ps(df[i]);
+			md[i] = vd[i] = _mm256_loadu_pd(dd[i]);
+		}
+		sn_net___m256i(vi, n);
+		sn_net___m256(vf, n);
+		sn_net___m256d(vd, n);
+		int medi[8];
+		float medf[8];
+		double medd[4];
+		_mm256_storeu_si256((__m256i*)medi, sn_median___m256i(mi, n));
+		_mm256_storeu_ps(medf, sn_median___m256(mf, n));
+		_mm256_storeu_pd(medd, sn_median___m256d(md, n));
+		for(int l = 0; l < 8; ++l){
+			int col[SN_MAXN];
+			for(int i = 0; i < n; ++i) col[i] = di[i][l];
+			sn_sortn_int(col, n);
+			int si[8];
+			float sf[8];
+			double sd[4];
+			for(int i = 0; i < n; ++i){
+				_mm256_storeu_si256((__m256i*)si, vi[i]);
+				_mm256_storeu_ps(sf, vf[i]);
+				_mm256_storeu_pd(sd, vd[i]);
+				if(si[l] != col[i] || sf[l] != (float)col[i] || (l < 4 && sd[l] != (double)col[i]))
+					errx(1, "SIMD network %d", n);
+			}
+			int m = col[(n-1)/2];
+			if(medi[l] != m || medf[l] != (float)m || (l < 4 && medd[l] != (double)m)) errx(1, "SIMD median %d", n);
+		}
+	}
+}
+#endif
+
+/*--- Timings ---*/
+
+#define NARR    (4096)
+#define NREP    (5)
+
+// min cycles per one array of n items (without copying)
+#define BENCH(T, sfx) \
+static void bench_##sfx(){ \
+	T *src = malloc(NARR * SN_MAXN * sizeof(T)), *dst = malloc(NARR * SN_MAXN * sizeof(T)); \
+	for(int i = 0; i < NARR * SN_MAXN; ++i) src[i] = (T)(rand() % 100000); \
+	printf("\n" #sfx ": cycles per sort\n   n  network  insertion    qsort\n"); \
+	for(int n = 2; n <= SN_MAXN; ++n){ \
+		unsigned long long best[4] = {~0ULL, ~0ULL, ~0ULL, ~0ULL}; \
+		for(int rep = 0; rep < NREP; ++rep) for(int alg = 0; alg < 4; ++alg){ \
+			unsigned long long t0 = rdtsc(); \
+			memcpy(dst, src, NARR * n * sizeof(T)); \
+			switch(alg){ \
+				case 1: for(int a = 0; a < NARR; ++a) sn_sortn_##sfx(dst + a * n, n); break; \
+				case 2: for(int a = 0; a < NARR; ++a) insort_##sfx(dst + a * n, n); break; \
+				case 3: for(int a = 0; a < NARR; ++a) qsort(dst + a * n, n, sizeof(T), cmp_##sfx); break; \
+				default: break; /* memcpy only */ \
+			} \
+			t0 = rdtsc() - t0; \
+			if(t0 < best[alg]) best[alg] = t0; \
+		} \
+		printf("%4d", n); \
+		for(int alg = 1; alg < 4; ++alg) printf(" %9.1f", (double)(best[alg] - best[0]) / NARR); \
+		printf("\n"); \
+	} \
+	free(src); free(dst); \
+}
+BENCH(int, int)
+BENCH(float, float)
+BENCH(double, double)
+
+#define IMW     (512)
+#define IMH     (512)
+
+// median filters (hs = 1, 2) of image by constant-size networks
+#define MEDBENCH(T, sfx, V, LOAD, STORE, NL) \
+static void medbench_##sfx(){ \
+	T *im = malloc(IMW * IMH * sizeof(T)), *o1 = calloc(IMW * IMH, sizeof(T)), *o2 = calloc(IMW * IMH, sizeof(T)); \
+	for(int i = 0; i < IMW * IMH; ++i) im[i] = (T)(rand() % 4096); \
+	for(int hs = 1; hs < 3; ++hs){ \
+		int w = 2 * hs + 1, n = w * w; \
+		unsigned long long best[3] = {~0ULL, ~0ULL, ~0ULL}; \
+		for(int rep = 0; rep < NREP; ++rep){ \
+			T win[SN_MAXN]; \
+			unsigned long long t0 = rdtsc(); \
+			for(int y = hs; y < IMH - hs; ++y) for(int x = hs; x < IMW - hs; ++x){ \
+				for(int dy = -hs, k = 0; dy <= hs; ++dy) for(int dx = -hs; dx <= hs; ++dx) win[k++] = im[(y + dy) * IMW + x + dx]; \
+				o1[y * IMW + x] = (hs == 1) ? sn_median_##sfx(win, 9) : sn_median_##sfx(win, 25); \
+			} \
+			t0 = rdtsc() - t0; \
+			if(t0 < best[0]) best[0] = t0; \
+			t0 = rdtsc(); \
+			for(int y = hs; y < IMH - hs; ++y) for(int x = hs; x < IMW - hs; ++x){ \
+				for(int dy = -hs, k = 0; dy <= hs; ++dy) for(int dx = -hs; dx <= hs; ++dx) win[k++] = im[(y + dy) * IMW + x + dx]; \
+				qsort(win, n, sizeof(T), cmp_##sfx); \
+				o2[y * IMW + x] = win[(n-1)/2]; \
+			} \
+			t0 = rdtsc() - t0; \
+			if(t0 < best[1]) best[1] = t0; \
+			MEDSIMD(T, V, LOAD, STORE, NL) \
+		} \
+		if(memcmp(o1, o2, IMW * IMH * sizeof(T))) errx(1, #sfx ": median filter"); \
+		double npix = (IMW - 2*hs) * (double)(IMH - 2*hs); \
+		printf(#sfx ", median of %2d: network %6.1f, qsort %7.1f", n, best[0] / npix, best[1] / npix); \
+		if(best[2] != ~0ULL) printf(", SIMD network %5.1f", best[2] / npix); \
+		printf(" cycles per pixel\n"); \
+	} \
+	free(im); free(o1); free(o2); \
+}
+#ifdef __AVX2__
+// 8 (4) adjacent pixels at once, o2 is compared with o1
+#define MEDSIMD(T, V, LOAD, STORE, NL) { \
+	V win[SN_MAXN]; \
+	unsigned long long t0 = rdtsc(); \
+	for(int y = hs; y < IMH - hs; ++y){ \
+		int x = hs; \
+		for(; x + NL <= IMW - hs; x += NL){ \
+			for(int dy = -hs, k = 0; dy <= hs; ++dy) for(int dx = -hs; dx <= hs; ++dx) \
+				win[k++] = LOAD(&im[(y + dy) * IMW + x + dx]); \
+			STORE(&o2[y * IMW + x], (hs == 1) ? sn_median_##V(win, 9) : sn_median_##V(win, 25)); \
+		} \
+		for(; x < IMW - hs; ++x) o2[y * IMW + x] = o1[y * IMW + x]; \
+	} \
+	t0 = rdtsc() - t0; \
+	if(t0 < best[2]) best[2] = t0; \
+}
+#define LOADI(p)    _mm256_loadu_si256((const __m256i*)(p))
+#define STOREI(p,v) _mm256_storeu_si256((__m256i*)(p), v)
+MEDBENCH(int, int, __m256i, LOADI, STOREI, 8)
+MEDBENCH(float, float, __m256, _mm256_loadu_ps, _mm256_storeu_ps, 8)
+MEDBENCH(double, double, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, 4)
+#else
+#define MEDSIMD(T, V, LOAD, STORE, NL)
+MEDBENCH(int, int, , , , )
+MEDBENCH(float, float, , , , )
+MEDBENCH(double, double, , , , )
+#endif
+
+#define BIGN    (1000000)
+#define BIGBENCH(T, sfx) \
+static void bigbench_##sfx(){ \
+	T *a = malloc(BIGN * sizeof(T)), *b = malloc(BIGN * sizeof(T)); \
+	for(int i = 0; i < BIGN; ++i) a[i] = b[i] = (T)rand() - (T)(RAND_MAX / 2); \
+	double t0 = dtime(); \
+	sn_sort_##sfx(a, BIGN); \
+	double t1 = dtime() - t0; \
+	memcpy(a, b, BIGN * sizeof(T)); \
+	t0 = dtime(); \
+	sn_introsort_##sfx(a, BIGN, 64); \
+	double t2 = dtime() - t0; \
+	t0 = dtime(); \
+	qsort(b, BIGN, sizeof(T), cmp_##sfx); \
+	double t3 = dtime() - t0; \
+	printf("%d " #sfx ": sn_sort %.1f ms, introsort+networks %.1f ms, qsort %.1f ms\n", BIGN, t1*1e3, t2*1e3, t3*1e3); \
+	free(a); free(b); \
+}
+BIGBENCH(int, int)
+BIGBENCH(float, float)
+BIGBENCH(double, double)
+
+int main(int argc, char **argv){
+	if(argc == 2 && strcmp(argv[1], "-g") == 0){
+		gen_tables();
+		return 0;
+	}
+	srand(1);
+	test_int();
+	test_float();
+	test_double();
+#ifdef __AVX2__
+	test_simd();
+#endif
+	printf("Tests passed\n");
+	bench_int();
+	bench_float();
+	bench_double();
+	printf("\n");
+	medbench_int();
+	medbench_float();
+	medbench_double();
+	printf("\n");
+	bigbench_int();
+	bigbench_float();
+	bigbench_double();
+	return 0;
+}